@@ -63,6 +63,10 @@ unsigned char  command = 0;        // stores a processed command
 unsigned char  commandBytes = 0;   // stores the bytes this command expects
 unsigned long  lastUpdate = 0;
 
+// Command timeout, if the host stops commanding (crashed, or a loop stalled) the truck stops
+#define commandTimeout 500
+unsigned long  lastCommand = 0;
+
 // Setup the initial state of the controller
 void setup() {
   // Start the serial uplink
@@ -125,8 +129,9 @@ void loop() {
       Serial.readBytes((char *) &throttleTarget, 2); 
     }
     
-    // Clear command bytes
+    // Clear command bytes, and note the host is alive
     commandBytes = 0;
+    lastCommand = millis();
   } 
   
   // Else if we aren't waiting for comand bytes and there is a command pair in the buffer
@@ -178,6 +183,12 @@ void loop() {
   {
     // If not enabled, apply 5% brake force to engine
     throttleServo.writeMicroseconds(throttle_stop); 
+  } else if((throttleTarget != 0) && (positionTarget == 0) && ((millis() - lastCommand) >= commandTimeout))
+  {
+    // The host has gone quiet, brake and forget the throttle until told otherwise (a position
+    // move is left alone, it stops itself at the target)
+    throttleServo.writeMicroseconds(throttle_stop);
+    throttleTarget = 0;
   } else if((positionTarget != 0) && (abs(odometer) >= abs(positionTarget)))
   {
     // Since we have achieved the target, apply 5% braking force
@@ -42,6 +42,7 @@ const int pushbuttonInput = 7;
 unsigned char  command = 0;        // stores a processed command
 unsigned char  commandBytes = 0;   // stores the bytes this command expects
 unsigned long  lastUpdate = 0;
+unsigned char  lastBumpers = 0;
 unsigned char  state = 0;
 
 // Setup the initial state of the controller
@@ -151,14 +152,16 @@ void loop() {
     }
   }
 
-  // Check if we should upload a telemetry packet
-  if((millis() - lastUpdate) >= 25)
+  // Check if we should upload a telemetry packet, a bumper changing can't wait for the next one
+  // (the host stops the truck on it), but a bouncing switch mustn't flood the link either
+  unsigned char b = BUMPER_DATA;
+  if((millis() - lastUpdate) >= 25 || (b != lastBumpers && (millis() - lastUpdate) >= 2))
   {
     // Store the current time
     lastUpdate = millis();
+    lastBumpers = b;
     
     // Print a binary representation of all of this data
-    unsigned char b = BUMPER_DATA;
     Serial.write(&b, 1);
     Serial.write((unsigned char *) sonarValues, 10);
   }
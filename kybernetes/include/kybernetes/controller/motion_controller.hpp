@@ -20,6 +20,21 @@
 #ifndef _kybernetes_controller_motion_h_
 #define _kybernetes_controller_motion_h_
 
+// The motion controller reports its odometer in inches
+#define ODOMETER_METERS_PER_UNIT 0.0254
+
+// Largest odometer step believed between two telemetry frames (m, 10 m/s at 20 Hz).  The
+// firmware zeroes the odometer when it reaches a position target, and that jump isn't motion.
+#define ODOMETER_MAXIMUM_STEP    0.5
+
+// The firmware stops the truck if no command arrives for this long (s), keep commanding.  A
+// position move (setTarget) is exempt, it ends at its odometer target.
+#define MOTION_COMMAND_TIMEOUT   0.5
+
+// Reasons the truck can be halted for, it moves again once all of them are released
+#define HALT_REFLEX              0x01
+#define HALT_WATCHDOG            0x02
+
 // Pull in some boost utilities
 #include <boost/thread/thread.hpp>
 #include <boost/smart_ptr/shared_ptr.hpp>
@@ -77,18 +92,23 @@ namespace kybernetes
             // Internal thread control
             boost::shared_ptr<boost::thread>        m_thread;
             boost::mutex                            m_mutex; // Lock telemetry data while its being updated
+            boost::mutex                            m_writeMutex; // Commands come from several threads, don't interleave them
             
             // The thread function
             void do_parsing();
             void start();
             void stop();
             
+            // Send a command (and its argument bytes) in one write
+            void command(char type, const void *data, size_t length);
+            
             // Motion controller interface
             kybernetes::io::SerialDevice           *m_device;
             std::string                             m_port;
             unsigned int                            m_baudrate;
             MotionController::state                 m_state;
             bool                                    m_ready;
+            unsigned char                           m_halted;
             
             // Updated callback
             std::list<MotionController::callback *> m_callbacks;
@@ -106,6 +126,13 @@ namespace kybernetes
             void setThrottle(unsigned short throttle);
             void setDrift(unsigned short drift);
             
+            // Stop now and drop throttle and position commands until released (the sensor
+            // controller's reflex and the watchdog use this, so a stop can't be overridden by a
+            // stale command).  Each reason halts and releases on its own.
+            void halt(unsigned char reason);
+            void release(unsigned char reason);
+            bool isHalted();
+            
             // Callback registration
             void registerCallback(MotionController::callback *c);
             void unregisterCallback(MotionController::callback *c);
@@ -20,8 +20,24 @@
 #ifndef _kybernetes_controller_sensor_h_
 #define _kybernetes_controller_sensor_h_
 
+// The sonars are MaxSonars on the 10 bit ADC, two counts per inch
+#define SONAR_METERS_PER_UNIT 0.0127
+
+// Bumper bits
+#define BUMPER_FRONT_LEFT     0x01
+#define BUMPER_FRONT_RIGHT    0x02
+#define BUMPER_BACK_LEFT      0x04
+#define BUMPER_BACK_RIGHT     0x08
+
+// The reflex lets go after this many clear readings in a row, and no sooner than this long (s)
+// after the last reading that tripped it, so a bumper bouncing off or a sonar frame without an
+// echo doesn't let the truck drive straight back in
+#define REFLEX_CLEAR_READINGS 4
+#define REFLEX_HOLD           0.5
+
 // Pull in some boost utilities
 #include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/smart_ptr/shared_ptr.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
@@ -32,6 +48,7 @@
 
 // Other kybernetes dependencies
 #include <kybernetes/io/serial.hpp>
+#include <kybernetes/controller/motion_controller.hpp>
 
 // Kybernetes namespace
 namespace kybernetes
@@ -48,7 +65,7 @@ namespace kybernetes
             typedef struct _sensorcontroller_state
             {
                 unsigned char           bumpers;
-                unsigned short          sonars[5];
+                unsigned short          sonars[5]; // Left to right
             } state;
             
             // Sensor controller callback class
@@ -71,12 +88,19 @@ namespace kybernetes
                 }
             };
         private:
-            // Internal thread control
+            // Internal thread control.  Readings are parsed on one thread and handed to the
+            // callbacks on another, so a slow callback can't hold up the reflex on the next reading.
+            // The dispatcher only gets the newest reading, a slow callback skips the ones it missed.
             boost::shared_ptr<boost::thread>             m_thread;
+            boost::shared_ptr<boost::thread>             m_dispatcher;
             boost::mutex                                 m_mutex; // Lock sensor data while its being updated
+            boost::condition_variable                    m_available;
+            SensorController::state                      m_pending;
+            bool                                         m_fresh;
             
-            // The thread function
+            // The thread functions
             void do_parsing();
+            void do_dispatch();
             void start();
             void stop();
             
@@ -90,6 +114,19 @@ namespace kybernetes
             // Callback objects
             std::list<SensorController::callback *>      m_callbacks;
             
+            // Reflex stop, the motion controller to halt, what trips it, whether it is tripped, how
+            // many times it has been, clear readings since and when it last tripped
+            MotionController                            *m_reflex;
+            unsigned char                                m_reflexBumpers;
+            unsigned short                               m_reflexSonar;
+            bool                                         m_reflexTripped;
+            unsigned int                                 m_reflexCount;
+            unsigned int                                 m_reflexClear;
+            double                                       m_reflexLast;
+            
+            // Halt or release the motion controller on a new reading
+            void reflex(const SensorController::state& s);
+            
         public:
             // Constructor for the object
             SensorController(std::string port, unsigned int baudrate);
@@ -102,6 +139,13 @@ namespace kybernetes
             void registerCallback(SensorController::callback *c);
             void unregisterCallback(SensorController::callback *c);
             
+            // Halt a motion controller as soon as a reading with a bumper in the mask pressed or a
+            // sonar under the threshold (in sonar units, 0 for none) is decoded, before any of the
+            // callbacks run.  The halt is released once the readings have stayed clear (see
+            // REFLEX_CLEAR_READINGS and REFLEX_HOLD).  NULL turns it off.
+            void         setReflex(MotionController *controller, unsigned char bumperMask, unsigned short sonarThreshold);
+            unsigned int reflexes();
+            
             // Check if the sensor controller is ready
             bool isReady();
         };
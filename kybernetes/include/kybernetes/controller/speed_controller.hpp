@@ -0,0 +1,135 @@
+/*
+ *  speed_controller.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_controller_speed_h_
+#define _kybernetes_controller_speed_h_
+
+// Pull in some boost utilities
+#include <boost/thread/thread.hpp>
+
+// Other kybernetes dependencies
+#include <kybernetes/controller/motion_controller.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // controller namespace
+    namespace controller
+    {
+        // Holds the truck at a speed.  The throttle the motion controller takes is an open loop
+        // offset to the esc's pulse, so the speed it gives changes with the battery and the slope.
+        // This measures the speed from the odometer advancing over each telemetry frame (20 Hz) and
+        // closes a PI loop around a feedforward guess of the throttle.  Throttle commands are only
+        // written when they change (or to keep the firmware from timing out), and no more often
+        // than a minimum interval.
+        //
+        // Register the controller with the motion controller, the loop runs on its thread.  Once
+        // a speed has been set, don't also call setThrottle, the two will fight.
+        class SpeedController : public MotionController::callback
+        {
+        public:
+            // Tuning
+            typedef struct _speed_controller_parameters
+            {
+                // Feedforward, the throttle the wheels start turning at and the throttle per m/s
+                // above that (on a charged battery, on the flat)
+                double         offset;
+                double         gain;
+
+                // Throttle per m/s of error, and per m of accumulated error
+                double         kp;
+                double         ki;
+
+                // The integral works on the speed predicted this far ahead (s, about half the truck's
+                // lag), so it doesn't wind up while the feedforward is still getting the truck there
+                double         lead;
+
+                // Largest throttle commanded
+                unsigned short maxThrottle;
+
+                // Smoothing of the measured speed (0 - 1, weight of the newest frame)
+                double         smoothing;
+
+                // Shortest time between throttle commands (s), and the longest, an unchanged
+                // throttle is sent again so the firmware's command timeout doesn't stop the truck
+                double         interval;
+                double         refresh;
+            } parameters;
+
+            // Default tuning for the truck
+            static parameters defaultParameters();
+
+        private:
+            // Lock the loop, the speed is set from other threads
+            boost::mutex          m_mutex;
+
+            // The motion controller driven and configuration
+            MotionController     &m_controller;
+            parameters            m_parameters;
+            double                m_metersPerUnit;
+
+            // The speed wanted, the speed measured (m/s) and its rate of change (m/s^2)
+            double                m_target;
+            double                m_speed;
+            double                m_acceleration;
+
+            // Last odometer reading and when it arrived
+            float                 m_odometer;
+            double                m_frameTime;
+            bool                  m_haveOdometer;
+
+            // Accumulated throttle from the integral term
+            double                m_integral;
+
+            // Last throttle written and when
+            unsigned short        m_throttle;
+            double                m_writeTime;
+            unsigned int          m_writes;
+
+            // Throttle for the current target and speed, the integral is only accepted (passed
+            // back through integral) when the throttle isn't saturated
+            unsigned short        calculate(double elapsed, double& integral) const;
+
+            // Write a throttle if it changed, or again to keep the firmware from timing out
+            void                  command(unsigned short throttle, bool force);
+
+        public:
+            // Constructor for the object
+            SpeedController(MotionController& controller, double metersPerUnit = ODOMETER_METERS_PER_UNIT);
+            SpeedController(MotionController& controller, const parameters& p, double metersPerUnit = ODOMETER_METERS_PER_UNIT);
+
+            // Set the speed to hold (m/s), 0 stops the truck
+            void           setSpeed(double speed);
+            void           stop();
+
+            // Speed wanted and measured (m/s)
+            double         target();
+            double         speed();
+
+            // Last throttle written and the number of writes
+            unsigned short throttle();
+            unsigned int   writes();
+
+            // A telemetry frame arrived, run the loop
+            void motors_event_update(MotionController::state s);
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ *  visual_servo.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _kybernetes_controller_visual_servo_h_
+#define _kybernetes_controller_visual_servo_h_
+
+// Pull in some boost utilities
+#include <boost/thread/thread.hpp>
+
+// Language dependencies
+#include <iostream>
+#include <string>
+#include <deque>
+
+// Other kybernetes dependencies
+#include <kybernetes/controller/motion_controller.hpp>
+#include <kybernetes/sensor/imu.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // controller namespace
+    namespace controller
+    {
+        // Steers the truck at a target seen by the camera, for the last few meters to a cone.  A
+        // sighting (the target's pixel column and the turret's pan) is a bearing relative to the
+        // heading the truck had when the frame was exposed, and by the time the frame has been
+        // processed the truck has turned.  The gyro's yaw is kept for a short while, so the yaw
+        // at the frame's timestamp turns the sighting into a compass bearing, which is then
+        // steered for against the latest yaw.  Each frame steers through the motion controller,
+        // so the truck doesn't have to stop and look.
+        //
+        // Register the servo with the IMU.  Frame timestamps are on the monotonic clock, as V4L2
+        // stamps them.
+        class VisualServo : public kybernetes::sensor::IMU::callback
+        {
+        public:
+            // Tuning
+            typedef struct _visual_servo_parameters
+            {
+                // Horizontal field of view of the camera (degrees)
+                double fieldOfView;
+
+                // Wheel angle per degree of bearing error
+                double gain;
+
+                // Largest wheel angle (degrees) and the drift per degree of wheel angle
+                double maximumSteering;
+                double driftPerDegree;
+
+                // Yaw kept for looking up the heading of late frames (s)
+                double history;
+
+                // A target not seen for this long is lost (s), until then its bearing is held
+                double timeout;
+            } parameters;
+
+            // The steering decision for a frame
+            typedef struct _visual_servo_command
+            {
+                // Compass bearing of the target and how far it is off the heading (degrees,
+                // positive to the right)
+                double bearing;
+                double error;
+
+                // Wheel angle (degrees, positive turning right) and the drift sent
+                double steering;
+                short  drift;
+
+                // Age of the frame when it was steered on (s)
+                double latency;
+
+                // Whether the target has been seen recently enough to steer for
+                bool   locked;
+            } command;
+
+            // Default tuning for the truck
+            static parameters defaultParameters();
+
+        private:
+            // A heading from the gyro and when it arrived
+            typedef struct _visual_servo_sample
+            {
+                double timestamp;
+                double yaw;
+            } sample;
+
+            // Lock the state, sightings and the gyro arrive on different threads
+            boost::mutex          m_mutex;
+
+            // The motion controller steered, the image width and configuration
+            MotionController     &m_controller;
+            parameters            m_parameters;
+            double                m_center;
+            double                m_focalLength;
+
+            // Recent headings, oldest first
+            std::deque<sample>    m_headings;
+
+            // Compass bearing of the target and the timestamp of the frame it was last seen in
+            double                m_bearing;
+            double                m_seen;
+
+            // Heading at a time, interpolated between the gyro updates around it
+            double                headingAt(double timestamp) const;
+
+            // Steer for the held bearing
+            command               steer(double timestamp);
+
+        public:
+            // Constructor for the object, takes the width of the images (pixels)
+            VisualServo(MotionController& controller, unsigned int width);
+            VisualServo(MotionController& controller, unsigned int width, const parameters& p);
+
+            // The target was seen at a pixel column in a frame, with the turret panned (degrees,
+            // positive to the right).  Steers for it and returns the decision.
+            command observe(double column, double pan, double timestamp);
+
+            // A frame without the target, steers for where it was last seen
+            command hold(double timestamp);
+
+            // Whether the gyro has given a heading yet
+            bool    isReady();
+
+            // The IMU updated
+            void imu_event_update(kybernetes::sensor::IMU::state s);
+        };
+    }
+}
+
+#endif
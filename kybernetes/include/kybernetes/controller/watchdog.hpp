@@ -0,0 +1,100 @@
+/*
+ *  watchdog.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_controller_watchdog_h_
+#define _kybernetes_controller_watchdog_h_
+
+// Pull in some boost utilities
+#include <boost/thread/thread.hpp>
+#include <boost/smart_ptr/shared_ptr.hpp>
+
+// Language dependencies
+#include <string>
+#include <vector>
+
+// Other kybernetes dependencies
+#include <kybernetes/controller/motion_controller.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // controller namespace
+    namespace controller
+    {
+        // Stops the truck when a control loop stalls.  The motion controller holds the last
+        // throttle it was sent, so a loop stuck on the console or a lock would otherwise leave the
+        // truck driving on.  Each loop is watched with a deadline and feeds the watchdog whenever
+        // it sends its command; once a loop has fed it, going past the deadline halts the motion
+        // controller (writing a stop) until that loop feeds it again.  Overruns are counted, along
+        // with the longest time a loop went without commanding.
+        class Watchdog
+        {
+        public:
+            // A loop being watched
+            typedef struct _watchdog_loop
+            {
+                // Name (for reporting) and the longest it may go between commands (s)
+                std::string  name;
+                double       deadline;
+
+                // Monotonic time of the last command (0 before the first) and whether it is overdue
+                double       last;
+                bool         expired;
+
+                // Number of missed deadlines, and the longest time between commands of one (s)
+                unsigned int overruns;
+                double       worst;
+            } loop;
+
+        private:
+            // Internal thread control
+            boost::shared_ptr<boost::thread> m_thread;
+            boost::mutex                     m_mutex;
+
+            // The thread function
+            void do_watching();
+
+            // The motion controller halted, how often the loops are checked (s) and the loops
+            MotionController                &m_controller;
+            double                           m_period;
+            std::vector<Watchdog::loop>      m_loops;
+
+            // Watchdogs run a thread, don't copy them
+            Watchdog(const Watchdog&);
+            Watchdog& operator=(const Watchdog&);
+
+        public:
+            // Constructor for the object
+            Watchdog(MotionController& controller, double period = 0.01);
+            ~Watchdog();
+
+            // Watch a loop, returns the id it feeds the watchdog with
+            int  watch(const std::string& name, double deadline);
+
+            // The loop sent its command
+            void feed(int id);
+
+            // State of the loops
+            Watchdog::loop              status(int id);
+            std::vector<Watchdog::loop> loops();
+        };
+    }
+}
+
+#endif
@@ -21,6 +21,7 @@
 #define _kybernetes_cv_cv_h_
 
 #include <stdint.h>
+#include <stddef.h>
 
 // Kybernetes namespace
 namespace kybernetes
@@ -28,8 +29,31 @@ namespace kybernetes
     // controller namespace
     namespace cv
     {
-        // Color finding procedures.  Take a YUYV image with a width that is a multiple of 16, and return a bitmap of the pixels within a specified range
-        extern "C" void yuv422_bithreshold(void *source, void *destination, uint16_t width, uint16_t height, uint8_t ly, uint8_t lu, uint8_t lv, uint8_t uy, uint8_t uu, uint8_t uv);
+        // Color finding procedures.  Take a YUYV image of any width, and return a bitmap of the pixels within a specified range (0xFF in range, 0x00 out).
+        // A row of an odd width image ends in a whole YUYV pair.  The strides (bytes from one row to the next) let either image be part of a larger one.
+        void yuv422_bithreshold(void *source, void *destination, uint16_t width, uint16_t height, uint8_t ly, uint8_t lu, uint8_t lv, uint8_t uy, uint8_t uu, uint8_t uv);
+        void yuv422_bithreshold(const void *source, size_t sourceStride, void *destination, size_t destinationStride, unsigned int width, unsigned int height,
+                                uint8_t ly, uint8_t lu, uint8_t lv, uint8_t uy, uint8_t uu, uint8_t uv);
+
+        // The packed threshold is built for each instruction set it has a kernel for, and the fastest one the processor supports is picked the first
+        // time it is used.  Selecting one (if the processor supports it) is for checking and timing them against each other and the scalar version.
+        typedef enum _bithreshold_kernel
+        {
+            BITHRESHOLD_SCALAR = 0,
+            BITHRESHOLD_SSE2,
+            BITHRESHOLD_AVX2,
+            BITHRESHOLD_NEON,
+            BITHRESHOLD_KERNELS
+        } bithreshold_kernel;
+        bool               bithreshold_available(bithreshold_kernel kernel);
+        bool               bithreshold_select(bithreshold_kernel kernel);
+        bithreshold_kernel bithreshold_selected();
+        const char        *bithreshold_name(bithreshold_kernel kernel);
+
+        // The same for planar images (the Y, U and V planes one after another, as the MJPEGDecoder gives them) of any width.
+        // 4:2:2 has chroma at half width, 4:2:0 at half width and height.
+        void yuv422p_bithreshold(const void *source, void *destination, uint16_t width, uint16_t height, uint8_t ly, uint8_t lu, uint8_t lv, uint8_t uy, uint8_t uu, uint8_t uv);
+        void yuv420p_bithreshold(const void *source, void *destination, uint16_t width, uint16_t height, uint8_t ly, uint8_t lu, uint8_t lv, uint8_t uy, uint8_t uu, uint8_t uv);
     }
 }
 
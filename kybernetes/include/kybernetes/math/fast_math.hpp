@@ -0,0 +1,124 @@
+/*
+ *  fast_math.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_math_fast_math_h_
+#define _kybernetes_math_fast_math_h_
+
+// Language dependencies
+#include <stdint.h>
+#include <cstring>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // math namespace
+    namespace math
+    {
+        // Single precision polynomial approximations of the functions the heading, bearing and
+        // pixel to angle math uses.  None of them branch, so the array forms below compile to
+        // vector code where the target has it.  Angles are in radians.  The maximum errors were
+        // measured against double precision libm by fast_math_benchmark:
+        //
+        //   fastAtan2    1.2e-5 rad (7e-4 degrees) absolute
+        //   fastSin/Cos  1e-7 absolute for |x| <= 4 pi (7e-7 for the array forms, which are
+        //                built with relaxed floating point so NEON can vectorize them).  The
+        //                argument reduction error grows with |x|, keep angles wrapped.
+        //   fastSqrt     4.8e-6 relative, defined for finite x >= 0
+        //
+        // The heading error a controller acts on is a fraction of a degree at best, so these
+        // are well beyond what the vehicle can use; opt in where the libm calls show up in a profile.
+
+        // atan2(y, x) in (-pi, pi], 0 for (0, 0)
+        inline float fastAtan2(float y, float x)
+        {
+            // Reduce to atan of a ratio in [0, 1]
+            float ax = (x < 0.0f) ? -x : x;
+            float ay = (y < 0.0f) ? -y : y;
+            float mx = (ax > ay) ? ax : ay;
+            float mn = (ax > ay) ? ay : ax;
+            float a  = mn / (mx + 1.0e-30f);
+
+            // Minimax polynomial for atan on [0, 1] (Abramowitz and Stegun 4.4.47)
+            float s = a * a;
+            float r = a * (0.9998660f + s * (-0.3302995f + s * (0.1801410f + s * (-0.0851330f + s * 0.0208351f))));
+
+            // Undo the reduction into the right octant
+            r = (ay > ax)   ? 1.57079632679f - r : r;
+            r = (x < 0.0f)  ? 3.14159265359f - r : r;
+            return (y < 0.0f) ? -r : r;
+        }
+
+        // sin(x) with the quadrant of x offset by a quarter turn (0 = sin, 1 = cos)
+        inline float fastSinQuadrant(float x, int offset)
+        {
+            // Nearest multiple of pi/2, and the remainder in [-pi/4, pi/4] (Cody-Waite reduction)
+            float t = x * 0.636619772368f;
+            int   q = (int) (t + ((t < 0.0f) ? -0.5f : 0.5f));
+            float fq = (float) q;
+            float r = ((x - fq * 1.5703125f) - fq * 4.837512969970703125e-4f) - fq * 7.549789948768648e-8f;
+            q += offset;
+
+            // Minimax polynomials for sin and cos on [-pi/4, pi/4] (Cephes sinf/cosf)
+            float s  = r * r;
+            float vs = r + r * s * (-1.6666654611e-1f + s * (8.3321608736e-3f + s * -1.9515295891e-4f));
+            float vc = 1.0f - 0.5f * s + s * s * (4.166664568298827e-2f + s * (-1.388731625493765e-3f + s * 2.443315711809948e-5f));
+
+            // Quadrants 1 and 3 take the cosine, quadrants 2 and 3 are negated
+            float v = (q & 1) ? vc : vs;
+            return (q & 2) ? -v : v;
+        }
+
+        // sin(x)
+        inline float fastSin(float x)
+        {
+            return fastSinQuadrant(x, 0);
+        }
+
+        // cos(x)
+        inline float fastCos(float x)
+        {
+            return fastSinQuadrant(x, 1);
+        }
+
+        // sqrt(x) for finite x >= 0, from the reciprocal square root estimate and two newton steps
+        inline float fastSqrt(float x)
+        {
+            // Initial estimate of 1/sqrt(x) from the exponent bits
+            uint32_t i;
+            std::memcpy(&i, &x, sizeof(i));
+            i = 0x5f375a86 - (i >> 1);
+            float y;
+            std::memcpy(&y, &i, sizeof(y));
+
+            // Refine and multiply back (sqrt(0) comes out as 0 * finite)
+            float h = 0.5f * x;
+            y = y * (1.5f - h * y * y);
+            y = y * (1.5f - h * y * y);
+            return x * y;
+        }
+
+        // Array forms, result[i] = f(input[i]) for i < count.  The result may alias an input.
+        void fastAtan2(const float *y, const float *x, float *result, unsigned int count);
+        void fastSin(const float *x, float *result, unsigned int count);
+        void fastCos(const float *x, float *result, unsigned int count);
+        void fastSqrt(const float *x, float *result, unsigned int count);
+    }
+}
+
+#endif
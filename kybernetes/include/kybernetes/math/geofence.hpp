@@ -0,0 +1,105 @@
+/*
+ *  geofence.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_math_geofence_h_
+#define _kybernetes_math_geofence_h_
+
+// Language dependencies
+#include <string>
+#include <vector>
+
+// Other kybernetes dependencies
+#include <kybernetes/math/gps_common.hpp>
+#include <kybernetes/math/local_frame.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // math namespace
+    namespace math
+    {
+        // A polygon the vehicle must stay inside of.  The polygon is laid over a uniform grid
+        // in the local frame, and each cell stores whether its center is inside, the edges that
+        // pass through it, and the edges that can be nearest to any point in it.  A query then
+        // only has to look at a few edges instead of the whole polygon.
+        class Geofence
+        {
+            // Per cell index into the edge lists
+            typedef struct _geofence_cell
+            {
+                bool         inside;
+                unsigned int crossingBegin;
+                unsigned int crossingCount;
+                unsigned int nearestBegin;
+                unsigned int nearestCount;
+            } cell;
+
+            // Polygon in the local frame
+            LocalFrame                   m_frame;
+            std::vector<LocalCoordinate> m_vertices;
+
+            // Grid layout
+            double                       m_cellSize;
+            double                       m_originX;
+            double                       m_originY;
+            int                          m_columns;
+            int                          m_rows;
+
+            // Grid cells and the edge lists they index
+            std::vector<cell>            m_cells;
+            std::vector<unsigned int>    m_crossingEdges;
+            std::vector<unsigned int>    m_nearestEdges;
+
+            // Build the grid index
+            void build(const std::vector<GeoCoordinate>& polygon);
+
+            // Geometry helpers
+            double edgeDistance(unsigned int edge, const LocalCoordinate& position) const;
+            bool   edgeCrosses(unsigned int edge, const LocalCoordinate& a, const LocalCoordinate& b) const;
+            bool   containsSlow(const LocalCoordinate& position) const;
+            double distanceSlow(const LocalCoordinate& position) const;
+            int    cellIndex(const LocalCoordinate& position) const;
+            LocalCoordinate cellCenter(int index) const;
+
+        public:
+            // Constructors, the cell size is in meters
+            Geofence();
+            Geofence(const std::vector<GeoCoordinate>& polygon, const LocalFrame& frame, double cellSize = 2.0);
+
+            // Load the polygon from a coordinate list file
+            bool load(const std::string& path, const LocalFrame& frame, double cellSize = 2.0);
+
+            // Check if the geofence has a polygon
+            bool   isValid() const;
+
+            // Queries in the local frame
+            bool   contains(const LocalCoordinate& position) const;
+            double distanceToBoundary(const LocalCoordinate& position) const;
+
+            // Distance to the boundary, positive inside of the fence and negative outside
+            double clearance(const LocalCoordinate& position) const;
+
+            // Queries in geographic coordinates
+            bool   contains(const GeoCoordinate& position) const;
+            double clearance(const GeoCoordinate& position) const;
+        };
+    }
+}
+
+#endif
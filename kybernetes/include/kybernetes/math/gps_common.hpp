@@ -20,6 +20,10 @@
 #ifndef _kybernetes_sensor_gps_common_h_
 #define _kybernetes_sensor_gps_common_h_
 
+// Language dependencies
+#include <string>
+#include <vector>
+
 // Kybernetes namespace
 namespace kybernetes
 {
@@ -42,6 +46,12 @@ namespace kybernetes
             double headingTo(GeoCoordinate& coordinate);
             double distanceTo(GeoCoordinate& coordinate);
         };
+        
+        // Load a coordinate list file (whitespace separated "latitude longitude" pairs, see doc/*.list)
+        bool loadCoordinateList(const std::string& path, std::vector<GeoCoordinate>& coordinates);
+        
+        // Write a coordinate list file
+        bool saveCoordinateList(const std::string& path, const std::vector<GeoCoordinate>& coordinates);
     }
 }
 
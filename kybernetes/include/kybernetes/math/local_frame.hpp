@@ -0,0 +1,76 @@
+/*
+ *  local_frame.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_math_local_frame_h_
+#define _kybernetes_math_local_frame_h_
+
+// GPS coordinate math
+#include <kybernetes/math/gps_common.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // math namespace
+    namespace math
+    {
+        // A position in a local tangent plane, in meters east (x) and north (y) of an origin
+        class LocalCoordinate
+        {
+        public:
+            // Standard constructor
+            LocalCoordinate();
+            LocalCoordinate(double _x, double _y);
+
+            // Easting and northing in meters
+            double x;
+            double y;
+
+            // Utilities for local navigation (headings are compass degrees, 0 = north, clockwise)
+            double headingTo(const LocalCoordinate& coordinate) const;
+            double distanceTo(const LocalCoordinate& coordinate) const;
+        };
+
+        // Flat earth (equirectangular) projection about an origin.  Over the few hundred
+        // meters of a course the error is well under the resolution of the GPS, and a
+        // conversion costs two multiplies instead of a handful of trig calls.
+        class LocalFrame
+        {
+            // The origin of the frame
+            GeoCoordinate m_origin;
+
+            // Scale factors from degrees to meters at the origin
+            double        m_metersPerDegreeLatitude;
+            double        m_metersPerDegreeLongitude;
+
+        public:
+            // Constructors, the default frame is centered at (0,0)
+            LocalFrame();
+            LocalFrame(const GeoCoordinate& origin);
+
+            // Conversions between geographic and local coordinates
+            LocalCoordinate toLocal(const GeoCoordinate& coordinate) const;
+            GeoCoordinate   toGeo(const LocalCoordinate& coordinate) const;
+
+            // Get the origin of the frame
+            const GeoCoordinate& origin() const;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ *  matrix.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_math_matrix_h_
+#define _kybernetes_math_matrix_h_
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // math namespace
+    namespace math
+    {
+        // A small matrix with its dimensions fixed at compile time.  The storage lives inside
+        // the object (on the stack for locals), nothing is ever allocated, and since the loop
+        // bounds are constants the compiler unrolls the products for the sizes filters use.
+        template <unsigned int R, unsigned int C>
+        class Matrix
+        {
+        public:
+            // Elements in row major order
+            double m[R][C];
+
+            // Matrix filled with a value (zero by default)
+            explicit Matrix(double value = 0.0)
+            {
+                for(unsigned int i = 0; i < R; i++)
+                    for(unsigned int j = 0; j < C; j++)
+                        m[i][j] = value;
+            }
+
+            // Identity matrix
+            static Matrix identity()
+            {
+                Matrix result;
+                for(unsigned int i = 0; i < R && i < C; i++)
+                    result.m[i][i] = 1.0;
+                return result;
+            }
+
+            // Element access
+            double& operator()(unsigned int row, unsigned int column)
+            {
+                return m[row][column];
+            }
+
+            const double& operator()(unsigned int row, unsigned int column) const
+            {
+                return m[row][column];
+            }
+
+            // Element wise arithmetic
+            Matrix operator+(const Matrix& rhs) const
+            {
+                Matrix result;
+                for(unsigned int i = 0; i < R; i++)
+                    for(unsigned int j = 0; j < C; j++)
+                        result.m[i][j] = m[i][j] + rhs.m[i][j];
+                return result;
+            }
+
+            Matrix operator-(const Matrix& rhs) const
+            {
+                Matrix result;
+                for(unsigned int i = 0; i < R; i++)
+                    for(unsigned int j = 0; j < C; j++)
+                        result.m[i][j] = m[i][j] - rhs.m[i][j];
+                return result;
+            }
+
+            Matrix operator*(double scale) const
+            {
+                Matrix result;
+                for(unsigned int i = 0; i < R; i++)
+                    for(unsigned int j = 0; j < C; j++)
+                        result.m[i][j] = m[i][j] * scale;
+                return result;
+            }
+
+            // Matrix product
+            template <unsigned int K>
+            Matrix<R, K> operator*(const Matrix<C, K>& rhs) const
+            {
+                Matrix<R, K> result;
+                for(unsigned int i = 0; i < R; i++)
+                    for(unsigned int k = 0; k < C; k++)
+                        for(unsigned int j = 0; j < K; j++)
+                            result.m[i][j] += m[i][k] * rhs.m[k][j];
+                return result;
+            }
+
+            // Transpose
+            Matrix<C, R> transpose() const
+            {
+                Matrix<C, R> result;
+                for(unsigned int i = 0; i < R; i++)
+                    for(unsigned int j = 0; j < C; j++)
+                        result.m[j][i] = m[i][j];
+                return result;
+            }
+        };
+
+        // Inverses of the innovation covariances the filters produce
+        inline Matrix<1, 1> inverse(const Matrix<1, 1>& a)
+        {
+            return Matrix<1, 1>(1.0 / a.m[0][0]);
+        }
+
+        inline Matrix<2, 2> inverse(const Matrix<2, 2>& a)
+        {
+            double determinant = a.m[0][0] * a.m[1][1] - a.m[0][1] * a.m[1][0];
+            Matrix<2, 2> result;
+            result.m[0][0] =  a.m[1][1] / determinant;
+            result.m[0][1] = -a.m[0][1] / determinant;
+            result.m[1][0] = -a.m[1][0] / determinant;
+            result.m[1][1] =  a.m[0][0] / determinant;
+            return result;
+        }
+    }
+}
+
+#endif
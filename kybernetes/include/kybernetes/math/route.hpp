@@ -0,0 +1,116 @@
+/*
+ *  route.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_math_route_h_
+#define _kybernetes_math_route_h_
+
+// Language dependencies
+#include <string>
+#include <vector>
+
+// Other kybernetes dependencies
+#include <kybernetes/math/gps_common.hpp>
+#include <kybernetes/math/local_frame.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // math namespace
+    namespace math
+    {
+        // A polyline through a list of waypoints.  Everything that does not depend on the
+        // vehicle's position (segment directions, lengths and the distance along the route
+        // to each waypoint) is computed once, so the queries made on every position update
+        // are a binary search plus a handful of dot products.
+        class Route
+        {
+        public:
+            // Where a position lies with respect to the route
+            typedef struct _route_progress
+            {
+                // Segment the closest point lies on (waypoint segment -> segment + 1)
+                size_t          segment;
+
+                // Distance along the route to the closest point in meters
+                double          along;
+
+                // Signed distance from the route in meters, positive when right of the route
+                double          crossTrack;
+
+                // The closest point on the route
+                LocalCoordinate closest;
+            } progress;
+
+        private:
+            // Frame the route is laid out in
+            LocalFrame                   m_frame;
+
+            // Waypoints in the local frame
+            std::vector<LocalCoordinate> m_waypoints;
+
+            // Per segment unit direction, length and compass heading
+            std::vector<LocalCoordinate> m_directions;
+            std::vector<double>          m_lengths;
+            std::vector<double>          m_headings;
+
+            // Distance along the route to each waypoint
+            std::vector<double>          m_cumulative;
+
+            // Precompute the segment data
+            void build(const std::vector<GeoCoordinate>& waypoints);
+
+            // Project a position onto a single segment
+            void projectSegment(size_t segment, const LocalCoordinate& position, double reference, double weight, progress& result, double& score) const;
+
+        public:
+            // Constructors.  Without a frame, the route is laid out about its first waypoint
+            Route();
+            Route(const std::vector<GeoCoordinate>& waypoints);
+            Route(const std::vector<GeoCoordinate>& waypoints, const LocalFrame& frame);
+
+            // Load the route from a coordinate list file
+            bool load(const std::string& path);
+
+            // Route geometry
+            size_t                 size() const;
+            size_t                 segments() const;
+            double                 length() const;
+            const LocalFrame&      frame() const;
+            const LocalCoordinate& waypoint(size_t index) const;
+            double                 distanceAt(size_t index) const;
+            double                 heading(size_t segment) const;
+
+            // Lookups by distance along the route, O(log n)
+            size_t                 segmentAt(double along) const;
+            LocalCoordinate        pointAt(double along) const;
+
+            // Find the closest point on the route to a position.  The first form searches the
+            // whole route.  The second only considers segments within [behind, ahead] meters of
+            // a previous result, so it costs O(log n) no matter how long the route is, and it
+            // will not jump to a later leg that happens to pass close by (out and back courses).
+            progress               locate(const LocalCoordinate& position) const;
+            progress               locate(const LocalCoordinate& position, const progress& previous, double behind, double ahead) const;
+
+            // Get the point a given distance further along the route from a progress result
+            LocalCoordinate        lookahead(const progress& current, double distance) const;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ *  dead_reckoning.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_navigation_dead_reckoning_h_
+#define _kybernetes_navigation_dead_reckoning_h_
+
+// Pull in some boost utilities
+#include <boost/thread/thread.hpp>
+
+// Language dependencies
+#include <iostream>
+#include <string>
+#include <list>
+
+// Other kybernetes dependencies
+#include <kybernetes/controller/motion_controller.hpp>
+#include <kybernetes/sensor/imu.hpp>
+#include <kybernetes/sensor/gps.hpp>
+#include <kybernetes/math/local_frame.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // navigation namespace
+    namespace navigation
+    {
+        // Position estimate between GPS fixes.  Register this object as a callback with the
+        // motion controller, the imu and the gps.  Each telemetry frame from the motion controller
+        // (20 Hz) moves the estimate along the latest yaw by the distance the odometer advanced,
+        // and every valid fix re-anchors it.  Updates are delivered on the motion controller's thread.
+        class DeadReckoning : public kybernetes::controller::MotionController::callback,
+                              public kybernetes::sensor::IMU::callback,
+                              public kybernetes::sensor::GPS::callback
+        {
+        public:
+            // structure that contains the estimate
+            typedef struct _dead_reckoning_state
+            {
+                // Position in the local frame
+                kybernetes::math::LocalCoordinate position;
+
+                // Heading (compass degrees) the last step was taken along
+                double                            heading;
+
+                // Speed over the last telemetry frame in m/s
+                double                            speed;
+
+                // Distance travelled since the last anchoring fix, the error grows with this
+                double                            sinceFix;
+
+                // Monotonic time of the estimate in seconds
+                double                            timestamp;
+
+                // The estimate has been anchored by a fix at least once
+                bool                              valid;
+            } state;
+
+            // callback type for the estimate being updated.  Callback objects have
+            // to extend this class (DeadReckoning::callback)
+            class callback
+            {
+            public:
+                // Called when the estimate moves
+                virtual void odometry_event_update(state s) {}
+
+                // Called when a fix re-anchors the estimate
+                virtual void odometry_event_anchored(state s) {}
+            };
+
+        private:
+            // Lock the estimate while its being updated, the inputs arrive on three threads
+            boost::mutex                         m_mutex;
+
+            // Frame the estimate is in
+            kybernetes::math::LocalFrame         m_frame;
+
+            // The estimate
+            DeadReckoning::state                 m_state;
+
+            // Latest inputs
+            double                               m_yaw;
+            bool                                 m_haveYaw;
+            float                                m_odometer;
+            bool                                 m_haveOdometer;
+            double                               m_frameTime;
+            double                               m_metersPerUnit;
+
+            // Updated callback
+            std::list<DeadReckoning::callback *> m_callbacks;
+
+        public:
+            // Constructor for the object
+            DeadReckoning(const kybernetes::math::LocalFrame& frame, double metersPerUnit = ODOMETER_METERS_PER_UNIT);
+
+            // Obtaining data
+            DeadReckoning::state fetchState();
+            bool                 isReady();
+
+            // Callback registration
+            void registerCallback(DeadReckoning::callback *c);
+            void unregisterCallback(DeadReckoning::callback *c);
+
+            // Inputs to the estimate
+            void motors_event_update(kybernetes::controller::MotionController::state s);
+            void imu_event_update(kybernetes::sensor::IMU::state s);
+            void gps_event_update(kybernetes::sensor::GPS::state s);
+        };
+    }
+}
+
+#endif
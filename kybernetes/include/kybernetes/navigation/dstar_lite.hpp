@@ -0,0 +1,146 @@
+/*
+ *  dstar_lite.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_navigation_dstar_lite_h_
+#define _kybernetes_navigation_dstar_lite_h_
+
+// Children per node of the priority queue
+#define DSTAR_HEAP_ARITY 4
+
+// Language dependencies
+#include <vector>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // navigation namespace
+    namespace navigation
+    {
+        // Incremental shortest paths on an 8 connected grid (D* Lite, Koenig and Likhachev).  The
+        // search runs backward from the goal, so when cells are blocked or cleared as the robot
+        // drives, only the part of the search those changes invalidate is redone.  Diagonal moves
+        // may not cut the corner of a blocked cell.  Costs are integers (70 for a straight step,
+        // 99 for a diagonal) so keys that should tie do, with floats the search can stop early.
+        //
+        // Layout.  The per cell state lives in flat arrays (g, rhs, blocked, queue position) with
+        // a one cell blocked border, so neighbors never need bounds checks.  The priority queue
+        // is a 4-ary heap of 12 byte entries (key and cell), so the children of a node share a
+        // cache line and the heap is half as deep as a binary one, and a position array indexed
+        // by cell makes decrease-key and remove O(log n) without searching.
+        class DStarLite
+        {
+        public:
+            // A cell of the grid
+            typedef struct _dstar_lite_cell
+            {
+                int x;
+                int y;
+            } cell;
+
+        private:
+            // An entry in the priority queue
+            typedef struct _dstar_lite_entry
+            {
+                unsigned int k1;
+                unsigned int k2;
+                unsigned int node;
+            } entry;
+
+            // Grid size, and the row stride including the border
+            int                        m_width;
+            int                        m_height;
+            int                        m_stride;
+
+            // Per cell state
+            std::vector<unsigned int>  m_g;
+            std::vector<unsigned int>  m_rhs;
+            std::vector<unsigned char> m_blocked;
+            std::vector<int>           m_position;
+
+            // The priority queue
+            std::vector<entry>         m_heap;
+
+            // Search state
+            unsigned int               m_start;
+            unsigned int               m_goal;
+            unsigned int               m_last;
+            unsigned int               m_km;
+            bool                       m_initialized;
+
+            // Cells changed since the last plan, and the cells expanded by the last plan
+            std::vector<unsigned int>  m_changed;
+            unsigned int               m_expanded;
+
+            // Neighbor offsets and step costs
+            int                        m_offsets[8];
+            unsigned int               m_costs[8];
+
+            // Cell addressing
+            unsigned int index(int x, int y) const;
+            cell         coordinates(unsigned int node) const;
+
+            // Search primitives
+            unsigned int heuristic(unsigned int a, unsigned int b) const;
+            unsigned int cost(unsigned int a, int direction) const;
+            void         key(unsigned int node, unsigned int& k1, unsigned int& k2) const;
+            unsigned int lookahead(unsigned int node) const;
+            void         updateVertex(unsigned int node);
+            void         computeShortestPath();
+            void         initialize();
+
+            // Priority queue
+            bool  less(const entry& a, const entry& b) const;
+            void  place(int position, const entry& e);
+            void  siftUp(int position);
+            void  siftDown(int position);
+            void  push(unsigned int node, unsigned int k1, unsigned int k2);
+            void  update(unsigned int node, unsigned int k1, unsigned int k2);
+            void  remove(unsigned int node);
+
+        public:
+            // Constructor for the object, every cell starts free
+            DStarLite(int width, int height);
+
+            // Grid size
+            int  width() const;
+            int  height() const;
+
+            // Block or clear a cell.  Changes are applied by the next plan.
+            void setBlocked(int x, int y, bool blocked);
+            bool isBlocked(int x, int y) const;
+
+            // Move the start (the robot), or set a new goal (which restarts the search)
+            void setStart(int x, int y);
+            void setGoal(int x, int y);
+
+            // Bring the search up to date, true if the goal is reachable
+            bool plan();
+
+            // Cost of the path from the start (in cells, -1 without one) and the path itself
+            // (start to goal)
+            float cost() const;
+            bool  path(std::vector<cell>& cells) const;
+
+            // Cells expanded by the last plan
+            unsigned int expanded() const;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,233 @@
+/*
+ *  fusion_filter.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_navigation_fusion_filter_h_
+#define _kybernetes_navigation_fusion_filter_h_
+
+// Size of the sample history used to apply late samples in timestamp order
+#define FUSION_HISTORY 128
+
+// Pull in some boost utilities
+#include <boost/thread/thread.hpp>
+
+// Language dependencies
+#include <iostream>
+#include <string>
+#include <list>
+
+// Other kybernetes dependencies
+#include <kybernetes/controller/motion_controller.hpp>
+#include <kybernetes/sensor/imu.hpp>
+#include <kybernetes/sensor/gps.hpp>
+#include <kybernetes/math/local_frame.hpp>
+#include <kybernetes/math/matrix.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // navigation namespace
+    namespace navigation
+    {
+        // Extended Kalman filter over position, heading, speed and gyro bias.  Yaw increments
+        // drive the heading prediction, the odometer measures speed, and GPS fixes measure
+        // position.  Every sample is stamped on the monotonic clock and applied in timestamp order:
+        // a late sample (a GPS fix is stamped with its latency subtracted) rewinds the filter to the
+        // last state before it and replays the newer samples from a fixed size history.
+        class FusionFilter : public kybernetes::controller::MotionController::callback,
+                             public kybernetes::sensor::IMU::callback,
+                             public kybernetes::sensor::GPS::callback
+        {
+        public:
+            // Tuning for the filter
+            typedef struct _fusion_filter_parameters
+            {
+                // Noise on the measurements (m, m/s, degrees)
+                double gpsNoise;
+                double speedNoise;
+                double headingNoise;
+
+                // Process noise densities (degrees/s, m/s^2, degrees/s per root second)
+                double rateNoise;
+                double accelerationNoise;
+                double biasNoise;
+
+                // Uncertainty of the first heading taken from the yaw (degrees)
+                double initialHeadingError;
+
+                // Time from a GPS fix being measured until it is received (seconds)
+                double gpsLatency;
+
+                // The yaw is referenced to north (RazorIMU) rather than integrated from a gyro
+                bool   absoluteYaw;
+
+                // Odometer scale
+                double metersPerUnit;
+            } parameters;
+
+            // structure that contains the estimate
+            typedef struct _fusion_filter_state
+            {
+                // Position in the local frame
+                kybernetes::math::LocalCoordinate position;
+
+                // Compass heading in degrees, speed in m/s and gyro bias in degrees/s
+                double                            heading;
+                double                            speed;
+                double                            bias;
+
+                // One sigma uncertainty of the position (m) and heading (degrees)
+                double                            positionError;
+                double                            headingError;
+
+                // Monotonic time of the estimate in seconds
+                double                            timestamp;
+
+                // The filter has been initialized with a fix
+                bool                              valid;
+            } state;
+
+            // callback type for the estimate being updated.  Callback objects have
+            // to extend this class (FusionFilter::callback)
+            class callback
+            {
+            public:
+                // Called after every sample is applied
+                virtual void fusion_event_update(state s) {}
+            };
+
+            // Default tuning for the Garmin and the Razor
+            static parameters defaultParameters();
+
+        private:
+            // Layout of the state vector
+            enum
+            {
+                STATE_X = 0,
+                STATE_Y,
+                STATE_HEADING,
+                STATE_SPEED,
+                STATE_BIAS,
+                STATE_SIZE
+            };
+            typedef kybernetes::math::Matrix<STATE_SIZE, 1>          vector;
+            typedef kybernetes::math::Matrix<STATE_SIZE, STATE_SIZE> covariance;
+
+            // Kinds of samples
+            enum
+            {
+                SAMPLE_YAW = 0,
+                SAMPLE_ODOMETER,
+                SAMPLE_POSITION
+            };
+
+            // A sample from one of the sensors
+            typedef struct _fusion_filter_sample
+            {
+                int    type;
+                double timestamp;
+                double a;
+                double b;
+                double c;
+            } sample;
+
+            // Everything needed to resume the filter from a point in time
+            typedef struct _fusion_filter_snapshot
+            {
+                vector     x;
+                covariance P;
+                double     time;
+                double     rate;
+                double     lastYaw;
+                double     lastYawTime;
+                double     lastOdometer;
+                double     lastOdometerTime;
+                bool       haveYaw;
+                bool       haveOdometer;
+                bool       initialized;
+            } snapshot;
+
+            // A history entry, the sample and the filter after applying it
+            typedef struct _fusion_filter_entry
+            {
+                sample   s;
+                snapshot f;
+            } entry;
+
+            // Lock the filter while its being updated, the inputs arrive on three threads
+            boost::mutex                        m_mutex;
+
+            // Configuration
+            kybernetes::math::LocalFrame        m_frame;
+            parameters                          m_parameters;
+
+            // The current filter, the history of samples (a ring, oldest at m_head) and the
+            // filter as it was before the oldest sample in the history
+            snapshot                            m_current;
+            entry                               m_history[FUSION_HISTORY];
+            snapshot                            m_base;
+            double                              m_baseTime;
+            unsigned int                        m_head;
+            unsigned int                        m_count;
+            unsigned int                        m_dropped;
+
+            // Updated callback
+            std::list<FusionFilter::callback *> m_callbacks;
+
+            // Filter steps
+            void initialize();
+            void predict(snapshot& f, double time) const;
+            void apply(snapshot& f, const sample& s) const;
+            template <unsigned int M>
+            void correct(snapshot& f, const kybernetes::math::Matrix<M, 1>& innovation,
+                         const kybernetes::math::Matrix<M, STATE_SIZE>& H, const kybernetes::math::Matrix<M, M>& R) const;
+
+            // Sample ordering
+            entry& history(unsigned int index);
+            void   process(const sample& s);
+            void   submit(const sample& s);
+            state  toState(const snapshot& f) const;
+
+        public:
+            // Constructor for the object
+            FusionFilter(const kybernetes::math::LocalFrame& frame);
+            FusionFilter(const kybernetes::math::LocalFrame& frame, const parameters& p);
+
+            // Obtaining data
+            FusionFilter::state fetchState();
+            bool                isReady();
+            unsigned int        dropped();
+
+            // Callback registration
+            void registerCallback(FusionFilter::callback *c);
+            void unregisterCallback(FusionFilter::callback *c);
+
+            // Samples with explicit monotonic timestamps
+            void addYaw(double timestamp, double yaw);
+            void addOdometer(double timestamp, double odometer);
+            void addPosition(double timestamp, const kybernetes::math::LocalCoordinate& position, double error);
+
+            // Sensor callbacks, these stamp samples as they arrive
+            void motors_event_update(kybernetes::controller::MotionController::state s);
+            void imu_event_update(kybernetes::sensor::IMU::state s);
+            void gps_event_update(kybernetes::sensor::GPS::state s);
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ *  obstacle_map.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_navigation_obstacle_map_h_
+#define _kybernetes_navigation_obstacle_map_h_
+
+// Size of a tile, 2^6 = 64 cells on a side (one 4 KB page of cells)
+#define OBSTACLE_TILE_SHIFT 6
+#define OBSTACLE_TILE_SIZE  (1 << OBSTACLE_TILE_SHIFT)
+#define OBSTACLE_TILE_MASK  (OBSTACLE_TILE_SIZE - 1)
+#define OBSTACLE_TILE_BYTES (OBSTACLE_TILE_SIZE * OBSTACLE_TILE_SIZE)
+
+// Language dependencies
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+// Other kybernetes dependencies
+#include <kybernetes/math/local_frame.hpp>
+#include <kybernetes/navigation/dead_reckoning.hpp>
+#include <kybernetes/navigation/occupancy_grid.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // navigation namespace
+    namespace navigation
+    {
+        // Obstacles remembered from run to run of a course.  The map is kept in a local frame
+        // (the course's) as 8 bit log odds, in square tiles that only exist once something has
+        // been seen in them.  Tiles are addressed by quadkey, the tile coordinates with their bits
+        // interleaved, so a key's prefixes are the tiles of a quadtree over the frame and nearby
+        // tiles sort together.  An opened map keeps each tile in its own file in a directory,
+        // named by its key and memory mapped, so updates are written back by the kernel and only
+        // the tiles near the robot are in memory.  Without a directory the map lives in memory.
+        //
+        // Register the map with the sonar grid.  Like the PathPlanner, the pose in the map's frame
+        // comes from a DeadReckoning estimate anchored by the gps, and updates run on the sensor
+        // controller's thread.
+        class ObstacleMap : public OccupancyGrid::callback
+        {
+        public:
+            // Tuning
+            typedef struct _obstacle_map_parameters
+            {
+                // Size of a cell (m)
+                double       resolution;
+
+                // Range of the sonar grid copied on each update (m)
+                double       range;
+
+                // Log odds added for each update a cell is seen occupied or clear
+                int          hit;
+                int          miss;
+
+                // Cells above this log odds are obstacles
+                int          threshold;
+
+                // Tiles further than this from the robot's are unmapped (tiles)
+                int          keepRadius;
+            } parameters;
+
+            // Default tuning for the truck
+            static parameters defaultParameters();
+
+        private:
+            // A tile in memory
+            typedef struct _obstacle_map_tile
+            {
+                int8_t *cells;
+                int     descriptor;
+                int     x;
+                int     y;
+            } tile;
+
+            // Pose source, frame and configuration
+            DeadReckoning                    &m_odometry;
+            kybernetes::math::LocalFrame      m_frame;
+            parameters                        m_parameters;
+
+            // The directory tiles are kept in (empty when in memory) and the tiles mapped
+            std::string                       m_directory;
+            std::map<uint64_t, tile>          m_tiles;
+
+            // Maps are backed by files, don't copy them
+            ObstacleMap(const ObstacleMap&);
+            ObstacleMap& operator=(const ObstacleMap&);
+
+            // Tile addressing
+            static uint64_t quadkey(int tx, int ty);
+            std::string     filename(uint64_t key) const;
+
+            // Find a tile, mapping it from its file or creating it if asked to
+            int8_t* fetch(int tx, int ty, bool create);
+
+            // Unmap a tile
+            void    release(std::map<uint64_t, tile>::iterator it);
+
+            // Drop the tiles far from a tile
+            void    evict(int tx, int ty);
+
+        public:
+            // Constructor for the object, the map starts empty and in memory
+            ObstacleMap(DeadReckoning& odometry, const kybernetes::math::LocalFrame& frame);
+            ObstacleMap(DeadReckoning& odometry, const kybernetes::math::LocalFrame& frame, const parameters& p);
+            ~ObstacleMap();
+
+            // Keep the map in a directory, creating it if need be.  Fails if the directory can't
+            // be used or holds a map of another frame.
+            bool open(const std::string& directory);
+
+            // Write out and unmap every tile, the map goes back to being empty and in memory
+            void close();
+
+            // Schedule the mapped tiles to be written out
+            void flush();
+
+            // Global cell coordinates of a position
+            int cellX(double x) const;
+            int cellY(double y) const;
+
+            // Log odds of a cell, 0 (unknown) if its tile isn't mapped
+            int8_t at(int x, int y) const;
+
+            // Every obstacle between two corners, read from the files of tiles not mapped
+            void obstacles(const kybernetes::math::LocalCoordinate& low, const kybernetes::math::LocalCoordinate& high,
+                           std::vector<kybernetes::math::LocalCoordinate>& result) const;
+
+            // Map information
+            const parameters& configuration() const;
+            size_t            mapped() const;
+
+            // The sonar grid updated
+            void occupancy_event_update(const OccupancyGrid& grid);
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ *  occupancy_grid.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_navigation_occupancy_grid_h_
+#define _kybernetes_navigation_occupancy_grid_h_
+
+// Size of the grid, 2^7 = 128 cells on a side
+#define OCCUPANCY_GRID_SHIFT 7
+#define OCCUPANCY_GRID_SIZE  (1 << OCCUPANCY_GRID_SHIFT)
+#define OCCUPANCY_GRID_MASK  (OCCUPANCY_GRID_SIZE - 1)
+
+// Limit of the log odds stored in a cell
+#define OCCUPANCY_LIMIT      120
+
+// Language dependencies
+#include <stdint.h>
+#include <list>
+
+// Other kybernetes dependencies
+#include <kybernetes/controller/sensor_controller.hpp>
+#include <kybernetes/navigation/dead_reckoning.hpp>
+#include <kybernetes/math/local_frame.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // navigation namespace
+    namespace navigation
+    {
+        // Occupancy grid centered on the robot, built from the sonar ring.  The grid is aligned
+        // with the local frame and addressed by global cell coordinates (floor(x / resolution)),
+        // which wrap into a fixed block of cells, so following the robot only clears the rows and
+        // columns that scroll into view.  Cells hold saturating 8 bit log odds (positive is
+        // occupied, 0 is unknown) that decay back toward unknown over time.
+        //
+        // Register the grid with the sensor controller.  The pose for each reading comes from a
+        // DeadReckoning estimate; register that with the motion controller and the imu only, a
+        // fix snapping the pose would drag old returns along with it.  Updates and the callback
+        // run on the sensor controller's thread, read the grid from the callback.
+        class OccupancyGrid : public kybernetes::controller::SensorController::callback
+        {
+        public:
+            // Sonar geometry and the sensor model
+            typedef struct _occupancy_grid_parameters
+            {
+                // Size of a cell (m)
+                double       resolution;
+
+                // Mounting angle of each sonar (degrees clockwise from forward, left to right),
+                // the width of the beams (degrees) and the rays of free space traced across each
+                double       mountAngles[5];
+                double       beamWidth;
+                unsigned int rays;
+
+                // Readings are trusted within [minimum, maximum], beyond it only clear space (m)
+                double       minimumRange;
+                double       maximumRange;
+
+                // Log odds added at a return and along the beam before it
+                int          hit;
+                int          miss;
+
+                // Log odds lost per second by every cell
+                double       decayRate;
+
+                // Cells above this log odds count as obstacles
+                int          threshold;
+            } parameters;
+
+            // callback type for the grid being updated.  Callback objects have
+            // to extend this class (OccupancyGrid::callback)
+            class callback
+            {
+            public:
+                // Called after every sonar reading is applied
+                virtual void occupancy_event_update(const OccupancyGrid& grid) {}
+            };
+
+            // Default geometry for the sonar ring
+            static parameters defaultParameters();
+
+        private:
+            // Source of the pose and configuration
+            DeadReckoning                       &m_odometry;
+            parameters                           m_parameters;
+
+            // The cells (cache line aligned) and the global cell at the corner of the window
+            int8_t                              *m_cells;
+            int                                  m_originX;
+            int                                  m_originY;
+
+            // Pose of the last reading
+            kybernetes::math::LocalCoordinate    m_position;
+            double                               m_heading;
+
+            // Decay owed since the last update
+            double                               m_lastUpdate;
+            double                               m_pendingDecay;
+
+            // Updated callback
+            std::list<OccupancyGrid::callback *> m_callbacks;
+
+            // Grids are large, don't copy them
+            OccupancyGrid(const OccupancyGrid&);
+            OccupancyGrid& operator=(const OccupancyGrid&);
+
+            // Clear a row or column of the window
+            void clearRow(int y);
+            void clearColumn(int x);
+
+            // Add log odds to a cell in the window
+            void adjust(int x, int y, int amount);
+
+            // Clear the cells along a ray short of a range, and mark an arc at a range
+            void trace(const kybernetes::math::LocalCoordinate& from, double angle, double range);
+            void mark(const kybernetes::math::LocalCoordinate& from, double angle, double width, double range);
+
+        public:
+            // Constructor for the object
+            OccupancyGrid(DeadReckoning& odometry);
+            OccupancyGrid(DeadReckoning& odometry, const parameters& p);
+            ~OccupancyGrid();
+
+            // Callback registration
+            void registerCallback(OccupancyGrid::callback *c);
+            void unregisterCallback(OccupancyGrid::callback *c);
+
+            // Move the window to center on a position
+            void recenter(const kybernetes::math::LocalCoordinate& position);
+
+            // Apply a sonar reading taken at a pose (heading in compass degrees)
+            void insert(const kybernetes::math::LocalCoordinate& position, double heading, const kybernetes::controller::SensorController::state& s);
+
+            // Move every cell toward unknown by an amount of log odds
+            void decay(int amount);
+
+            // Forget everything
+            void clear();
+
+            // Global cell coordinates of a position
+            int cellX(double x) const;
+            int cellY(double y) const;
+
+            // Log odds of a cell, 0 (unknown) outside the window
+            int8_t at(int x, int y) const
+            {
+                if((unsigned int) (x - m_originX) >= OCCUPANCY_GRID_SIZE || (unsigned int) (y - m_originY) >= OCCUPANCY_GRID_SIZE)
+                    return 0;
+                return m_cells[((y & OCCUPANCY_GRID_MASK) << OCCUPANCY_GRID_SHIFT) | (x & OCCUPANCY_GRID_MASK)];
+            }
+            int8_t at(const kybernetes::math::LocalCoordinate& position) const;
+            bool   occupied(const kybernetes::math::LocalCoordinate& position) const;
+
+            // Grid information
+            const parameters&                        configuration() const;
+            const kybernetes::math::LocalCoordinate& position() const;
+            double                                   heading() const;
+            int                                      originX() const;
+            int                                      originY() const;
+
+            // Sensor callback
+            void sensors_event_update(kybernetes::controller::SensorController::state s);
+        };
+    }
+}
+
+#endif
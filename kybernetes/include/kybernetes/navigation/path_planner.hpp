@@ -0,0 +1,159 @@
+/*
+ *  path_planner.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_navigation_path_planner_h_
+#define _kybernetes_navigation_path_planner_h_
+
+// Language dependencies
+#include <vector>
+#include <list>
+
+// Other kybernetes dependencies
+#include <kybernetes/math/route.hpp>
+#include <kybernetes/navigation/dead_reckoning.hpp>
+#include <kybernetes/navigation/occupancy_grid.hpp>
+#include <kybernetes/navigation/dstar_lite.hpp>
+#include <kybernetes/navigation/obstacle_map.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // navigation namespace
+    namespace navigation
+    {
+        // Plans around obstacles on the way to each waypoint of a route.  A planning grid covers
+        // the route (plus a margin) in the route's frame, the obstacles seen by the sonar grid are
+        // copied into it, grown by the robot's radius, and D* Lite keeps a path from the robot to
+        // the next waypoint, repairing it as obstacles appear or clear.  The obstacles are kept for
+        // as long as the planner lives, unlike the sonar grid which forgets them as they leave view.
+        //
+        // Register the planner with the sonar grid.  The pose in the route frame comes from a
+        // DeadReckoning estimate anchored by the gps, the sonar grid's estimate (which is not) is
+        // only used to line the two up.  Planning and the callbacks run on the sensor controller's
+        // thread.
+        class PathPlanner : public OccupancyGrid::callback
+        {
+        public:
+            // Tuning
+            typedef struct _path_planner_parameters
+            {
+                // Size of a cell of the planning grid (m) and the margin around the route (m)
+                double resolution;
+                double margin;
+
+                // Obstacles are grown by the radius of the robot (m)
+                double robotRadius;
+
+                // Range of the sonar grid copied on each update (m)
+                double range;
+
+                // A waypoint within this distance has been reached (m)
+                double arrivalRadius;
+
+                // The path being followed is kept while it is clear and no more than this fraction
+                // longer than the best one, so the robot doesn't weave between equal ways around
+                double hysteresis;
+            } parameters;
+
+            // callback type for the path changing.  Callback objects have
+            // to extend this class (PathPlanner::callback)
+            class callback
+            {
+            public:
+                // Called with a new path to a waypoint (in the route's frame)
+                virtual void path_event_update(const kybernetes::math::Route& path, size_t waypoint) {}
+
+                // Called when there is no way to the waypoint
+                virtual void path_event_blocked(size_t waypoint) {}
+
+                // Called when the last waypoint is reached
+                virtual void path_event_finished() {}
+            };
+
+            // Default tuning for the truck
+            static parameters defaultParameters();
+
+        private:
+            // The route, the pose source and configuration
+            const kybernetes::math::Route      &m_route;
+            DeadReckoning                      &m_odometry;
+            parameters                          m_parameters;
+
+            // The planning grid, the local frame position of its corner, and the obstacles seen in
+            // each of its cells (before growing)
+            DStarLite                           m_planner;
+            kybernetes::math::LocalCoordinate   m_corner;
+            std::vector<unsigned char>          m_obstacles;
+            int                                 m_inflation;
+
+            // Waypoint being planned to (and the one the search is rooted at), the cell the robot is
+            // in and whether the last plan found a way
+            size_t                              m_waypoint;
+            size_t                              m_goal;
+            DStarLite::cell                     m_robot;
+            bool                                m_reachable;
+            bool                                m_finished;
+
+            // The path being followed (cells)
+            std::vector<DStarLite::cell>        m_path;
+
+            // Path changed callback
+            std::list<PathPlanner::callback *>  m_callbacks;
+
+            // Lay out the grid over the route
+            void layout();
+
+            // Cell of a position in the planning grid
+            DStarLite::cell cellOf(const kybernetes::math::LocalCoordinate& position) const;
+
+            // Bring the blocked state of the cells near a cell up to date
+            void refresh(int x, int y, int radius);
+
+            // Copy the obstacles around the robot out of the sonar grid
+            bool transfer(const OccupancyGrid& grid, const kybernetes::math::LocalCoordinate& offset);
+
+            // Is the path being followed still good compared to a new one
+            bool keep(const std::vector<DStarLite::cell>& path) const;
+
+            // Send the path to the listeners
+            void publish(const std::vector<DStarLite::cell>& path);
+
+        public:
+            // Constructor for the object
+            PathPlanner(const kybernetes::math::Route& route, DeadReckoning& odometry);
+            PathPlanner(const kybernetes::math::Route& route, DeadReckoning& odometry, const parameters& p);
+
+            // Callback registration
+            void registerCallback(PathPlanner::callback *c);
+            void unregisterCallback(PathPlanner::callback *c);
+
+            // Waypoint being planned to
+            size_t waypoint() const;
+
+            // Mark the obstacles a map remembers from earlier runs (the map must be kept in the
+            // route's frame).  Call before the first update, returns the number of cells marked.
+            unsigned int seed(const ObstacleMap& map);
+
+            // The sonar grid updated
+            void occupancy_event_update(const OccupancyGrid& grid);
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ *  pure_pursuit.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_navigation_pure_pursuit_h_
+#define _kybernetes_navigation_pure_pursuit_h_
+
+// Other kybernetes dependencies
+#include <kybernetes/math/local_frame.hpp>
+#include <kybernetes/math/route.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // navigation namespace
+    namespace navigation
+    {
+        // Pure pursuit path follower.  Each call finds the vehicle on the route, picks the point
+        // a speed dependent distance further along it, and returns the curvature of the arc from
+        // the vehicle through that point along with the wheel angle and drift that drive it.
+        // A call is a windowed route lookup and a few multiplies, cheap enough to run on every
+        // gyro update against a dead reckoned pose.
+        class PurePursuit
+        {
+        public:
+            // Vehicle geometry and tuning
+            typedef struct _pure_pursuit_parameters
+            {
+                // Distance between the axles (m)
+                double wheelbase;
+
+                // Lookahead distance is lookaheadTime * speed, clamped to [minimum, maximum] (m, s)
+                double minimumLookahead;
+                double maximumLookahead;
+                double lookaheadTime;
+
+                // Largest wheel angle (degrees) and the drift per degree of wheel angle
+                double maximumSteering;
+                double driftPerDegree;
+
+                // Distance from the last waypoint at which the route is finished (m)
+                double arrivalRadius;
+
+                // Window the route is searched in around the last position (m behind, m ahead)
+                double searchBehind;
+                double searchAhead;
+            } parameters;
+
+            // The steering decision
+            typedef struct _pure_pursuit_command
+            {
+                // Where the vehicle is on the route and the point it is steering for
+                kybernetes::math::Route::progress progress;
+                kybernetes::math::LocalCoordinate target;
+                double                            lookahead;
+
+                // Curvature of the arc to the target (1/m) and the wheel angle (degrees),
+                // both positive turning right
+                double                            curvature;
+                double                            steering;
+
+                // Value for MotionController::setDrift (negative drift turns right)
+                short                             drift;
+
+                // Distance left along the route (m) and whether the last waypoint is reached
+                double                            remaining;
+                bool                              finished;
+            } command;
+
+            // Default tuning for the truck
+            static parameters defaultParameters();
+
+        private:
+            // The route being followed
+            const kybernetes::math::Route&    m_route;
+            parameters                        m_parameters;
+
+            // Furthest position reached on the route, the lookahead and the next lookup start here
+            kybernetes::math::Route::progress m_progress;
+            bool                              m_tracking;
+
+        public:
+            // Constructor for the object
+            PurePursuit(const kybernetes::math::Route& route);
+            PurePursuit(const kybernetes::math::Route& route, const parameters& p);
+
+            // Compute the steering for a pose (heading in compass degrees) and speed (m/s)
+            command steer(const kybernetes::math::LocalCoordinate& position, double heading, double speed);
+
+            // Forget the last position, the next call searches the whole route
+            void    reset();
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ *  route_optimizer.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _kybernetes_navigation_route_optimizer_h_
+#define _kybernetes_navigation_route_optimizer_h_
+
+// Largest number of waypoints ordered exactly, the search is O(2^n n^2)
+#define ROUTE_OPTIMIZER_EXACT_LIMIT 15
+
+// Language dependencies
+#include <vector>
+
+// Other kybernetes dependencies
+#include <kybernetes/math/local_frame.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // navigation namespace
+    namespace navigation
+    {
+        // Finds the shortest order to visit a course's waypoints in.  The route starts at the first
+        // waypoint (the start line) and, unless it is left open, finishes at the last (the final
+        // cone), every waypoint between is visited once in whatever order is shortest.  Distances
+        // are straight lines in a local frame, computed once into a matrix.
+        //
+        // Up to ROUTE_OPTIMIZER_EXACT_LIMIT waypoints the order is exact (Held-Karp, dynamic
+        // programming over the subsets visited).  Beyond that a nearest neighbor route is improved
+        // with 2-opt (reversing a stretch) and Or-opt (moving a chain of up to three waypoints)
+        // until neither shortens it, which is usually within a few percent of the best.
+        class RouteOptimizer
+        {
+            // Number of waypoints and the distances between them (row major)
+            size_t              m_size;
+            std::vector<double> m_distances;
+
+            // Distance between two waypoints
+            double distance(size_t a, size_t b) const;
+
+            // Exact order by dynamic programming
+            std::vector<size_t> exact(bool fixedEnd) const;
+
+            // Heuristic order, the route is improved in place
+            void                nearestNeighbor(std::vector<size_t>& order, bool fixedEnd) const;
+            bool                twoOpt(std::vector<size_t>& order, bool fixedEnd) const;
+            bool                orOpt(std::vector<size_t>& order, bool fixedEnd) const;
+
+        public:
+            // Constructor for the object, takes the waypoints in a local frame
+            RouteOptimizer(const std::vector<kybernetes::math::LocalCoordinate>& waypoints);
+
+            // Shortest order to visit the waypoints in (indices into the waypoints), starting at the
+            // first and, if fixedEnd, finishing at the last
+            std::vector<size_t> solve(bool fixedEnd = true) const;
+
+            // Length of a route through the waypoints in an order (m)
+            double              length(const std::vector<size_t>& order) const;
+
+            // Whether solve gives the exact order
+            bool                isExact() const;
+        };
+    }
+}
+
+#endif
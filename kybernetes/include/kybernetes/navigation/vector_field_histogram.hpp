@@ -0,0 +1,145 @@
+/*
+ *  vector_field_histogram.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_navigation_vector_field_histogram_h_
+#define _kybernetes_navigation_vector_field_histogram_h_
+
+// Number of sectors in the polar histogram (5 degrees each)
+#define VFH_SECTORS 72
+
+// Language dependencies
+#include <vector>
+
+// Other kybernetes dependencies
+#include <kybernetes/navigation/occupancy_grid.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // navigation namespace
+    namespace navigation
+    {
+        // Obstacle avoidance in the style of VFH+.  The occupied cells around the robot are
+        // binned by bearing into a polar histogram, each one spread over the sectors the robot
+        // (grown by a safety margin) would hit it in, and weighted by certainty and nearness.
+        // The histogram is thresholded with hysteresis into blocked and free sectors, and among
+        // the free valleys within reach of the current heading the direction closest to the goal
+        // (and to the last choice, so it doesn't dither) is picked.
+        //
+        // Everything that depends only on the geometry, the sector and spread of each cell offset
+        // in the window, is computed once by the constructor, so an update is one pass over the
+        // window and a few passes over the sectors with no allocation.
+        class VectorFieldHistogram
+        {
+        public:
+            // Tuning
+            typedef struct _vector_field_histogram_parameters
+            {
+                // Radius of the window of cells considered (m)
+                double windowRadius;
+
+                // Radius of the robot plus the clearance to keep from obstacles (m)
+                double robotRadius;
+                double safetyMargin;
+
+                // Hysteresis thresholds on the histogram
+                double highThreshold;
+                double lowThreshold;
+
+                // Directions further than this from the current heading are out of reach (degrees)
+                double maximumTurn;
+
+                // Valleys wider than this are wide, the robot keeps to their edges (sectors)
+                unsigned int wideValley;
+
+                // Cost weights of the distance from the goal, the heading and the last direction
+                double goalWeight;
+                double headingWeight;
+                double previousWeight;
+
+                // Steering gain and limit for the drift (drift per degree of error, drift)
+                double driftPerDegree;
+                short  maximumDrift;
+            } parameters;
+
+            // The decision
+            typedef struct _vector_field_histogram_result
+            {
+                // Direction to travel in (compass degrees) and its error from the heading
+                double direction;
+                double error;
+
+                // Value for MotionController::setDrift (negative drift turns right)
+                short  drift;
+
+                // Every direction within reach is blocked
+                bool   blocked;
+            } result;
+
+            // Default tuning for the truck
+            static parameters defaultParameters();
+
+        private:
+            // A cell offset within the window
+            typedef struct _vector_field_histogram_cell
+            {
+                short dx;
+                short dy;
+                short sector;
+                short spread;
+                float weight;
+            } cell;
+
+            // Configuration and the precomputed window
+            parameters        m_parameters;
+            double            m_resolution;
+            std::vector<cell> m_window;
+
+            // Histograms, the binary one is kept between updates for the hysteresis
+            float             m_histogram[VFH_SECTORS];
+            bool              m_blocked[VFH_SECTORS];
+
+            // Last direction picked (sector) and whether there is one
+            int               m_previous;
+            bool              m_havePrevious;
+
+            // Precompute the window
+            void   layout();
+
+            // Sector utilities
+            int    sectorOf(double bearing) const;
+            double bearingOf(int sector) const;
+            int    distance(int a, int b) const;
+            double cost(int sector, int goal, int heading) const;
+
+        public:
+            // Constructor for the object, the window is laid out for grids of a resolution
+            VectorFieldHistogram(const OccupancyGrid::parameters& grid);
+            VectorFieldHistogram(const OccupancyGrid::parameters& grid, const parameters& p);
+
+            // Pick a direction from the grid, at the grid's pose, toward a goal (compass degrees)
+            result compute(const OccupancyGrid& grid, double goal);
+
+            // Access the last histogram
+            const float* histogram() const;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ *  auto_exposure.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _kybernetes_sensor_auto_exposure_h_
+#define _kybernetes_sensor_auto_exposure_h_
+
+// Other kybernetes dependencies
+#include <kybernetes/sensor/frame_source.hpp>
+#include <kybernetes/sensor/uvccamera.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // sensor namespace
+    namespace sensor
+    {
+        // Exposure control run on the host.  The camera's own auto exposure meters for pictures
+        // and hunts whenever the scene changes, which moves the colors the tracker thresholds on,
+        // so this takes exposure and gain over and holds the mean luma at a target instead.
+        // The luma is measured on a subsampled grid of the Y channel of each frame, and exposure
+        // is corrected by a fraction of the (logarithmic) error.  Gain is only raised once the
+        // exposure is as long as the frame rate allows, and lowered first.  After a change the
+        // camera is left a few frames to apply it, and nothing is written while the luma is
+        // within the deadband, so running on every frame costs a transfer only now and then.
+        //
+        // Update from the thread which processes the frames (the camera's controls should only
+        // be set from one thread).  Destroying it gives exposure back to the camera.
+        class AutoExposure
+        {
+        public:
+            // Tuning
+            typedef struct _auto_exposure_parameters
+            {
+                // Mean luma held and the error tolerated around it
+                double       target;
+                double       deadband;
+
+                // Fraction of the error corrected at once
+                double       correction;
+
+                // Lumas at or above this are clipped, and more than this fraction of them counts
+                // as overexposed whatever the mean
+                int          clipped;
+                double       maximumClipped;
+
+                // Distance between the pixels measured (in both directions)
+                unsigned int stride;
+
+                // Frames left for the camera to apply a change
+                unsigned int settle;
+
+                // Longest exposure, in the camera's units of 100 us (a frame at 30 fps)
+                int          maximumExposure;
+
+                // Amplification at the top of the gain's range (taken as linear from none at the
+                // bottom)
+                double       gainRange;
+            } parameters;
+
+            // The last measurement and the settings
+            typedef struct _auto_exposure_status
+            {
+                double       mean;
+                double       clipped;
+                int          exposure;
+                int          gain;
+                unsigned int changes;
+            } status;
+
+            // Default tuning for the truck's camera
+            static parameters defaultParameters();
+
+        private:
+            // The camera and configuration
+            UVCCamera   &m_camera;
+            parameters   m_parameters;
+
+            // Ranges of the controls, whether the camera has them and the current state
+            int          m_exposureMinimum;
+            int          m_exposureMaximum;
+            int          m_gainMinimum;
+            int          m_gainMaximum;
+            bool         m_available;
+            bool         m_hasGain;
+            status       m_status;
+            unsigned int m_wait;
+
+            // Measure the luma of a frame (false if the format has no luma to measure)
+            bool measure(const Frame& frame, unsigned int width, unsigned int height, unsigned int format);
+
+            // Auto exposure drives a camera, don't copy it
+            AutoExposure(const AutoExposure&);
+            AutoExposure& operator=(const AutoExposure&);
+
+        public:
+            // Constructor for the object, takes manual control of the camera's exposure
+            AutoExposure(UVCCamera& camera, const parameters& p = defaultParameters());
+            ~AutoExposure();
+
+            // Whether the camera's exposure can be controlled
+            bool   isAvailable() const;
+
+            // Change the mean luma held
+            void   setTarget(double target);
+
+            // Measure a frame (YUYV or planar YUV) of the camera's and correct the exposure.
+            // Returns 1 if the frame couldn't be measured.
+            int    update(const Frame& frame, unsigned int width, unsigned int height, unsigned int format);
+
+            // The last measurement and settings
+            status state() const;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ *  camera_group.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _kybernetes_sensor_camera_group_h_
+#define _kybernetes_sensor_camera_group_h_
+
+// Frames kept per camera for pairing, each holds one of the camera's buffers
+#define CAMERA_GROUP_HISTORY 3
+
+// Pull in some boost utilities
+#include <boost/thread/thread.hpp>
+#include <boost/smart_ptr/shared_ptr.hpp>
+
+// Language dependencies
+#include <vector>
+#include <deque>
+#include <list>
+
+// Other kybernetes dependencies
+#include <kybernetes/sensor/uvccamera.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // sensor namespace
+    namespace sensor
+    {
+        // Services several cameras from one thread.  The thread waits on all of the cameras at once
+        // (epoll) and takes each frame the moment it is ready, so a second camera costs no thread
+        // and no camera waits behind another.  Frames from the cameras are paired by capture time:
+        // each new frame is matched with the closest recent frame of every other camera, and if
+        // they were all captured within a tolerance the set is passed on.
+        //
+        // The cameras should run latest only, with buffers for CAMERA_GROUP_HISTORY frames plus
+        // the frames the listeners hold on to.  They must outlive the group.  Sources that can't
+        // be waited on (recordings, generators) can be grouped too, by handing over their frames.
+        class CameraGroup
+        {
+        public:
+            // callback type for frames arriving.  Callback objects have to extend this class
+            // (CameraGroup::callback)
+            class callback
+            {
+            public:
+                // Called with each frame from a camera (index in the group)
+                virtual void camera_event_frame(size_t camera, const Frame& frame) {}
+
+                // Called with a frame from every camera, in the group's order, captured within
+                // the tolerance of each other
+                virtual void camera_event_set(const std::vector<Frame>& frames) {}
+            };
+
+        private:
+            // Thread which services the cameras
+            boost::shared_ptr<boost::thread>      m_thread;
+            void                                  do_servicing();
+
+            // Lock for the callbacks, the recent frames and the last set
+            boost::mutex                          m_mutex;
+
+            // The cameras, the epoll instance waiting on them and the tolerance for a set (s)
+            std::vector<UVCCamera *>              m_cameras;
+            int                                   m_epoll;
+            double                                m_tolerance;
+
+            // Recent frames of each camera, newest last
+            std::vector<std::deque<Frame> >       m_history;
+
+            // The last set and the number of sets made
+            std::vector<Frame>                    m_set;
+            unsigned long                         m_sets;
+
+            // Frame callbacks
+            std::list<CameraGroup::callback *>    m_callbacks;
+
+            // Try to make a set around a camera's newest frame (m_mutex is held)
+            bool match(size_t camera, std::vector<Frame>& set) const;
+
+            // The group owns a thread, don't copy it
+            CameraGroup(const CameraGroup&);
+            CameraGroup& operator=(const CameraGroup&);
+
+        public:
+            // Constructor for the object, starts servicing the cameras
+            CameraGroup(const std::vector<UVCCamera *>& cameras, double tolerance = 0.02);
+
+            // A group of sources serviced elsewhere, their frames are handed over with insert()
+            CameraGroup(size_t sources, double tolerance = 0.02);
+            ~CameraGroup();
+
+            // Pair a frame of a camera (index in the group) with the others and pass it on, as the
+            // thread does with every frame it takes
+            void insert(size_t camera, const Frame& frame);
+
+            // Callback registration
+            void registerCallback(CameraGroup::callback *c);
+            void unregisterCallback(CameraGroup::callback *c);
+
+            // The last set of frames (false if there hasn't been one), and how many there have been
+            bool          latest(std::vector<Frame>& frames);
+            unsigned long sets();
+        };
+    }
+}
+
+#endif
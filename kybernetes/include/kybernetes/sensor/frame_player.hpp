@@ -0,0 +1,96 @@
+/*
+ *  frame_player.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _kybernetes_sensor_frame_player_h_
+#define _kybernetes_sensor_frame_player_h_
+
+// Language dependencies
+#include <string>
+
+// Other kybernetes dependencies
+#include <kybernetes/sensor/frame_source.hpp>
+#include <kybernetes/sensor/frame_recorder.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // sensor namespace
+    namespace sensor
+    {
+        // Plays back a raw YUYV recording (frames of width * height * 2 bytes, one after another,
+        // as blobtrackd's images are) or a FrameRecorder's recording, which gives its own size and
+        // format and an index of the frames.  The file is memory mapped and frames point straight
+        // into it, so playback copies nothing and the page cache does the reading.  Played at a
+        // rate it behaves like a latest only camera, at a rate of 0 it gives every frame as fast
+        // as they are asked for.  Frames are stamped with when they are played, the time they were
+        // recorded at is in the index.
+        class FramePlayer : public FrameSource
+        {
+            // The mapped file, shared with the frames, and what a frame holds
+            struct recording;
+            struct lease;
+            boost::shared_ptr<recording> m_recording;
+
+            // Image size and format, bytes per frame (of a raw recording), the number of frames
+            // and the index (of a FrameRecorder's recording, in the mapping)
+            unsigned int                 m_width;
+            unsigned int                 m_height;
+            unsigned int                 m_format;
+            size_t                       m_frameSize;
+            size_t                       m_frames;
+            const FrameRecorder::entry  *m_index;
+
+            // Playback timing, whether to start over at the end, where the pacer's count starts
+            // in the recording and its count after the last frame
+            FramePacer                   m_pacer;
+            bool                         m_loop;
+            unsigned long                m_base;
+            unsigned long                m_next;
+
+            // Recordings are mapped, don't copy them
+            FramePlayer(const FramePlayer&);
+            FramePlayer& operator=(const FramePlayer&);
+
+        public:
+            // Constructor for the object, opens a recording of images of a size
+            FramePlayer(const std::string& path, unsigned int width, unsigned int height, double rate = 30.0, bool loop = true);
+
+            // Whether the recording could be opened, and how many frames it holds
+            bool          isOpen() const;
+            size_t        frames() const;
+
+            // Play from a frame on
+            void          seek(size_t frame);
+
+            // The index entry of a frame, with when it was recorded and the pose of the turret
+            // (false if the recording has no index)
+            bool          recorded(size_t frame, FrameRecorder::entry& e) const;
+
+            // Frame source
+            int           capture(Frame& frame);
+            unsigned int  imageWidth() const;
+            unsigned int  imageHeight() const;
+            unsigned int  imageFormat() const;
+            unsigned long dropped() const;
+        };
+    }
+}
+
+#endif
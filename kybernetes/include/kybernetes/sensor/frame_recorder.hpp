@@ -0,0 +1,164 @@
+/*
+ *  frame_recorder.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _kybernetes_sensor_frame_recorder_h_
+#define _kybernetes_sensor_frame_recorder_h_
+
+// Recording container, identified by its first bytes.  Blocks are aligned for direct io.
+#define FRAME_RECORDING_MAGIC     "KYBFRAME"
+#define FRAME_RECORDING_VERSION   1
+#define FRAME_RECORDING_ALIGNMENT 4096
+
+// Pull in some boost utilities
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/smart_ptr/shared_ptr.hpp>
+
+// Language dependencies
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+// Other kybernetes dependencies
+#include <kybernetes/sensor/frame_source.hpp>
+#include <kybernetes/sensor/uvccamera.hpp>
+#include <kybernetes/sensor/ptz_worker.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // sensor namespace
+    namespace sensor
+    {
+        // Records frames to disk at the camera's full rate.  Frames are copied into large aligned
+        // chunks which a thread writes out with direct io (O_DIRECT), so a recording neither waits
+        // on the disk nor fills the page cache with video.  If the disk falls so far behind that
+        // every chunk is waiting to be written, frames are dropped rather than stall the caller.
+        //
+        // The recording is a header block, the frames one after another (each starting on 64
+        // bytes) and an index of every frame (its offset, size, timestamp and the pose of the
+        // turret), which is written when the recording is closed.  A FramePlayer plays it back,
+        // seeking with the index.
+        //
+        // Register the recorder with a camera to record every frame the camera captures, including
+        // the ones a latest only capture skips.
+        class FrameRecorder : public UVCCamera::callback
+        {
+        public:
+            // The first block of a recording
+            typedef struct _frame_recording_header
+            {
+                char     magic[8];
+                uint32_t version;
+                uint32_t width;
+                uint32_t height;
+                uint32_t format;
+                uint64_t frames;
+                uint64_t index;
+            } header;
+
+            // A frame in the index.  The turret is moving if the frame came before the time it
+            // should have reached the pose.
+            typedef struct _frame_recording_entry
+            {
+                uint64_t offset;
+                uint32_t size;
+                uint32_t sequence;
+                double   timestamp;
+                int16_t  pan;
+                int16_t  tilt;
+                uint32_t moving;
+            } entry;
+
+        private:
+            // Thread which writes the chunks
+            boost::shared_ptr<boost::thread>   m_thread;
+            boost::mutex                       m_mutex;
+            boost::condition_variable          m_changed;
+            void do_writing();
+
+            // The file, where the next chunk written goes, where the chunk being filled goes and
+            // whether it is written directly
+            int                                m_descriptor;
+            uint64_t                           m_written;
+            uint64_t                           m_position;
+            bool                               m_direct;
+            header                             m_header;
+
+            // The chunks, those free, those waiting to be written, the one being filled and how
+            // much of it is
+            size_t                             m_chunkSize;
+            std::vector<unsigned char *>       m_chunks;
+            std::vector<unsigned char *>       m_free;
+            std::deque<unsigned char *>        m_full;
+            unsigned char                     *m_chunk;
+            size_t                             m_fill;
+
+            // The index, the bytes recorded and frames dropped, and whether writing failed or
+            // the recording is being closed
+            std::vector<entry>                 m_index;
+            uint64_t                           m_bytes;
+            unsigned long                      m_dropped;
+            bool                               m_failed;
+            bool                               m_closing;
+
+            // The turret frames from a camera are stamped with the pose of
+            PTZWorker                         *m_turret;
+
+            // Write a block out, and the header block (m_mutex is not held)
+            bool write(const void *data, size_t length, uint64_t offset);
+            bool writeHeader();
+
+            // Recorders own a file and a thread, don't copy them
+            FrameRecorder(const FrameRecorder&);
+            FrameRecorder& operator=(const FrameRecorder&);
+
+        public:
+            // Constructor for the object, creates a recording of images of a size and V4L2 pixel
+            // format, written in chunks of a size (a multiple of the alignment)
+            FrameRecorder(const std::string& path, unsigned int width, unsigned int height, unsigned int format,
+                          size_t chunkSize = 4 << 20, unsigned int chunks = 4);
+            ~FrameRecorder();
+
+            // Whether the recording could be created, and is still being written
+            bool          isOpen();
+
+            // Record a frame (returns 0 if it was, 1 if it was dropped)
+            int           record(const Frame& frame, int pan = 0, int tilt = 0, bool moving = false);
+
+            // Stamp the frames from a camera with the pose of its turret
+            void          setTurret(PTZWorker *turret);
+
+            // Write out the rest of the frames and the index and close the file
+            void          close();
+
+            // Frames recorded and dropped, and the bytes of frames recorded
+            unsigned long frames();
+            unsigned long dropped();
+            uint64_t      bytes();
+
+            // A camera captured a frame
+            void          camera_event_frame(const Frame& frame);
+        };
+    }
+}
+
+#endif
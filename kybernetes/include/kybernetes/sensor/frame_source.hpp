@@ -0,0 +1,127 @@
+/*
+ *  frame_source.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _kybernetes_sensor_frame_source_h_
+#define _kybernetes_sensor_frame_source_h_
+
+// Language dependencies
+#include <cstddef>
+#include <string>
+
+// Pull in some boost utilities
+#include <boost/shared_ptr.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // sensor namespace
+    namespace sensor
+    {
+        // A frame from a FrameSource, pointing straight at the source's buffer.  Copies of a frame
+        // share the buffer by reference count, so capture, processing and serving can each hold the
+        // same frame from their own threads, and the buffer goes back to the source when the last
+        // copy is dropped.  Frames may outlive their source.
+        class Frame
+        {
+        public:
+            // What a frame holds.  Sources extend this to keep their buffer until it is destroyed.
+            struct lease
+            {
+                const void   *data;
+                size_t        size;
+                double        timestamp;
+                unsigned int  sequence;
+
+                lease() : data(NULL), size(0), timestamp(0.0), sequence(0) {}
+                virtual ~lease() {}
+            };
+
+            // An empty frame, or one holding a lease
+            Frame();
+            Frame(const boost::shared_ptr<lease>& l);
+
+            // Whether this holds a frame
+            bool         empty() const;
+
+            // The image, its size in bytes, when it was captured (monotonic seconds) and the
+            // source's count of frames up to it
+            const void*  data() const;
+            size_t       size() const;
+            double       timestamp() const;
+            unsigned int sequence() const;
+
+            // Drop this copy's hold on the buffer
+            void         release();
+
+        private:
+            // The buffer held, shared by the copies
+            boost::shared_ptr<lease> m_lease;
+        };
+
+        // Something that produces images: a camera, a recording or a generator, so the vision code
+        // can be run (and timed) without the truck's camera
+        class FrameSource
+        {
+        public:
+            virtual ~FrameSource() {}
+
+            // Capture the next frame (0 on success, 1 on an error or the end of the images)
+            virtual int           capture(Frame& frame) = 0;
+
+            // Size (pixels) and V4L2 pixel format of the images
+            virtual unsigned int  imageWidth() const = 0;
+            virtual unsigned int  imageHeight() const = 0;
+            virtual unsigned int  imageFormat() const = 0;
+
+            // Frames produced but never returned by capture
+            virtual unsigned long dropped() const = 0;
+        };
+
+        // Paces a source that isn't a camera like one.  Frames come due at a rate from the first
+        // capture, a capture waits for the next to come due or, if it is late, takes the newest
+        // due and counts the ones skipped, as a latest only camera would.  At a rate of 0 every
+        // frame is produced, as fast as they are asked for.
+        class FramePacer
+        {
+            double        m_rate;
+            double        m_start;
+            unsigned long m_next;
+            unsigned long m_dropped;
+
+        public:
+            // Constructor for the object
+            FramePacer(double rate);
+
+            // Index of the frame to produce and when it was (or would have been) captured
+            unsigned long next(double& timestamp);
+
+            // Frames skipped
+            unsigned long dropped() const;
+        };
+
+        // Open a source by name: a device ("/dev/video0") is a UVCCamera, "synthetic" is a
+        // SyntheticCamera, anything else is a recording for a FramePlayer.  Recordings and
+        // synthetic images play at the rate given, as fast as they can with a rate of 0.
+        // Returns NULL if the source couldn't be opened.
+        FrameSource* openFrameSource(const std::string& name, unsigned int width, unsigned int height, double rate = 30.0);
+    }
+}
+
+#endif
@@ -54,6 +54,9 @@ namespace kybernetes
             class callback
             {
             public:
+                // Callbacks may be deleted through this class
+                virtual ~callback() {}
+                
                 // Called to perform the callback
                 virtual void gps_event_update(state s) {}
                 
@@ -70,6 +73,9 @@ namespace kybernetes
                 }
             };
             
+            // Implementations are deleted through this class
+            virtual ~GPS() {}
+            
             // Obtaining data
             virtual state fetchState() = 0;
             
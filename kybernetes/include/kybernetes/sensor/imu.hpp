@@ -49,6 +49,9 @@ namespace kybernetes
             class callback
             {
             public:
+                // Callbacks may be deleted through this class
+                virtual ~callback() {}
+                
                 // Called to perform the callback
                 virtual void imu_event_update(state s) {}
                 
@@ -65,6 +68,9 @@ namespace kybernetes
                 }
             };
             
+            // Implementations are deleted through this class
+            virtual ~IMU() {}
+            
             // Obtaining data
             virtual state fetchState() = 0;
             
@@ -0,0 +1,94 @@
+/*
+ *  mjpeg_decoder.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _kybernetes_sensor_mjpeg_decoder_h_
+#define _kybernetes_sensor_mjpeg_decoder_h_
+
+// Language dependencies
+#include <vector>
+
+// Other kybernetes dependencies
+#include <kybernetes/sensor/frame_source.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // sensor namespace
+    namespace sensor
+    {
+        // Decodes the frames of an MJPEG source (a UVCCamera opened with V4L2_PIX_FMT_MJPEG).  The
+        // cameras send MJPEG at full frame rate at sizes where YUYV crawls, so this is how to get
+        // 30 fps at 640x480 and up.  Frames are decoded with libjpeg-turbo straight to planar YUV,
+        // skipping the color conversion and upsampling entirely, and can be scaled to 1/2 or 1/4
+        // in the DCT, which costs less than a full decode does.
+        //
+        // A decoded frame is the Y plane, then the U and V planes, each tightly packed.  The
+        // format is V4L2_PIX_FMT_YUV422P (chroma at half width, as the cameras send) or
+        // V4L2_PIX_FMT_YUV420 (half width and height) following the stream.  Frames are decoded
+        // into a pool of buffers which go back to the pool when the last copy of the frame is
+        // dropped, so the pool grows to the number of frames held at once and no more.  Frames
+        // which fail to decode (cameras do send corrupt ones) are skipped and counted as dropped.
+        class MJPEGDecoder : public FrameSource
+        {
+            // The buffers for decoded frames, shared with the frames, and what a frame holds
+            struct pool;
+            struct lease;
+            boost::shared_ptr<pool>     m_pool;
+
+            // The source and the scale the images are decoded at (1, 2, 4 or 8 times smaller)
+            FrameSource                &m_source;
+            unsigned int                m_scale;
+
+            // Decoded size and format, and frames which failed to decode
+            unsigned int                m_width;
+            unsigned int                m_height;
+            unsigned int                m_format;
+            unsigned long               m_failed;
+
+            // A strip of an iMCU row of each component, libjpeg writes whole blocks
+            std::vector<unsigned char>  m_strip;
+
+            // Decode a compressed image into a buffer (0 on success)
+            int decode(const Frame& compressed, std::vector<unsigned char>& image);
+
+            // The decoder holds buffers shared with its frames, don't copy it
+            MJPEGDecoder(const MJPEGDecoder&);
+            MJPEGDecoder& operator=(const MJPEGDecoder&);
+
+        public:
+            // Constructor for the object, decodes the frames of a source at 1/scale of their size
+            MJPEGDecoder(FrameSource& source, unsigned int scale = 1);
+
+            // Change the scale frames are decoded at, from the next frame on (a smaller image is
+            // cheaper to decode when the full one isn't needed)
+            void          setScale(unsigned int scale);
+            unsigned int  scale() const;
+
+            // Frame source.  Until the first frame is decoded the format is assumed to be 4:2:2.
+            int           capture(Frame& frame);
+            unsigned int  imageWidth() const;
+            unsigned int  imageHeight() const;
+            unsigned int  imageFormat() const;
+            unsigned long dropped() const;
+        };
+    }
+}
+
+#endif
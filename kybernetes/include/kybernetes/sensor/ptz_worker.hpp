@@ -0,0 +1,134 @@
+/*
+ *  ptz_worker.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _kybernetes_sensor_ptz_worker_h_
+#define _kybernetes_sensor_ptz_worker_h_
+
+// Pull in some boost utilities
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/smart_ptr/shared_ptr.hpp>
+
+// Other kybernetes dependencies
+#include <kybernetes/sensor/uvccamera.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // sensor namespace
+    namespace sensor
+    {
+        // Moves a camera's pan/tilt turret from its own thread.  A move is a USB control transfer
+        // which takes long enough to cost the capture thread frames, so moves are posted here
+        // instead and return at once.  Only the latest target posted is kept: targets posted while
+        // one is waiting replace it, so a tracker posting on every frame never builds a backlog.
+        // Moves are sent no closer together than the interval, or than the time the turret takes
+        // to turn through the last one, so the camera is never sent a move while still making one.
+        //
+        // The commanded pose is the target last posted, the applied pose the last one sent to
+        // the camera, stamped (monotonic time) with when the turret should have arrived there.
+        // Once a worker moves a camera, nothing else should.
+        class PTZWorker
+        {
+        public:
+            // Tuning
+            typedef struct _ptz_worker_parameters
+            {
+                // Shortest time between control transfers (s)
+                double interval;
+
+                // How fast the turret turns (degrees/s) and how long a reset takes (s)
+                double slewRate;
+                double resetTime;
+            } parameters;
+
+            // A pose of the turret (degrees, pan positive to the right) and when it was (s)
+            typedef struct _ptz_pose
+            {
+                int    pan;
+                int    tilt;
+                double timestamp;
+            } pose;
+
+            // Default tuning for the truck's camera
+            static parameters defaultParameters();
+
+        private:
+            // Internal thread control
+            boost::shared_ptr<boost::thread> m_thread;
+            boost::mutex                     m_mutex;
+            boost::condition_variable        m_changed;
+
+            // The thread function
+            void do_moving();
+
+            // The camera moved and configuration
+            UVCCamera                       &m_camera;
+            parameters                       m_parameters;
+
+            // Posted target, the last one sent and whether a reset is waiting
+            PTZWorker::pose                  m_commanded;
+            PTZWorker::pose                  m_applied;
+            bool                             m_reset;
+
+            // When the next move may be sent
+            double                           m_ready;
+
+            // Moves sent, targets replaced before they were sent and transfers which failed
+            unsigned long                    m_transfers;
+            unsigned long                    m_coalesced;
+            unsigned long                    m_errors;
+
+            // Keep a target within the turret's travel
+            void post(int pan, int tilt);
+
+            // Workers run a thread, don't copy them
+            PTZWorker(const PTZWorker&);
+            PTZWorker& operator=(const PTZWorker&);
+
+        public:
+            // Constructor for the object
+            PTZWorker(UVCCamera& camera, const parameters& p = defaultParameters());
+            ~PTZWorker();
+
+            // Post a target, or a move from the applied pose (what the latest images were taken
+            // at), limited to the turret's travel
+            void move(int pan, int tilt);
+            void moveRelative(int pan, int tilt);
+
+            // Post a reset to the center
+            void reset();
+
+            // The poses
+            PTZWorker::pose commanded();
+            PTZWorker::pose applied();
+
+            // Whether the turret should have arrived at the commanded pose
+            bool            settled();
+
+            // Statistics
+            unsigned long   transfers();
+            unsigned long   coalesced();
+            unsigned long   errors();
+        };
+    }
+}
+
+#endif
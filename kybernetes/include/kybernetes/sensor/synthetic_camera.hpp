@@ -0,0 +1,86 @@
+/*
+ *  synthetic_camera.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _kybernetes_sensor_synthetic_camera_h_
+#define _kybernetes_sensor_synthetic_camera_h_
+
+// Language dependencies
+#include <vector>
+
+// Other kybernetes dependencies
+#include <kybernetes/sensor/frame_source.hpp>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // sensor namespace
+    namespace sensor
+    {
+        // Draws YUYV images of colored disks bouncing around a shaded background, so the vision
+        // code can be run without a camera or a recording, and checked against where the blobs
+        // really are.  The images only depend on the seed and the frame index.
+        class SyntheticCamera : public FrameSource
+        {
+        public:
+            // A blob, its position at the start (pixels), velocity (pixels/s), radius (pixels)
+            // and color (Y, U, V)
+            typedef struct _synthetic_camera_blob
+            {
+                double        x;
+                double        y;
+                double        dx;
+                double        dy;
+                double        radius;
+                unsigned char color[3];
+            } blob;
+
+        private:
+            // Image size, the blobs and the frame timing (frame time is index / rate, or index /
+            // 30 when unpaced)
+            unsigned int      m_width;
+            unsigned int      m_height;
+            std::vector<blob> m_blobs;
+            FramePacer        m_pacer;
+            double            m_rate;
+
+            // The background, drawn once
+            std::vector<unsigned char> m_background;
+
+        public:
+            // Constructor for the object, places a number of blobs at random
+            SyntheticCamera(unsigned int width, unsigned int height, double rate = 30.0, unsigned int blobs = 3, unsigned int seed = 1);
+
+            // Replace the blobs
+            void              setBlobs(const std::vector<blob>& blobs);
+
+            // The blobs as drawn in a frame, positions at the frame's time
+            std::vector<blob> blobsAt(unsigned int sequence) const;
+
+            // Frame source
+            int               capture(Frame& frame);
+            unsigned int      imageWidth() const;
+            unsigned int      imageHeight() const;
+            unsigned int      imageFormat() const;
+            unsigned long     dropped() const;
+        };
+    }
+}
+
+#endif
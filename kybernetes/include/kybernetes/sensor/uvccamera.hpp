@@ -20,6 +20,7 @@
 #ifndef _kybernetes_sensor_uvccamera_h_
 #define _kybernetes_sensor_uvccamera_h_
 
+// Default number of capture buffers, a latest only capture needs no more than a few
 #define NB_BUFFER 16
 
 #define PTZ_PAN_MAX 60
@@ -30,10 +31,19 @@
 // Language dependencies
 #include <vector>
 #include <string>
+#include <list>
+#include <map>
+
+// Pull in some boost utilities
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 // System dependencies
 #include <linux/videodev2.h>
 
+// Other kybernetes dependencies
+#include <kybernetes/sensor/frame_source.hpp>
+
 // Kybernetes namespace
 namespace kybernetes {
     
@@ -41,11 +51,27 @@ namespace kybernetes {
     namespace sensor {
         
         // Class for a UVC driver camera
-        class UVCCamera {
+        class UVCCamera : public FrameSource {
         public:
+            // callback type for frames as they come off the camera.  Callback objects have to
+            // extend this class (UVCCamera::callback)
+            class callback
+            {
+            public:
+                // Callbacks may be deleted through this class
+                virtual ~callback() {}
+                
+                // Called from the capturing thread with every frame dequeued, including the ones
+                // latest only mode skips.  The frame is only valid during the call.
+                virtual void camera_event_frame(const Frame& frame) {}
+            };
+            
             // Creation and destruction of the framegrabber
-            UVCCamera( std::string device, int _width, int _height, int format );
+            UVCCamera( std::string device, int _width, int _height, int format, unsigned int buffers = NB_BUFFER );
             ~UVCCamera();
+            
+            // Whether the camera could be opened and started
+            bool isOpen() const;
 
             // Grabs an image that uses the format specified on construction
             int grab(std::vector<unsigned char>& data);
@@ -56,7 +82,53 @@ namespace kybernetes {
             // A bit more complex controls, grab only the buffers.  You must call
             // release buffer at some point, or the camera runs out of buffers.
             int capture_buffer(struct v4l2_buffer* buffer, void** data, size_t* len);
+            int capture_buffer(struct v4l2_buffer* buffer, void** data, size_t* len, double* timestamp);
             int release_buffer(struct v4l2_buffer* buffer);
+            
+            // Capture a frame that releases its own buffer (see Frame).  A camera that runs
+            // latest only needs a buffer more than the frames held at once, or captures wait
+            // for one to come back.
+            int capture(Frame& frame);
+            
+            // Capture without waiting if asked to, returns 2 when no frame is ready.  Poll the
+            // descriptor for input to know when one is.
+            int capture(Frame& frame, bool wait);
+            int descriptor() const;
+            
+            // Image size and format (which may not be the ones asked for)
+            unsigned int imageWidth() const;
+            unsigned int imageHeight() const;
+            unsigned int imageFormat() const;
+            
+            // In latest only mode a capture takes every frame that is ready and returns the
+            // newest, the older ones go straight back to the camera.  Otherwise frames are
+            // returned in order, and once processing falls behind they are as old as the queue
+            // is long.
+            void set_latest_only(bool latest);
+            
+            // Change the frame rate (the camera picks the nearest it has).  The stream is
+            // restarted to do it, so frames are late for a moment, but frames held keep their
+            // buffers.  Returns 1 if the camera's frame rate can't be set.  The frame rate is 0
+            // when the camera doesn't say.
+            int    set_frame_rate(unsigned int fps);
+            double frame_rate() const;
+            
+            // Frames captured but never returned (skipped by latest only mode, or dropped by
+            // the driver when it had no free buffer)
+            unsigned long dropped() const;
+
+            // Callback registration
+            void register_callback(UVCCamera::callback *c);
+            void unregister_callback(UVCCamera::callback *c);
+
+            // Set several controls (V4L2_CID_*) with one transfer.  Values are kept within each
+            // control's range and ones the camera already has are skipped.  Returns 1 if the
+            // camera lacks a control or one couldn't be set.
+            int setControls(const std::map<int, int>& values);
+            
+            // The range of a control (false if the camera lacks it) and its value
+            bool controlRange(int control, int& minimum, int& maximum) const;
+            int  controlValue(int control);
 
             // Standard color controls
             int brightness( int nbrightness );
@@ -68,9 +140,12 @@ namespace kybernetes {
             int ptz_reset(void);
             int ptz_move_relative(int pan, int tilt, int zoom);
             int ptz_move_absolute(int pan, int tilt, int zoom);
+            
+            // Position of the pan/tilt turret (degrees, pan positive to the right)
+            int pan() const;
+            int tilt() const;
 
-            // Image functions
-            //int decompress_jpeg( void* jpeg_data, size_t jpeg_size, std::vector<unsigned char>& data);
+            // MJPEG frames are captured as they are, decode them with an MJPEGDecoder
 
         private:
             // The string which holds the device file this camera is on
@@ -85,8 +160,12 @@ namespace kybernetes {
             struct v4l2_format         fmt;
             struct v4l2_buffer         buf;
 
-            // Buffers for frame data
-            void         *mem[NB_BUFFER];
+            // The descriptor and the buffers for frame data, shared with the frames, and what
+            // a frame holds
+            struct mapping;
+            struct lease;
+            boost::shared_ptr<mapping> m_mapping;
+            unsigned int  buffercount;
 
             // Image size
             unsigned int  width;
@@ -95,12 +174,30 @@ namespace kybernetes {
             // Image format
             unsigned int  formatIn;
             
-            // Flag holding streaming state
+            // Flag holding streaming state and the frame rate
             bool          isstreaming;
+            double        m_frameRate;
             
             // Position of the pan/tilt turret
             int           m_pan;
             int           m_tilt;
+            
+            // Capture mode, frames not returned and the sequence number of the last returned
+            bool          m_latestOnly;
+            unsigned long m_dropped;
+            unsigned int  m_sequence;
+            bool          m_haveSequence;
+            
+            // Description and value of each control, read once at open and kept as they are set
+            typedef struct _uvccamera_control {
+                struct v4l2_queryctrl query;
+                int                   value;
+            } control;
+            std::map<int, control>           m_controls;
+            
+            // Frame callbacks
+            boost::mutex                     m_callbackMutex;
+            std::list<UVCCamera::callback *> m_callbacks;
 
             // Initialize the v4l2 camera
             int initV4L2();
@@ -108,7 +205,19 @@ namespace kybernetes {
             // Enable or disable streaming
             int setStreaming(bool streaming);
             
-            // Access camera controls
+            // Dequeue a frame, waiting for one if asked to.  Returns 0 on success, 1 on an
+            // error and 2 if no frame was ready.
+            int dequeue(struct v4l2_buffer* buffer, bool wait);
+            
+            // Take the next frame (the newest in latest only mode) and count the ones missed,
+            // returns like dequeue
+            int take(struct v4l2_buffer* buffer, bool wait);
+            
+            // Show a dequeued frame to the callbacks
+            void tap(const struct v4l2_buffer* buffer);
+            
+            // Access camera controls (through the cache)
+            void loadControls();
             int isControl(int control, struct v4l2_queryctrl *queryctrl);
             int getControl(int control);
             int setControl(int control, int value);
@@ -0,0 +1,46 @@
+/*
+ *  clock.hpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kybernetes_utility_clock_h_
+#define _kybernetes_utility_clock_h_
+
+// System dependencies
+#include <sys/time.h>
+
+// Kybernetes namespace
+namespace kybernetes
+{
+    // utility namespace
+    namespace utility
+    {
+        // Seconds on the monotonic clock.  This is the clock V4L2 stamps frames with, and unlike
+        // the wall clock it doesn't jump when the board's time gets set, so it is what all of the
+        // timestamps passed between estimators and controllers are measured on.
+        double monotonicTime();
+        
+        // Seconds of processor time the process has used (all of its threads), to measure the
+        // load of a piece of work against the monotonic clock
+        double processorTime();
+        
+        // Convert a timeval (such as a v4l2_buffer timestamp) to seconds
+        double toSeconds(const struct timeval& tv);
+    }
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ *  bithreshold_benchmark.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Language deps
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+
+// Kybernetes deps
+#include <kybernetes/cv/cv.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+using namespace kybernetes::cv;
+using kybernetes::utility::monotonicTime;
+
+// Random images checked per kernel, and the frames timed at each size
+#define CHECKS  2000
+#define FRAMES  200
+
+// Bytes past the end of each destination row which must be left alone
+#define GUARD   8
+
+// Fill a buffer with random bytes
+void randomize(std::vector<uint8_t>& buffer)
+{
+    for(unsigned int i = 0; i < buffer.size(); i++)
+        buffer[i] = rand() & 0xFF;
+}
+
+// Check a kernel against the scalar version on random images of random sizes, strides and
+// bounds, returns the number of images which didn't match
+unsigned int check(bithreshold_kernel kernel)
+{
+    unsigned int failures = 0;
+    srand(kernel + 1);
+    for(unsigned int i = 0; i < CHECKS; i++)
+    {
+        // Any width (mostly narrow, to cover every tail), rows padded by any amount
+        unsigned int width  = (i % 4) ? 1 + rand() % 100 : 1 + rand() % 1400;
+        unsigned int height = 1 + rand() % 8;
+        size_t       sourceStride      = ((width + 1) / 2) * 4 + rand() % 40;
+        size_t       destinationStride = width + GUARD + rand() % 40;
+        std::vector<uint8_t> source(sourceStride * height);
+        randomize(source);
+
+        // Bounds around the middle, the whole range or empty (lower above upper)
+        uint8_t lower[3], upper[3];
+        for(int c = 0; c < 3; c++)
+        {
+            lower[c] = rand() % 160;
+            upper[c] = (rand() % 8) ? lower[c] + rand() % 96 : rand() % 256;
+        }
+
+        // Both versions into destinations filled with the same junk
+        std::vector<uint8_t> expected(destinationStride * height), result;
+        randomize(expected);
+        result = expected;
+        bithreshold_select(BITHRESHOLD_SCALAR);
+        yuv422_bithreshold(&source[0], sourceStride, &expected[0], destinationStride, width, height, lower[0], lower[1], lower[2], upper[0], upper[1], upper[2]);
+        bithreshold_select(kernel);
+        yuv422_bithreshold(&source[0], sourceStride, &result[0], destinationStride, width, height, lower[0], lower[1], lower[2], upper[0], upper[1], upper[2]);
+        if(result != expected)
+            failures++;
+    }
+    return failures;
+}
+
+// Time a kernel on a frame, milliseconds per frame
+double timing(bithreshold_kernel kernel, unsigned int width, unsigned int height)
+{
+    std::vector<uint8_t> source(width * height * 2), destination(width * height);
+    randomize(source);
+    bithreshold_select(kernel);
+    double start = monotonicTime();
+    for(int i = 0; i < FRAMES; i++)
+        yuv422_bithreshold(&source[0], &destination[0], width, height, 40, 100, 120, 200, 140, 180);
+    return (monotonicTime() - start) * 1000.0 / FRAMES;
+}
+
+int main (int argc, char** argv)
+{
+    // The kernels the processor has, checked against the scalar version
+    bithreshold_kernel chosen   = bithreshold_selected();
+    unsigned int       failures = 0;
+    std::cout << "Kernel    checked  failures" << std::endl;
+    for(int k = BITHRESHOLD_SCALAR + 1; k < BITHRESHOLD_KERNELS; k++)
+    {
+        if(!bithreshold_available((bithreshold_kernel) k))
+            continue;
+        unsigned int f = check((bithreshold_kernel) k);
+        std::cout << std::left << std::setw(10) << bithreshold_name((bithreshold_kernel) k) << std::right << std::setw(7) << CHECKS << std::setw(10) << f << std::endl;
+        failures += f;
+    }
+
+    // And timed, with the speedup over the scalar version
+    unsigned int sizes[][2] = { { 320, 240 }, { 640, 480 }, { 1280, 720 }, { 1920, 1080 } };
+    std::cout << std::endl << "Milliseconds per frame (" << bithreshold_name(chosen) << " is used)" << std::endl;
+    std::cout << "Size       kernel    time (ms)  speedup" << std::endl;
+    for(unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        double scalar = timing(BITHRESHOLD_SCALAR, sizes[s][0], sizes[s][1]);
+        for(int k = BITHRESHOLD_SCALAR; k < BITHRESHOLD_KERNELS; k++)
+        {
+            if(!bithreshold_available((bithreshold_kernel) k))
+                continue;
+            double t = (k == BITHRESHOLD_SCALAR) ? scalar : timing((bithreshold_kernel) k, sizes[s][0], sizes[s][1]);
+            std::ostringstream size;
+            size << sizes[s][0] << "x" << sizes[s][1];
+            std::cout << std::left << std::setw(11) << size.str() << std::setw(10) << bithreshold_name((bithreshold_kernel) k)
+                      << std::right << std::fixed << std::setprecision(3) << std::setw(9) << t << std::setprecision(1) << std::setw(8) << scalar / t << "x" << std::endl;
+        }
+    }
+
+    // Fail if any kernel disagreed with the scalar version
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+/*
+ *  camera_group_benchmark.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Language deps
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+// Boost
+#include <boost/thread/thread.hpp>
+
+// Kybernetes deps
+#include <kybernetes/sensor/camera_group.hpp>
+#include <kybernetes/sensor/synthetic_camera.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+using namespace kybernetes::sensor;
+using kybernetes::utility::monotonicTime;
+
+// Each case runs this long (s), with images of this size
+#define DURATION 3.0
+#define WIDTH    160
+#define HEIGHT   120
+
+// Checks the sets a group makes, how far apart their frames were captured and whether a frame
+// went out in two sets in a row
+class checker : public CameraGroup::callback
+{
+    boost::mutex       m_mutex;
+    std::vector<Frame> m_last;
+
+public:
+    unsigned long frames;
+    unsigned long sets;
+    unsigned long reused;
+    double        skew;
+
+    checker() : frames(0), sets(0), reused(0), skew(0.0) {}
+
+    void camera_event_frame(size_t camera, const Frame& frame)
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        frames++;
+    }
+
+    void camera_event_set(const std::vector<Frame>& set)
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        double earliest = set[0].timestamp(), latest = set[0].timestamp();
+        for(size_t i = 0; i < set.size(); i++)
+        {
+            earliest = std::min(earliest, set[i].timestamp());
+            latest   = std::max(latest, set[i].timestamp());
+            if(!m_last.empty() && set[i].sequence() == m_last[i].sequence())
+                reused++;
+        }
+        skew = std::max(skew, latest - earliest);
+        m_last = set;
+        sets++;
+    }
+};
+
+// Capture from a source into the group until the time is up, starting a moment late
+void feed(CameraGroup *group, size_t index, double rate, double delay, double until)
+{
+    SyntheticCamera camera(WIDTH, HEIGHT, rate, 2, index + 1);
+    boost::this_thread::sleep(boost::posix_time::microseconds((long) (delay * 1e6)));
+    while(monotonicTime() < until)
+    {
+        Frame frame;
+        if(camera.capture(frame))
+            break;
+        group->insert(index, frame);
+    }
+}
+
+int main (int argc, char** argv)
+{
+    // Sources at a rate (Hz), each started a moment after the first (s), grouped with a
+    // tolerance (s), and the sets each should make in a second
+    const char *names[]      = { "30 Hz pair, in step", "30 Hz pair, out of step", "30 Hz with 15 Hz", "three at 30 Hz" };
+    double      rates[][3]   = { { 30.0, 30.0, 0.0 }, { 30.0, 30.0, 0.0 }, { 30.0, 15.0, 0.0 }, { 30.0, 30.0, 30.0 } };
+    double      delays[][3]  = { { 0.0, 0.002, 0.0 }, { 0.0, 0.016, 0.0 }, { 0.0, 0.002, 0.0 }, { 0.0, 0.002, 0.004 } };
+    double      tolerances[] = { 0.01, 0.01, 0.01, 0.01 };
+    double      expected[]   = { 30.0, 0.0, 15.0, 30.0 };
+    size_t      counts[]     = { 2, 2, 2, 3 };
+
+    std::cout << "sources                    frames    sets/s  expected  max skew (ms)  reused" << std::endl;
+    int failures = 0;
+    for(int c = 0; c < 4; c++)
+    {
+        // Feed the group from a thread per source, as cameras with threads of their own would
+        CameraGroup group(counts[c], tolerances[c]);
+        checker     check;
+        group.registerCallback(&check);
+        double until = monotonicTime() + DURATION;
+        std::vector<boost::shared_ptr<boost::thread> > threads;
+        for(size_t i = 0; i < counts[c]; i++)
+            threads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(feed, &group, i, rates[c][i], delays[c][i], until))));
+        for(size_t i = 0; i < threads.size(); i++)
+            threads[i]->join();
+        group.unregisterCallback(&check);
+
+        // A case is right when the sets come at (nearly) the rate expected, within tolerance and
+        // never repeating a frame
+        double rate = check.sets / DURATION;
+        bool   good = rate >= expected[c] * 0.9 - 0.5 && rate <= expected[c] * 1.1 + 0.5 && check.skew <= tolerances[c] && check.reused == 0;
+        failures += !good;
+        std::cout << std::left << std::setw(25) << names[c] << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(8) << check.frames << std::setw(10) << rate << std::setw(10) << expected[c]
+                  << std::setw(15) << check.skew * 1000.0 << std::setw(8) << check.reused << (good ? "" : "  WRONG") << std::endl;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,127 @@
+/*
+ *  dstar_lite_benchmark.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Language deps
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+// Kybernetes deps
+#include <kybernetes/navigation/dstar_lite.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+using namespace kybernetes::navigation;
+using kybernetes::utility::monotonicTime;
+
+// Replans timed per grid, and how far ahead of the robot obstacles are discovered (cells)
+#define REPLANS   50
+#define SIGHT     12
+
+// Scatter rectangular obstacles over a grid, leaving the corners free
+void scatter(DStarLite& planner, int size)
+{
+    int count = size * size / 400;
+    for(int i = 0; i < count; i++)
+    {
+        int w = 2 + rand() % 8, h = 2 + rand() % 8;
+        int x = rand() % size,  y = rand() % size;
+        for(int dy = 0; dy < h; dy++)
+            for(int dx = 0; dx < w; dx++)
+                if(std::min(x + dx, y + dy) > 4 && std::max(x + dx, y + dy) < size - 5)
+                    planner.setBlocked(x + dx, y + dy, true);
+    }
+}
+
+// Time a search from scratch in milliseconds
+double scratch(DStarLite& planner, int size, unsigned int& expanded)
+{
+    planner.setGoal(size - 1, size - 1);
+    double start = monotonicTime();
+    planner.plan();
+    expanded = planner.expanded();
+    return (monotonicTime() - start) * 1000.0;
+}
+
+int main (int argc, char** argv)
+{
+    std::cout << "grid       scratch (ms)  expanded  replan mean (ms)  max (ms)   expanded  speedup" << std::endl;
+    int sizes[] = { 200, 400, 600, 800, 1000 };
+    for(unsigned int k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++)
+    {
+        // The robot starts in one corner of a cluttered grid bound for the other
+        int size = sizes[k];
+        srand(size);
+        DStarLite planner(size, size);
+        scatter(planner, size);
+        planner.setStart(0, 0);
+        planner.setGoal(size - 1, size - 1);
+        planner.plan();
+
+        // Drive along the path, every few steps a wall turns up across it within sonar range
+        // and the path is repaired
+        std::vector<DStarLite::cell> path;
+        double       total = 0.0, worst = 0.0;
+        unsigned int expanded = 0, replans = 0;
+        while(replans < REPLANS && planner.path(path) && path.size() > SIGHT + 2)
+        {
+            // Advance a few cells
+            DStarLite::cell robot = path[4];
+            planner.setStart(robot.x, robot.y);
+
+            // Block the path ahead with a short wall across it
+            DStarLite::cell ahead = path[SIGHT];
+            DStarLite::cell next  = path[SIGHT + 1];
+            int ax = next.y - ahead.y, ay = ahead.x - next.x;
+            for(int j = -3; j <= 3; j++)
+            {
+                int x = ahead.x + ax * j, y = ahead.y + ay * j;
+                if(x < size - 3 || y < size - 3)
+                    planner.setBlocked(x, y, true);
+            }
+
+            // Repair
+            double start = monotonicTime();
+            bool   found = planner.plan();
+            double t     = (monotonicTime() - start) * 1000.0;
+            if(!found)
+                break;
+            total    += t;
+            worst     = std::max(worst, t);
+            expanded += planner.expanded();
+            replans++;
+        }
+
+        // The same search from scratch, from where the robot ended up on the final map
+        unsigned int scratchExpanded = 0;
+        double       scratchTime     = scratch(planner, size, scratchExpanded);
+
+        // Report
+        double mean = replans ? total / replans : 0.0;
+        std::ostringstream grid;
+        grid << size << "x" << size;
+        std::cout << std::left << std::setw(11) << grid.str() << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(13) << scratchTime << std::setw(10) << scratchExpanded
+                  << std::setw(18) << mean << std::setw(10) << worst << std::setw(11) << (replans ? expanded / replans : 0)
+                  << std::setw(9) << std::setprecision(1) << (mean > 0.0 ? scratchTime / mean : 0.0) << "x" << std::endl;
+    }
+    return 0;
+}
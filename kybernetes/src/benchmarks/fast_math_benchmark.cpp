@@ -0,0 +1,175 @@
+/*
+ *  fast_math_benchmark.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Language deps
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+// Kybernetes deps
+#include <kybernetes/math/fast_math.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+using namespace kybernetes::math;
+using kybernetes::utility::monotonicTime;
+
+// Samples per pass and passes per timing
+#define SAMPLES 4096
+#define PASSES  2000
+
+// Points in the error sweeps
+#define SWEEP   1000000
+
+// Keeps the compiler from discarding the timed loops
+volatile float __sink;
+
+// Sum a result array into the sink
+void consume(const std::vector<float>& v)
+{
+    float sum = 0.0f;
+    for(unsigned int i = 0; i < v.size(); i++)
+        sum += v[i];
+    __sink = sum;
+}
+
+// Difference between two angles in radians
+double angleError(double a, double b)
+{
+    double d = std::fabs(a - b);
+    return (d > M_PI) ? 2.0 * M_PI - d : d;
+}
+
+// Print one timing line in nanoseconds per element
+void report(const char *name, double seconds)
+{
+    std::cout << "    " << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(8) << (seconds * 1.0e9 / ((double) SAMPLES * PASSES)) << " ns" << std::endl;
+}
+
+// Print the error line
+void error(const char *name, double maximum)
+{
+    std::cout << name << " (max error " << std::scientific << std::setprecision(2) << maximum << ")" << std::endl;
+}
+
+int main (int argc, char** argv)
+{
+    // Inputs, headings in any quadrant and angles over a few turns
+    std::vector<float> x(SAMPLES), y(SAMPLES), a(SAMPLES), p(SAMPLES), r(SAMPLES);
+    srand(1);
+    for(unsigned int i = 0; i < SAMPLES; i++)
+    {
+        x[i] = (float) rand() / RAND_MAX * 200.0f - 100.0f;
+        y[i] = (float) rand() / RAND_MAX * 200.0f - 100.0f;
+        a[i] = (float) rand() / RAND_MAX * 4.0f * M_PI - 2.0f * M_PI;
+        p[i] = (float) rand() / RAND_MAX * 10000.0f;
+    }
+
+    // Sweep inputs, headings around the unit circle, angles over two turns either way and
+    // square roots over several decades
+    std::vector<float> ex(SWEEP), ey(SWEEP), ea(SWEEP), ep(SWEEP);
+    for(unsigned int i = 0; i < SWEEP; i++)
+    {
+        double t = (double) i / (SWEEP - 1);
+        ex[i] = (float) std::cos(t * 2.0 * M_PI - M_PI);
+        ey[i] = (float) std::sin(t * 2.0 * M_PI - M_PI);
+        ea[i] = (float) (t * 8.0 * M_PI - 4.0 * M_PI);
+        ep[i] = (float) std::pow(10.0, t * 12.0 - 6.0);
+    }
+
+    // Run the array forms over the sweep, they are built with different flags than this file
+    std::vector<float> rAtan2(SWEEP), rSin(SWEEP), rCos(SWEEP), rSqrt(SWEEP);
+    fastAtan2(&ey[0], &ex[0], &rAtan2[0], SWEEP);
+    fastSin(&ea[0], &rSin[0], SWEEP);
+    fastCos(&ea[0], &rCos[0], SWEEP);
+    fastSqrt(&ep[0], &rSqrt[0], SWEEP);
+
+    // Measure the worst case error of both forms against double precision libm
+    double eAtan2 = 0.0, eSin = 0.0, eCos = 0.0, eSqrt = 0.0;
+    for(unsigned int i = 0; i < SWEEP; i++)
+    {
+        // atan2, wrapping across the branch cut
+        double reference = std::atan2((double) ey[i], (double) ex[i]);
+        eAtan2 = std::max(eAtan2, angleError(fastAtan2(ey[i], ex[i]), reference));
+        eAtan2 = std::max(eAtan2, angleError(rAtan2[i], reference));
+
+        // sin and cos
+        reference = std::sin((double) ea[i]);
+        eSin = std::max(eSin, std::max(std::fabs(fastSin(ea[i]) - reference), std::fabs(rSin[i] - reference)));
+        reference = std::cos((double) ea[i]);
+        eCos = std::max(eCos, std::max(std::fabs(fastCos(ea[i]) - reference), std::fabs(rCos[i] - reference)));
+
+        // sqrt, relative
+        reference = std::sqrt((double) ep[i]);
+        eSqrt = std::max(eSqrt, std::max(std::fabs(fastSqrt(ep[i]) - reference), std::fabs(rSqrt[i] - reference)) / reference);
+    }
+
+    // Time each function three ways, libm (float), the inline scalar kernel and the array form
+    double start;
+    std::cout << "Nanoseconds per element, " << SAMPLES << " elements x " << PASSES << " passes" << std::endl;
+
+    error("atan2", eAtan2);
+    start = monotonicTime();
+    for(int j = 0; j < PASSES; j++) { for(int i = 0; i < SAMPLES; i++) r[i] = atan2f(y[i], x[i]); consume(r); }
+    report("libm", monotonicTime() - start);
+    start = monotonicTime();
+    for(int j = 0; j < PASSES; j++) { for(int i = 0; i < SAMPLES; i++) r[i] = fastAtan2(y[i], x[i]); consume(r); }
+    report("fast scalar", monotonicTime() - start);
+    start = monotonicTime();
+    for(int j = 0; j < PASSES; j++) { fastAtan2(&y[0], &x[0], &r[0], SAMPLES); consume(r); }
+    report("fast array", monotonicTime() - start);
+
+    error("sin", eSin);
+    start = monotonicTime();
+    for(int j = 0; j < PASSES; j++) { for(int i = 0; i < SAMPLES; i++) r[i] = sinf(a[i]); consume(r); }
+    report("libm", monotonicTime() - start);
+    start = monotonicTime();
+    for(int j = 0; j < PASSES; j++) { for(int i = 0; i < SAMPLES; i++) r[i] = fastSin(a[i]); consume(r); }
+    report("fast scalar", monotonicTime() - start);
+    start = monotonicTime();
+    for(int j = 0; j < PASSES; j++) { fastSin(&a[0], &r[0], SAMPLES); consume(r); }
+    report("fast array", monotonicTime() - start);
+
+    error("cos", eCos);
+    start = monotonicTime();
+    for(int j = 0; j < PASSES; j++) { for(int i = 0; i < SAMPLES; i++) r[i] = cosf(a[i]); consume(r); }
+    report("libm", monotonicTime() - start);
+    start = monotonicTime();
+    for(int j = 0; j < PASSES; j++) { for(int i = 0; i < SAMPLES; i++) r[i] = fastCos(a[i]); consume(r); }
+    report("fast scalar", monotonicTime() - start);
+    start = monotonicTime();
+    for(int j = 0; j < PASSES; j++) { fastCos(&a[0], &r[0], SAMPLES); consume(r); }
+    report("fast array", monotonicTime() - start);
+
+    error("sqrt", eSqrt);
+    start = monotonicTime();
+    for(int j = 0; j < PASSES; j++) { for(int i = 0; i < SAMPLES; i++) r[i] = sqrtf(p[i]); consume(r); }
+    report("libm", monotonicTime() - start);
+    start = monotonicTime();
+    for(int j = 0; j < PASSES; j++) { for(int i = 0; i < SAMPLES; i++) r[i] = fastSqrt(p[i]); consume(r); }
+    report("fast scalar", monotonicTime() - start);
+    start = monotonicTime();
+    for(int j = 0; j < PASSES; j++) { fastSqrt(&p[0], &r[0], SAMPLES); consume(r); }
+    report("fast array", monotonicTime() - start);
+
+    // Return success
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ *  fusion_filter_benchmark.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Language deps
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+// Kybernetes deps
+#include <kybernetes/navigation/fusion_filter.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+using namespace kybernetes::navigation;
+using kybernetes::math::LocalFrame;
+using kybernetes::math::LocalCoordinate;
+using kybernetes::utility::processorTime;
+
+// A drive of this long (s), with the gyro at 100 Hz, the odometer at 20 Hz and a fix every
+// second, delivered this late (s) with this much noise (m)
+#define DURATION    60.0
+#define GPS_LATENCY 0.3
+#define GPS_NOISE   2.0
+
+// The gyro's yaw drifts this fast (deg/s) and the truck drives at this speed (m/s)
+#define GYRO_DRIFT  0.5
+#define SPEED       2.0
+
+// The firmware zeroes the odometer at a position target at this time (s), and a frame with a
+// garbled odometer arrives at this one
+#define RESET_TIME  30.0
+#define GLITCH_TIME 45.0
+
+// Normally distributed noise
+double gaussian()
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return std::sqrt(-2.0 * std::log(u)) * std::cos(2.0 * M_PI * v);
+}
+
+// A fix waiting to be delivered
+typedef struct _fix
+{
+    double timestamp;
+    double x;
+    double y;
+} fix;
+
+int main (int argc, char** argv)
+{
+    FusionFilter filter((LocalFrame()));
+
+    // The truck, where it is, which way it points (rad, from north), how far the gyro has drifted
+    // and the odometer (in units)
+    double x = 0.0, y = 0.0, heading = 30.0 * M_PI / 180.0, drift = 0.0, odometer = 0.0;
+    double start = 100.0, dt = 0.01;
+    std::vector<fix> pending;
+
+    // Drive, feeding the filter as the sensor callbacks would
+    double errorMean = 0.0, errorMax = 0.0, speedMax = 0.0;
+    unsigned long samples = 0, measured = 0;
+    double processor = processorTime();
+    int steps = (int) (DURATION / dt);
+    for(int k = 1; k <= steps; k++)
+    {
+        // Weave along
+        double t = start + k * dt;
+        heading  += 0.2 * std::sin(t * 0.3) * dt;
+        x        += SPEED * std::sin(heading) * dt;
+        y        += SPEED * std::cos(heading) * dt;
+        odometer += SPEED * dt / ODOMETER_METERS_PER_UNIT;
+        drift    += GYRO_DRIFT * M_PI / 180.0 * dt;
+
+        // The gyro's yaw
+        filter.addYaw(t, std::fmod((heading + drift) * 180.0 / M_PI + 720.0, 360.0));
+        samples++;
+
+        // The odometer, zeroed once and garbled once
+        if(k % 5 == 0)
+        {
+            if(std::fabs(k * dt - RESET_TIME) < dt / 2)
+                odometer = 0.0;
+            double reported = odometer;
+            if(std::fabs(k * dt - GLITCH_TIME) < 2.5 * dt)
+                reported += 100000.0;
+            filter.addOdometer(t, reported);
+            samples++;
+        }
+
+        // The fixes, delivered late
+        if(k % 100 == 0)
+        {
+            fix f = { t, x + gaussian() * GPS_NOISE, y + gaussian() * GPS_NOISE };
+            pending.push_back(f);
+        }
+        while(!pending.empty() && t - pending.front().timestamp >= GPS_LATENCY)
+        {
+            filter.addPosition(pending.front().timestamp, LocalCoordinate(pending.front().x, pending.front().y), GPS_NOISE);
+            pending.erase(pending.begin());
+            samples++;
+        }
+
+        // Measure once the filter has settled
+        if(k * dt > 10.0)
+        {
+            FusionFilter::state s = filter.fetchState();
+            double error = std::sqrt(std::pow(s.position.x - x, 2) + std::pow(s.position.y - y, 2));
+            errorMean += error;
+            errorMax   = std::max(errorMax, error);
+            speedMax   = std::max(speedMax, std::fabs(s.speed));
+            measured++;
+        }
+    }
+    processor = processorTime() - processor;
+
+    // Report
+    FusionFilter::state s = filter.fetchState();
+    double headingError = std::fmod(s.heading - heading * 180.0 / M_PI + 720.0 + 180.0, 360.0) - 180.0;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "position error mean " << errorMean / measured << " m, max " << errorMax << " m" << std::endl;
+    std::cout << "heading error " << headingError << " deg, gyro bias " << std::setprecision(3) << s.bias << " deg/s (actual " << GYRO_DRIFT << ")" << std::endl;
+    std::cout << std::setprecision(2) << "speed " << s.speed << " m/s (actual " << SPEED << "), highest estimate " << speedMax << " m/s" << std::endl;
+    std::cout << "samples " << samples << ", dropped " << filter.dropped() << ", " << processor / samples * 1e6 << " us each (including replays)" << std::endl;
+    return 0;
+}
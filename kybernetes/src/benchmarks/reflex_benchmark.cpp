@@ -0,0 +1,295 @@
+/*
+ *  reflex_benchmark.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Language deps
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// System deps
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Kybernetes deps
+#include <kybernetes/controller/motion_controller.hpp>
+#include <kybernetes/controller/sensor_controller.hpp>
+#include <kybernetes/navigation/dead_reckoning.hpp>
+#include <kybernetes/navigation/occupancy_grid.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+using namespace kybernetes::controller;
+using namespace kybernetes::navigation;
+using kybernetes::utility::monotonicTime;
+
+// Bumps timed per configuration, and the time a stalled callback takes (ms)
+#define BUMPS 50
+#define STALL 10
+
+// A stand-in for one of the truck's boards on a pseudo terminal.  It answers the synchronization
+// request, records when stop commands arrive, and sends a frame every period, for the sensor
+// controller the bumpers and open sonars, for the motion controller an idle telemetry frame.  The
+// sensor controller firmware also sends a frame as soon as the bumpers change, that can be turned
+// off to see what it saves.
+class stand_in
+{
+    boost::shared_ptr<boost::thread> m_thread;
+    boost::mutex                     m_mutex;
+    int                              m_master;
+    std::string                      m_port;
+    double                           m_period;
+    size_t                           m_frame;
+
+    // Bumpers pressed, when they were pressed and when a frame first carried them
+    bool                             m_immediate;
+    unsigned char                    m_bumpers;
+    unsigned char                    m_sentBumpers;
+    double                           m_pressed;
+    double                           m_sent;
+
+    // When the last stop command arrived
+    double                           m_stopped;
+
+    // Run the firmware
+    void run()
+    {
+        std::string input;
+        double      next = 0.0;
+        bool        synced = false;
+        try
+        {
+            while(1)
+            {
+                boost::this_thread::interruption_point();
+
+                // Send a frame when one is due
+                double now = monotonicTime();
+                boost::mutex::scoped_lock lock(m_mutex);
+                if(synced && (now >= next || (m_immediate && m_bumpers != m_sentBumpers)))
+                {
+                    char           buffer[11] = { 0 };
+                    unsigned short sonars[5]  = { 400, 400, 400, 400, 400 };
+                    if(m_frame == 11)
+                    {
+                        buffer[0] = m_bumpers;
+                        memcpy(buffer + 1, sonars, 10);
+                    }
+                    if(m_bumpers && m_sent < m_pressed)
+                        m_sent = monotonicTime();
+                    if(write(m_master, buffer, m_frame) != (ssize_t) m_frame)
+                        std::cerr << "Stand-in failed to send a frame" << std::endl;
+                    m_sentBumpers = m_bumpers;
+                    next = std::max(next + m_period, now);
+                }
+                lock.unlock();
+
+                // Wait for commands
+                struct pollfd p = { m_master, POLLIN, 0 };
+                if(poll(&p, 1, 1) <= 0)
+                    continue;
+                char buffer[64];
+                ssize_t n = read(m_master, buffer, sizeof(buffer));
+                if(n <= 0)
+                    continue;
+                input.append(buffer, n);
+                now = monotonicTime();
+
+                // Execute every complete command
+                while(input.size() >= 2)
+                {
+                    if(input[0] != '#')
+                    {
+                        input.erase(0, 1);
+                        continue;
+                    }
+                    char   type   = input[1];
+                    size_t length = (type == 't' || type == 's') ? 2 : ((type == 'p') ? 6 : 0);
+                    if(input.size() < length + 2)
+                        break;
+                    if(type == 'a' && write(m_master, "#SYNCH\r\n", 8) == 8)
+                        synced = true;
+                    if(type == 't' && input[2] == 0 && input[3] == 0)
+                    {
+                        lock.lock();
+                        m_stopped = now;
+                        lock.unlock();
+                    }
+                    input.erase(0, length + 2);
+                }
+            }
+        } catch (boost::thread_interrupted)
+        {
+
+        }
+    }
+
+public:
+    // Open a pseudo terminal and start the firmware
+    stand_in(double period, size_t frame) : m_period(period), m_frame(frame), m_immediate(false), m_bumpers(0), m_sentBumpers(0), m_pressed(0.0), m_sent(0.0), m_stopped(0.0)
+    {
+        m_master = posix_openpt(O_RDWR | O_NOCTTY);
+        if(m_master < 0 || grantpt(m_master) != 0 || unlockpt(m_master) != 0)
+        {
+            std::cerr << "Fatal: Could not open a pseudo terminal" << std::endl;
+            exit(1);
+        }
+        struct termios settings;
+        tcgetattr(m_master, &settings);
+        cfmakeraw(&settings);
+        tcsetattr(m_master, TCSANOW, &settings);
+        m_port = ptsname(m_master);
+        m_thread = boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&stand_in::run, this)));
+    }
+
+    ~stand_in()
+    {
+        m_thread->interrupt();
+        m_thread->join();
+        close(m_master);
+    }
+
+    // Port the host should open
+    const std::string& port() const
+    {
+        return m_port;
+    }
+
+    // Send a frame as soon as the bumpers change
+    void setImmediate(bool immediate)
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_immediate = immediate;
+    }
+
+    // Press or let go of the bumpers
+    void press(unsigned char bumpers)
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_bumpers = bumpers;
+        m_pressed = monotonicTime();
+    }
+
+    // When the bumpers were pressed and first sent
+    void pressed(double& pressed, double& sent)
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        pressed = m_pressed;
+        sent    = m_sent;
+    }
+
+    // When the last stop arrived
+    double stopped()
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        return m_stopped;
+    }
+};
+
+// The application, stops on a bumper from its callback (unless the reflex is doing it)
+class application : public SensorController::callback
+{
+    MotionController &m_controller;
+    bool              m_stops;
+    bool              m_stall;
+
+public:
+    application(MotionController& controller, bool stops, bool stall) : m_controller(controller), m_stops(stops), m_stall(stall)
+    {
+
+    }
+
+    void sensors_event_update(SensorController::state s)
+    {
+        // A callback ahead of the stop that blocks now and then (a console write, a lock)
+        if(m_stall)
+            boost::this_thread::sleep(boost::posix_time::milliseconds(STALL));
+        if(m_stops && (s.bumpers & (BUMPER_FRONT_LEFT | BUMPER_FRONT_RIGHT)))
+            m_controller.setThrottle(0);
+    }
+};
+
+int main (int argc, char** argv)
+{
+    // Start the stand-ins and connect to them like the truck
+    stand_in motors(0.05, 10), sensors(0.025, 11);
+    MotionController motion_controller(motors.port(), B57600);
+    SensorController sensor_controller(sensors.port(), B57600);
+    while(!motion_controller.isReady() || !sensor_controller.isReady())
+        boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+
+    // The obstacle map runs on every frame ahead of the application, as in the demos
+    DeadReckoning odometry((kybernetes::math::LocalFrame()));
+    OccupancyGrid grid(odometry);
+    sensor_controller.registerCallback(&grid);
+
+    // The stop made by the application's callback or the reflex, with and without a callback that
+    // stalls, on firmware that only sends frames on time and firmware that sends one on a bump
+    const char *names[]    = { "callback", "callback, stalled", "reflex, stalled", "reflex, frame on bump" };
+    bool        reflexes[] = { false, false, true, true };
+    bool        stalls[]   = { false, true, true, true };
+    bool        bumps[]    = { false, false, false, true };
+    std::cout << "stop by                    bump to stop mean (ms)  max (ms)   frame to stop mean (ms)  max (ms)" << std::endl;
+    for(int mode = 0; mode < 4; mode++)
+    {
+        // Set up the way the stop is made
+        application app(motion_controller, !reflexes[mode], stalls[mode]);
+        sensor_controller.registerCallback(&app);
+        if(reflexes[mode])
+            sensor_controller.setReflex(&motion_controller, BUMPER_FRONT_LEFT | BUMPER_FRONT_RIGHT, 0);
+        sensors.setImmediate(bumps[mode]);
+
+        // Drive into things at random points in the frame
+        double bumpMean = 0.0, bumpMax = 0.0, frameMean = 0.0, frameMax = 0.0;
+        for(int k = 0; k < BUMPS; k++)
+        {
+            motion_controller.setThrottle(30);
+            boost::this_thread::sleep(boost::posix_time::microseconds(rand() % 25000));
+            sensors.press(BUMPER_FRONT_LEFT);
+
+            // Wait for the stop, reading it before the press so the frame time is never the older
+            double pressed, sent, stopped, start = monotonicTime();
+            do
+            {
+                boost::this_thread::sleep(boost::posix_time::microseconds(200));
+                stopped = motors.stopped();
+                sensors.pressed(pressed, sent);
+            } while(stopped < pressed && monotonicTime() - start < 1.0);
+            bumpMean  += (stopped - pressed) * 1000.0 / BUMPS;
+            bumpMax    = std::max(bumpMax, (stopped - pressed) * 1000.0);
+            frameMean += (stopped - sent) * 1000.0 / BUMPS;
+            frameMax   = std::max(frameMax, (stopped - sent) * 1000.0);
+
+            // Back off, the reflex lets go once the frames have stayed clear
+            sensors.press(0);
+            boost::this_thread::sleep(boost::posix_time::milliseconds(reflexes[mode] ? (long) (REFLEX_HOLD * 1000.0) + 100 : 100));
+        }
+
+        sensor_controller.setReflex(NULL, 0, 0);
+        sensor_controller.unregisterCallback(&app);
+        std::cout << std::left << std::setw(27) << names[mode] << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(23) << bumpMean << std::setw(10) << bumpMax << std::setw(26) << frameMean << std::setw(10) << frameMax << std::endl;
+    }
+    sensor_controller.unregisterCallback(&grid);
+    return 0;
+}
@@ -0,0 +1,345 @@
+/*
+ *  speed_controller_benchmark.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Language deps
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+// System deps
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Kybernetes deps
+#include <kybernetes/controller/motion_controller.hpp>
+#include <kybernetes/controller/speed_controller.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+using namespace kybernetes::controller;
+using kybernetes::utility::monotonicTime;
+
+// Firmware constants, telemetry period (s) and odometer inches per encoder tick
+#define TELEMETRY_PERIOD 0.05
+#define INCHES_PER_TICK  0.008622
+
+// The truck, speed settles to GAIN m/s per throttle unit above DEADZONE (scaled by the battery,
+// less HILL m/s per % of grade) with time constant LAG (s)
+#define GAIN             0.042
+#define DEADZONE         12.0
+#define HILL             0.08
+#define LAG              0.3
+
+// Length of each step response (s) and the sampling of the truck's speed (s)
+#define DURATION         4.0
+#define SAMPLE           0.01
+
+// A stand-in for the motor controller board on a pseudo terminal.  It speaks the firmware's
+// protocol (the synchronization token, the 50 ms telemetry frame, and the throttle, steering
+// and position commands) and drives a simulated truck with the throttle it is sent.
+class stand_in
+{
+public:
+    // A throttle command received, when, and when the telemetry frame before it was sent
+    typedef struct _stand_in_command
+    {
+        double time;
+        double frame;
+        short  throttle;
+    } command;
+
+private:
+    boost::shared_ptr<boost::thread> m_thread;
+    boost::mutex                     m_mutex;
+    int                              m_master;
+    std::string                      m_port;
+
+    // The truck
+    double                           m_speed;
+    double                           m_position;
+    double                           m_battery;
+    double                           m_grade;
+    short                            m_throttle;
+
+    // Commands received
+    std::vector<command>             m_commands;
+
+    // Send a telemetry frame
+    void frame()
+    {
+        unsigned char  enabled = 1, ontarget = 0;
+        float          inches  = (float) (std::floor(m_position / (INCHES_PER_TICK * 0.0254)) * INCHES_PER_TICK);
+        unsigned short radio   = 1700;
+        char buffer[10];
+        memcpy(buffer + 0, &enabled, 1);
+        memcpy(buffer + 1, &ontarget, 1);
+        memcpy(buffer + 2, &inches, 4);
+        memcpy(buffer + 6, &radio, 2);
+        memcpy(buffer + 8, &radio, 2);
+        if(write(m_master, buffer, 10) != 10)
+            std::cerr << "Stand-in failed to send telemetry" << std::endl;
+    }
+
+    // Run the firmware
+    void run()
+    {
+        std::string input;
+        double      last = monotonicTime(), next = 0.0, sent = 0.0;
+        bool        synced = false;
+        try
+        {
+            while(1)
+            {
+                boost::this_thread::interruption_point();
+
+                // Drive the truck along
+                boost::mutex::scoped_lock lock(m_mutex);
+                double now = monotonicTime(), dt = now - last;
+                double settle = std::max(0.0, GAIN * m_battery * (m_throttle - DEADZONE)) - HILL * m_grade;
+                last        = now;
+                m_speed    += (settle - m_speed) * std::min(1.0, dt / LAG);
+                m_speed     = std::max(m_speed, 0.0);
+                m_position += m_speed * dt;
+
+                // Telemetry once synchronized
+                if(synced && now >= next)
+                {
+                    frame();
+                    sent = now;
+                    next = std::max(next + TELEMETRY_PERIOD, now);
+                }
+                lock.unlock();
+
+                // Wait for commands
+                struct pollfd p = { m_master, POLLIN, 0 };
+                if(poll(&p, 1, 1) <= 0)
+                    continue;
+                char buffer[64];
+                ssize_t n = read(m_master, buffer, sizeof(buffer));
+                if(n <= 0)
+                    continue;
+                input.append(buffer, n);
+                now = monotonicTime();
+
+                // Execute every complete command
+                while(input.size() >= 2)
+                {
+                    if(input[0] != '#')
+                    {
+                        input.erase(0, 1);
+                        continue;
+                    }
+                    char   type   = input[1];
+                    size_t length = (type == 't' || type == 's') ? 2 : ((type == 'p') ? 6 : 0);
+                    if(input.size() < length + 2)
+                        break;
+                    if(type == 'a')
+                    {
+                        if(write(m_master, "#SYNCH\r\n", 8) == 8)
+                            synced = true;
+                    }
+                    else if(type == 't' || type == 'p')
+                    {
+                        lock.lock();
+                        memcpy(&m_throttle, input.data() + ((type == 'p') ? 6 : 2), 2);
+                        if(type == 't')
+                        {
+                            command c = { now, sent, m_throttle };
+                            m_commands.push_back(c);
+                        }
+                        lock.unlock();
+                    }
+                    input.erase(0, length + 2);
+                }
+            }
+        } catch (boost::thread_interrupted)
+        {
+
+        }
+    }
+
+public:
+    // Open a pseudo terminal and start the firmware
+    stand_in() : m_speed(0.0), m_position(0.0), m_battery(1.0), m_grade(0.0), m_throttle(0)
+    {
+        m_master = posix_openpt(O_RDWR | O_NOCTTY);
+        if(m_master < 0 || grantpt(m_master) != 0 || unlockpt(m_master) != 0)
+        {
+            std::cerr << "Fatal: Could not open a pseudo terminal" << std::endl;
+            exit(1);
+        }
+        struct termios settings;
+        tcgetattr(m_master, &settings);
+        cfmakeraw(&settings);
+        tcsetattr(m_master, TCSANOW, &settings);
+        m_port = ptsname(m_master);
+        m_thread = boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&stand_in::run, this)));
+    }
+
+    ~stand_in()
+    {
+        m_thread->interrupt();
+        m_thread->join();
+        close(m_master);
+    }
+
+    // Port the host should open
+    const std::string& port() const
+    {
+        return m_port;
+    }
+
+    // Put the truck at rest in new conditions
+    void reset(double battery, double grade)
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_speed   = 0.0;
+        m_battery = battery;
+        m_grade   = grade;
+        m_commands.clear();
+    }
+
+    // The truck's true speed
+    double speed()
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        return m_speed;
+    }
+
+    // Commands received
+    std::vector<command> commands()
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        return m_commands;
+    }
+};
+
+// A step response
+typedef struct _response
+{
+    double latency;
+    double frameLatency;
+    double rise;
+    double overshoot;
+    double settle;
+    double error;
+    double writes;
+} response;
+
+// Step the speed from rest and measure the response
+response step(stand_in& board, SpeedController& controller, double target, double battery, double grade)
+{
+    // Bring the truck to rest
+    controller.stop();
+    board.reset(battery, grade);
+    boost::this_thread::sleep(boost::posix_time::milliseconds(500));
+    board.reset(battery, grade);
+
+    // Step and sample the true speed
+    std::vector<double> samples;
+    double start = monotonicTime();
+    controller.setSpeed(target);
+    while(monotonicTime() - start < DURATION)
+    {
+        samples.push_back(board.speed());
+        boost::this_thread::sleep(boost::posix_time::microseconds((int) (SAMPLE * 1e6)));
+    }
+
+    // Command latency, from setSpeed to the board and from a telemetry frame to the board
+    response r;
+    std::vector<stand_in::command> commands = board.commands();
+    r.latency      = commands.size() ? (commands[0].time - start) * 1000.0 : 0.0;
+    r.frameLatency = 0.0;
+    for(size_t i = 1; i < commands.size(); i++)
+        r.frameLatency += (commands[i].time - commands[i].frame) * 1000.0 / (commands.size() - 1);
+    r.writes = commands.size() / DURATION;
+
+    // Rise (10 - 90%), overshoot, settling into 5% and the error over the last second
+    double low = -1.0, high = -1.0, peak = 0.0, error = 0.0;
+    int    tail = 0;
+    r.settle = 0.0;
+    for(size_t i = 0; i < samples.size(); i++)
+    {
+        double t = i * SAMPLE;
+        if(low < 0.0 && samples[i] >= 0.1 * target)
+            low = t;
+        if(high < 0.0 && samples[i] >= 0.9 * target)
+            high = t;
+        if(std::fabs(samples[i] - target) > 0.05 * target)
+            r.settle = t + SAMPLE;
+        if(t >= DURATION - 1.0)
+        {
+            error += (samples[i] - target) / target * 100.0;
+            tail++;
+        }
+        peak = std::max(peak, samples[i]);
+    }
+    r.error     = tail ? error / tail : 0.0;
+    r.rise      = (low >= 0.0 && high >= 0.0) ? high - low : -1.0;
+    r.overshoot = std::max(0.0, (peak - target) / target * 100.0);
+    if(r.settle >= DURATION)
+        r.settle = -1.0;
+    return r;
+}
+
+int main (int argc, char** argv)
+{
+    // Start the stand-in and connect to it like the truck's motion controller
+    stand_in board;
+    MotionController motion_controller(board.port(), B57600);
+    while(!motion_controller.isReady())
+        boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+
+    // Open loop (the feedforward alone) against the default PI loop
+    SpeedController::parameters open = SpeedController::defaultParameters();
+    open.kp = 0.0;
+    open.ki = 0.0;
+    SpeedController openLoop(motion_controller, open);
+    SpeedController closedLoop(motion_controller);
+
+    // Conditions, a charged battery on the flat, a tired battery, and a hill
+    double targets[]   = { 1.5, 3.0, 1.5, 1.5 };
+    double batteries[] = { 1.0, 1.0, 0.8, 1.0 };
+    double grades[]    = { 0.0, 0.0, 0.0, 5.0 };
+    std::cout << "loop     target  battery  grade   latency (ms)  frame (ms)  writes/s  rise (s)  overshoot  settle (s)  error" << std::endl;
+    for(int loop = 0; loop < 2; loop++)
+    {
+        SpeedController& controller = loop ? closedLoop : openLoop;
+        motion_controller.registerCallback(&controller);
+        for(unsigned int k = 0; k < sizeof(targets) / sizeof(targets[0]); k++)
+        {
+            response r = step(board, controller, targets[k], batteries[k], grades[k]);
+            std::cout << std::left << std::setw(7) << (loop ? "PI" : "open") << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(8) << targets[k] << std::setw(8) << batteries[k] * 100.0 << "%" << std::setw(6) << grades[k] << "%"
+                      << std::setprecision(2) << std::setw(15) << r.latency << std::setw(12) << r.frameLatency
+                      << std::setprecision(1) << std::setw(10) << r.writes << std::setprecision(2) << std::setw(10) << r.rise
+                      << std::setprecision(1) << std::setw(10) << r.overshoot << "%" << std::setprecision(2) << std::setw(12) << r.settle
+                      << std::setprecision(1) << std::setw(6) << r.error << "%" << std::endl;
+        }
+        controller.stop();
+        motion_controller.unregisterCallback(&controller);
+    }
+    return 0;
+}
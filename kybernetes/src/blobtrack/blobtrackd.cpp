@@ -19,8 +19,14 @@
 
 // Kybernetes dependencies
 #include <kybernetes/sensor/uvccamera.hpp>
+#include <kybernetes/sensor/frame_source.hpp>
+#include <kybernetes/sensor/mjpeg_decoder.hpp>
+#include <kybernetes/sensor/ptz_worker.hpp>
+#include <kybernetes/sensor/frame_recorder.hpp>
+#include <kybernetes/sensor/auto_exposure.hpp>
 #include <kybernetes/network/serversocket.hpp>
 #include <kybernetes/cv/cv.hpp>
+#include <kybernetes/utility/clock.hpp>
 
 // OpenCV
 #include <opencv2/core/core.hpp>
@@ -38,23 +44,76 @@
 // Language deps
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <cstdlib>
 #include <vector>
 #include <cassert>
 #include <csignal>
 
 // Camera information
-kybernetes::sensor::UVCCamera     *camera;
+kybernetes::sensor::FrameSource   *source;
+kybernetes::sensor::UVCCamera     *camera = NULL;
+kybernetes::sensor::MJPEGDecoder  *decoder = NULL;
+kybernetes::sensor::FrameSource   *compressed = NULL;
+kybernetes::sensor::PTZWorker     *ptz = NULL;
+kybernetes::sensor::AutoExposure  *exposure = NULL;
+
+// Recording of every frame from the camera (while one is being made)
+kybernetes::sensor::FrameRecorder *recorder = NULL;
+boost::mutex                       recorder_mutex;
+unsigned int                       jpeg_scale = 0;
 int                                width;            
 int                                height;           
 int                                port;
 int                                pt_response;
 bool                               should_track;
 
-// Resources for imaging
-struct v4l2_buffer                 image_buffer;
-void*                              image_data = NULL;
-size_t                             image_size;
+// Newest image, shared with the clients, its size and format and whether it was captured at
+// full rate
+kybernetes::sensor::Frame          image_frame;
+unsigned int                       image_width = 0;
+unsigned int                       image_height = 0;
+unsigned int                       image_format = 0;
+bool                               image_active = false;
+
+// The work done follows demand.  Idle, a frame is captured now and then to keep the camera and
+// its exposure going, frames are captured and decoded at full rate and size while a client
+// wants them, and thresholded too while one wants blobs.
+enum
+{
+    MODE_IDLE = 0,
+    MODE_FRAMES,
+    MODE_BLOBS
+};
+const char                        *mode_names[] = { "idle", "frames", "blobs" };
+int                                mode = MODE_IDLE;
+
+// Clients subscribed to frames and to blobs, whether a recording is being made, and when a
+// client last asked for either without subscribing, which keeps them coming for a while
+boost::mutex                       demand_mutex;
+boost::condition_variable          demand_condition;
+unsigned int                       frame_subscribers = 0;
+unsigned int                       blob_subscribers = 0;
+bool                               recording = false;
+double                             frame_demand_time = -1.0e9;
+double                             blob_demand_time = -1.0e9;
+const double                       demand_linger = 2.0;
+
+// Idle, a frame is captured this often (s), with the camera at this frame rate and frames
+// decoded this many times smaller
+const double                       keepalive_period = 1.0;
+const unsigned int                 idle_frame_rate = 5;
+const unsigned int                 idle_scale = 8;
+
+// Processor use (fraction of a core, all threads) of the daemon in each mode, measured over
+// this long (s)
+double                             mode_load[] = { 0.0, 0.0, 0.0 };
+const double                       load_period = 5.0;
+
+// A capture that fails is retried after this long (s), and the source is given up on after this
+// many failures in a row (a camera unplugged, or a recording that has ended)
+const double                       capture_retry = 0.1;
+const unsigned int                 capture_attempts = 20;
 
 // Image tracking resultant                 
 void*                              image_resultant = NULL;
@@ -67,12 +126,15 @@ uint8_t                            u_min = 0;
 uint8_t                            v_max = 0;
 uint8_t                            v_min = 0;
 
+// Mean luma the exposure is held at
+double                             luma_target = 110.0;
+
 // Blob
 CvRect                             boundingBox;
 
 // Synchronization for resources
 boost::shared_mutex                 image_data_mutex;
-boost::condition_variable           image_data_condition;
+boost::condition_variable_any       image_data_condition;
 
 boost::shared_mutex                 image_resultant_mutex;
 boost::condition_variable           image_resultant_condition;
@@ -91,55 +153,238 @@ void handle_sigint (int sig)
     __kill = true;
 }
 
+// The mode the clients want, call with the demand lock held
+int demanded()
+{
+    double now = kybernetes::utility::monotonicTime();
+    if(blob_subscribers || now - blob_demand_time < demand_linger)
+        return MODE_BLOBS;
+    if(frame_subscribers || recording || now - frame_demand_time < demand_linger)
+        return MODE_FRAMES;
+    return MODE_IDLE;
+}
+
+// Change a subscription of a client
+void subscribe(bool& subscribed, bool wanted, unsigned int& subscribers)
+{
+    boost::mutex::scoped_lock lock(demand_mutex);
+    if(subscribed != wanted)
+    {
+        if(wanted)
+            subscribers++;
+        else
+            subscribers--;
+        subscribed = wanted;
+        demand_condition.notify_all();
+    }
+}
+
+// A recording wants every frame
+void record(bool wanted)
+{
+    boost::mutex::scoped_lock lock(demand_mutex);
+    recording = wanted;
+    demand_condition.notify_all();
+}
+
+// Ask for frames or blobs once, they keep coming for a while
+void demand(double& time)
+{
+    boost::mutex::scoped_lock lock(demand_mutex);
+    time = kybernetes::utility::monotonicTime();
+    demand_condition.notify_all();
+}
+
 // Thread to handle image capture and processing
 void image_process_thread(const char* device)
 {
-    // Local copy of image data
-    struct v4l2_buffer buffer;
-    void*              data;
-    size_t             size;
+    // Local reference to the image being processed
+    kybernetes::sensor::Frame frame;
     void*              resultant;
-    void*              erosion;
 
-    // Start the camera
-    camera = new kybernetes::sensor::UVCCamera(device, width, height, V4L2_PIX_FMT_YUYV);
-    std::cout << " >> Using camera on: " << device << std::endl;
+    // Start the camera (a buffer each for capture, processing and the clients), or play a
+    // recording or synthetic images in its place
+    if(std::string(device).compare(0, 5, "/dev/") == 0)
+    {
+        // MJPEG keeps the camera at full frame rate, decoded (and scaled) for tracking
+        // (a camera that falls back to another format can't be decoded)
+        unsigned int format = jpeg_scale ? V4L2_PIX_FMT_MJPEG : V4L2_PIX_FMT_YUYV;
+        camera = new kybernetes::sensor::UVCCamera(device, width, height, format, 8);
+        if(!camera->isOpen() || camera->imageFormat() != format)
+        {
+            std::cerr << " << Could not open " << device << (jpeg_scale ? " for MJPEG" : "") << std::endl;
+            delete camera;
+            camera = NULL;
+            __kill = true;
+            return;
+        }
+        if(jpeg_scale)
+        {
+            compressed = camera;
+            source = decoder = new kybernetes::sensor::MJPEGDecoder(*camera, jpeg_scale);
+            std::cout << " >> Using MJPEG camera on: " << device << " at 1/" << jpeg_scale << " scale" << std::endl;
+        } else
+        {
+            source = camera;
+            std::cout << " >> Using camera on: " << device << std::endl;
+        }
+        
+        // Always work on the newest frame, processing is slower than the camera
+        camera->set_latest_only(true);
+    } else if((source = kybernetes::sensor::openFrameSource(device, width, height)) != NULL)
+    {
+        std::cout << " >> Using images from: " << device << std::endl;
+        
+        // A recording of an MJPEG camera is decoded as the camera would be
+        if(source->imageFormat() == V4L2_PIX_FMT_MJPEG)
+        {
+            compressed = source;
+            source = decoder = new kybernetes::sensor::MJPEGDecoder(*compressed, jpeg_scale ? jpeg_scale : 1);
+        }
+    } else
+    {
+        std::cerr << " << Could not open " << device << std::endl;
+        __kill = true;
+        return;
+    }
     
-    // Wait for camera to initialize by requesting a frame
-    camera->capture_buffer(&buffer, &data, &size);
-    camera->release_buffer(&buffer);
+    // Wait for the source to initialize by requesting a frame, a source that can't give one
+    // is closed again
+    if(source->capture(frame))
+    {
+        std::cerr << " << Could not capture from " << device << std::endl;
+        __kill = true;
+    }
+    frame.release();
+    width  = source->imageWidth();
+    height = source->imageHeight();
     
-    // Reset the pan/tilt turret of the camera
-    camera->ptz_reset();
+    // Reset the pan/tilt turret of the camera, it is moved from its own thread so capture
+    // never waits on the control transfers
+    if(camera && !__kill)
+    {
+        ptz = new kybernetes::sensor::PTZWorker(*camera);
+        ptz->reset();
+        
+        // Hold the exposure steady so the colors being tracked don't move with the camera's
+        exposure = new kybernetes::sensor::AutoExposure(*camera);
+        if(!exposure->isAvailable())
+        {
+            delete exposure;
+            exposure = NULL;
+        }
+    }
     
     // Create the structuring element for image erosion
     int erosion_size = 2;
     cv::Mat element = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(2*erosion_size + 1, 2*erosion_size + 1), cv::Point(erosion_size, erosion_size));
+    
+    // The camera's frame rate and the decoding scale used while active
+    unsigned int full_rate  = camera ? (unsigned int) (camera->frame_rate() + 0.5) : 0;
+    unsigned int full_scale = decoder ? decoder->scale() : 1;
+    
+    // Start of the current measurement of processor use
+    double load_time      = kybernetes::utility::monotonicTime();
+    double load_processor = kybernetes::utility::processorTime();
+    int    current        = -1;
+    
+    // Captures failed in a row
+    unsigned int failures = 0;
 
     // Loop while not killed
     while(!__kill)
     {
-        // Capture a new image buffer, release the old, and wake threads waiting for a new image
+        // Follow the demand of the clients
+        int wanted;
+        {
+            boost::mutex::scoped_lock lock(demand_mutex);
+            wanted = demanded();
+        }
+        
+        // Measure the processor use of the mode, then change it.  Idle the camera runs slow and
+        // frames are decoded small.
+        double now = kybernetes::utility::monotonicTime();
+        if(wanted != current || now - load_time >= load_period)
+        {
+            double processor = kybernetes::utility::processorTime();
+            if(current >= 0)
+            {
+                boost::mutex::scoped_lock lock(demand_mutex);
+                mode_load[current] = (processor - load_processor) / std::max(now - load_time, 1.0e-3);
+            }
+            if(wanted != current)
+            {
+                std::cout << " >> Mode " << mode_names[wanted];
+                if(current >= 0)
+                    std::cout << " (" << mode_names[current] << " used " << mode_load[current] * 100.0 << "% of a core)";
+                std::cout << std::endl;
+                if(camera && full_rate)
+                    camera->set_frame_rate((wanted == MODE_IDLE) ? idle_frame_rate : full_rate);
+                if(decoder)
+                    decoder->setScale((wanted == MODE_IDLE) ? std::max(idle_scale, full_scale) : full_scale);
+                boost::mutex::scoped_lock lock(demand_mutex);
+                mode = current = wanted;
+            }
+            load_time      = now;
+            load_processor = processor;
+        }
+        
+        // Capture a new image, share it, and wake threads waiting for a new image
         {
-            // Capture an image and get the system buffer
-            camera->capture_buffer(&buffer, &data, &size);
+            // Capture an image, waiting a moment before trying again and giving up on a source
+            // that keeps failing
+            if(source->capture(frame))
+            {
+                if(++failures >= capture_attempts)
+                {
+                    std::cerr << " << Giving up on " << device << " after " << failures << " failed captures" << std::endl;
+                    __kill = true;
+                    break;
+                }
+                boost::this_thread::sleep(boost::posix_time::milliseconds((long) (capture_retry * 1000.0)));
+                continue;
+            }
+            failures = 0;
+            width  = source->imageWidth();
+            height = source->imageHeight();
             
             // Get a unique lock to the image data
             boost::unique_lock<boost::shared_mutex> uniqueLock(image_data_mutex);
             
-            // Check if we have an old image buffer, if so release it
-            if(image_data) 
-                camera->release_buffer(&image_buffer);
-            
-            // Update the shared data with the new image buffer
-            image_buffer = buffer;
-            image_data = data;
-            image_size = size;
+            // Update the shared image, the old one goes back to the source once no one holds it
+            image_frame  = frame;
+            image_width  = width;
+            image_height = height;
+            image_format = source->imageFormat();
+            image_active = (current != MODE_IDLE);
             
             // Alert potential other threads that we now have an image
             image_data_condition.notify_all();
         }
         
+        // Correct the exposure from the frame's luma
+        if(exposure)
+        {
+            boost::shared_lock<boost::shared_mutex> rangeLock(range_mutex);
+            exposure->setTarget(luma_target);
+            rangeLock.unlock();
+            exposure->update(frame, width, height, source->imageFormat());
+        }
+        
+        // Idle, wait for the next keepalive or for a client to want something
+        if(current == MODE_IDLE)
+        {
+            boost::mutex::scoped_lock lock(demand_mutex);
+            boost::system_time until = boost::get_system_time() + boost::posix_time::milliseconds((long) (keepalive_period * 1000.0));
+            while(!__kill && demanded() == MODE_IDLE && demand_condition.timed_wait(lock, until))
+                continue;
+            continue;
+        }
+        
+        // Only threshold while a client wants blobs
+        if(current != MODE_BLOBS)
+            continue;
+        
         // Perform morphology to get the new image resultant for labeling
         {
             // Allocate a new buffer for image operations result
@@ -151,7 +396,12 @@ void image_process_thread(const char* device)
             
             // Perform the bithreshold operation
             boost::shared_lock<boost::shared_mutex> rangeLock(range_mutex);
-            kybernetes::cv::yuv422_bithreshold(data, threshold_result.ptr(), width, height, y_min, u_min, v_min, y_max, u_max, v_max);
+            if(source->imageFormat() == V4L2_PIX_FMT_YUV422P)
+                kybernetes::cv::yuv422p_bithreshold(frame.data(), threshold_result.ptr(), width, height, y_min, u_min, v_min, y_max, u_max, v_max);
+            else if(source->imageFormat() == V4L2_PIX_FMT_YUV420)
+                kybernetes::cv::yuv420p_bithreshold(frame.data(), threshold_result.ptr(), width, height, y_min, u_min, v_min, y_max, u_max, v_max);
+            else
+                kybernetes::cv::yuv422_bithreshold((void *) frame.data(), threshold_result.ptr(), width, height, y_min, u_min, v_min, y_max, u_max, v_max);
             rangeLock.unlock();
             
             // Perform erosion operation
@@ -169,7 +419,22 @@ void image_process_thread(const char* device)
     }
 
     // Close the camera
-    delete camera;
+    std::cout << " << Skipped " << source->dropped() << " frames" << std::endl;
+    frame.release();
+    {
+        boost::mutex::scoped_lock lock(recorder_mutex);
+        if(recorder)
+        {
+            camera->unregister_callback(recorder);
+            delete recorder;
+            recorder = NULL;
+        }
+    }
+    delete exposure;
+    delete ptz;
+    delete source;
+    if(decoder)
+        delete compressed;
     std::cout << " << Camera closed" << std::endl;
 }
 
@@ -182,6 +447,11 @@ void client_handle_thread(kybernetes::network::Socket *client)
     std::string      message;
     std::string      response;
     bool             valid = true;
+    kybernetes::sensor::Frame attachment;
+    
+    // What the client subscribed to
+    bool             frames = false;
+    bool             blobs = false;
     
     // Alert that a client has connected
     std::cout << " >> Client Connected" << std::endl;
@@ -247,8 +517,121 @@ void client_handle_thread(kybernetes::network::Socket *client)
             
             // Encode JSON
             response = jsonWriter.write(r);
+        } else if(root["command"].asString() == "get_frame")
+        {
+            // Wake the capture if it is idle, and wait (a little) for a full size image
+            demand(frame_demand_time);
+            boost::shared_lock<boost::shared_mutex> lock(image_data_mutex);
+            boost::system_time until = boost::get_system_time() + boost::posix_time::seconds(1);
+            while(!image_active && image_data_condition.timed_wait(lock, until))
+                continue;
+            
+            // Hold the newest image, it is sent straight from the source's buffer after the reply
+            attachment = image_frame;
+            lock.unlock();
+            
+            // Describe the image that follows
+            Json::Value r;
+            r["response"] = attachment.empty() ? "nack" : "ack";
+            r["command"] = "get_frame";
+            r["data"]["width"] = image_width;
+            r["data"]["height"] = image_height;
+            r["data"]["format"] = image_format;
+            r["data"]["size"] = (Json::UInt) attachment.size();
+            r["data"]["timestamp"] = attachment.timestamp();
+            r["data"]["sequence"] = attachment.sequence();
+            response = jsonWriter.write(r);
+        } else if(root["command"].asString() == "start_recording")
+        {
+            // Record every frame from the camera to a file, as it comes off the camera
+            boost::mutex::scoped_lock lock(recorder_mutex);
+            Json::Value r;
+            r["command"] = "start_recording";
+            r["response"] = "nack";
+            if(camera && !recorder)
+            {
+                std::string path = root["data"].get("path", "blobtrackd.rec").asString();
+                recorder = new kybernetes::sensor::FrameRecorder(path, camera->imageWidth(), camera->imageHeight(), camera->imageFormat());
+                if(recorder->isOpen())
+                {
+                    // Record at full rate
+                    record(true);
+                    recorder->setTurret(ptz);
+                    camera->register_callback(recorder);
+                    r["response"] = "ack";
+                    std::cout << " >> Recording to " << path << std::endl;
+                } else
+                {
+                    delete recorder;
+                    recorder = NULL;
+                }
+            }
+            response = jsonWriter.write(r);
+        } else if(root["command"].asString() == "stop_recording")
+        {
+            // Finish the recording
+            boost::mutex::scoped_lock lock(recorder_mutex);
+            Json::Value r;
+            r["command"] = "stop_recording";
+            r["response"] = recorder ? "ack" : "nack";
+            if(recorder)
+            {
+                camera->unregister_callback(recorder);
+                recorder->close();
+                r["data"]["frames"] = (Json::UInt) recorder->frames();
+                r["data"]["dropped"] = (Json::UInt) recorder->dropped();
+                r["data"]["bytes"] = (Json::UInt64) recorder->bytes();
+                std::cout << " << Recorded " << recorder->frames() << " frames, dropped " << recorder->dropped() << std::endl;
+                delete recorder;
+                recorder = NULL;
+                record(false);
+            }
+            response = jsonWriter.write(r);
+        } else if(root["command"].asString() == "subscribe")
+        {
+            // Keep frames or blobs coming while this client is connected
+            subscribe(frames, root["data"].get("frames", frames).asBool(), frame_subscribers);
+            subscribe(blobs, root["data"].get("blobs", blobs).asBool(), blob_subscribers);
+            
+            // Return an acknowledgement
+            Json::Value r;
+            r["response"] = "ack";
+            r["command"] = "subscribe";
+            r["data"]["frames"] = frames;
+            r["data"]["blobs"] = blobs;
+            response = jsonWriter.write(r);
+        } else if(root["command"].asString() == "get_status")
+        {
+            // The mode, who wants what, and the processor use in each mode
+            boost::mutex::scoped_lock lock(demand_mutex);
+            Json::Value r;
+            r["response"] = "ack";
+            r["command"] = "get_status";
+            r["data"]["mode"] = mode_names[mode];
+            r["data"]["frame_subscribers"] = frame_subscribers;
+            r["data"]["blob_subscribers"] = blob_subscribers;
+            for(int m = MODE_IDLE; m <= MODE_BLOBS; m++)
+                r["data"]["load"][mode_names[m]] = mode_load[m];
+            if(camera)
+                r["data"]["frame_rate"] = camera->frame_rate();
+            response = jsonWriter.write(r);
+        } else if(root["command"].asString() == "set_exposure")
+        {
+            // Change the mean luma the exposure is held at
+            boost::unique_lock<boost::shared_mutex> lock(range_mutex);
+            luma_target = root["data"].get("target", luma_target).asDouble();
+            
+            // Return an acknowledgement
+            Json::Value r;
+            r["response"] = exposure ? "ack" : "nack";
+            r["command"] = "set_exposure";
+            r["data"]["target"] = luma_target;
+            response = jsonWriter.write(r);
         } else if(root["command"].asString() == "get_blob")
         {
+            // Wake the thresholding if nobody else wants it
+            demand(blob_demand_time);
+            
             // Lock the blob information
             
         }
@@ -269,8 +652,19 @@ void client_handle_thread(kybernetes::network::Socket *client)
             valid = false;
             break;
         }
+        
+        // Send an image after its reply, then let the source have it back
+        if(!attachment.empty())
+        {
+            valid = client->write((void *) attachment.data(), attachment.size());
+            attachment.release();
+        }
     }
 
+    // Drop the client's subscriptions
+    subscribe(frames, false, frame_subscribers);
+    subscribe(blobs, false, blob_subscribers);
+    
     // Close connection to client
     std::cout << " << Client disconnected" << std::endl;
     delete client;
@@ -283,8 +677,8 @@ int main(int argc, char **argv)
     if(argc < 6)
     {
         std::cerr << "Error: Too Few Arguments" << std::endl;
-        std::cerr << "Usage: " << argv[0] << " <video device file> <width> <height> <port> <pt response per pixel error>" << std::endl;
-        std::cerr << "   (e.g. " << argv[0] << " /dev/video0 640 480 8080 4)" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <video device file | recording | synthetic> <width> <height> <port> <pt response per pixel error> [mjpeg scale]" << std::endl;
+        std::cerr << "   (e.g. " << argv[0] << " /dev/video0 640 480 8080 4, or " << argv[0] << " /dev/video0 1280 720 8080 4 4)" << std::endl;
         return 1;
     }
     
@@ -305,6 +699,10 @@ int main(int argc, char **argv)
     pt_response      = atoi(argv[5]);
     should_track     = false;
     
+    // Capture MJPEG, decoded at 1/scale (1, 2 or 4) of the capture size, if asked to
+    if(argc > 6)
+        jpeg_scale   = atoi(argv[6]);
+    
     // Start the image processing thread
     boost::thread processing_thread(image_process_thread, argv[1]);
     
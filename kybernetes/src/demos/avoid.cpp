@@ -27,6 +27,10 @@
 // Kybernetes deps
 #include <kybernetes/controller/sensor_controller.hpp>
 #include <kybernetes/controller/motion_controller.hpp>
+#include <kybernetes/sensor/razorgyro.hpp>
+#include <kybernetes/navigation/dead_reckoning.hpp>
+#include <kybernetes/navigation/occupancy_grid.hpp>
+#include <kybernetes/navigation/vector_field_histogram.hpp>
 
 // Flags
 volatile bool __kill = false;
@@ -39,87 +43,122 @@ void handle_sigint (int sig)
 }
 
 // Demo object
-class avoid_demo : public kybernetes::controller::SensorController::callback, public kybernetes::controller::MotionController::callback
+class avoid_demo : public kybernetes::controller::SensorController::callback, public kybernetes::controller::MotionController::callback,
+                   public kybernetes::sensor::IMU::callback, public kybernetes::navigation::OccupancyGrid::callback
 {
     // Motion controller interface object
     kybernetes::controller::MotionController *motion_controller;
     
     // Sensor controller interface object
     kybernetes::controller::SensorController *sensor_controller;
+    
+    // IMU sensor control object
+    kybernetes::sensor::IMU                  *imu;
+    
+    // Odometry (no gps, the grid has to move with the robot), the obstacle map and the avoidance
+    kybernetes::navigation::DeadReckoning        odometry;
+    kybernetes::navigation::OccupancyGrid        grid;
+    kybernetes::navigation::VectorFieldHistogram avoidance;
+    
+    // Heading to hold, the one we start out on
+    double                                    m_goal;
+    bool                                      m_haveGoal;
 public:
     // Construct the avoidance demo
-    avoid_demo()
+    avoid_demo() : odometry(kybernetes::math::LocalFrame()), grid(odometry), avoidance(grid.configuration()), m_goal(0.0), m_haveGoal(false)
     {
+        // Listen to the obstacle map
+        grid.registerCallback(this);
+        
         // Start the motion controller
         motion_controller = new kybernetes::controller::MotionController("/dev/kybernetes/motion_controller", B57600);
+        motion_controller->registerCallback(&odometry);
         motion_controller->registerCallback(this);
         
+        // Start the razor imu
+        imu = new kybernetes::sensor::RazorGyro("/dev/kybernetes/imu", B57600);
+        imu->registerCallback(&odometry);
+        imu->registerCallback(this);
+        
         // Start the sensor controller
         sensor_controller = new kybernetes::controller::SensorController("/dev/kybernetes/sensor_controller", B57600);
+        sensor_controller->registerCallback(&grid);
         sensor_controller->registerCallback(this);
+        
+        // Stop on a front bumper or anything within 30 cm without waiting on the callbacks
+        sensor_controller->setReflex(motion_controller, BUMPER_FRONT_LEFT | BUMPER_FRONT_RIGHT, (unsigned short) (0.3 / SONAR_METERS_PER_UNIT));
     }
     
     // Stop the avoidance demo
     ~avoid_demo()
     {
+        // The reflex mustn't outlive the motion controller
+        sensor_controller->setReflex(NULL, 0, 0);
+        
         // Unregister the motion controller callback, and close the motion controller
         motion_controller->unregisterCallback(this);
+        motion_controller->unregisterCallback(&odometry);
         delete motion_controller;
         
         // Unregister the sensor controller callback, and close the sensor controller
         sensor_controller->unregisterCallback(this);
+        sensor_controller->unregisterCallback(&grid);
         delete sensor_controller;
+        
+        // Unregister the imu callback, and close the imu
+        imu->unregisterCallback(this);
+        imu->unregisterCallback(&odometry);
+        delete imu;
+        
+        // Stop listening to the obstacle map
+        grid.unregisterCallback(this);
+    }
+    
+    // The IMU updated, the first heading becomes the one to hold
+    void imu_event_update(kybernetes::sensor::IMU::state state)
+    {
+        if(!m_haveGoal)
+        {
+            m_goal = state.yaw;
+            m_haveGoal = true;
+            std::cout << "Holding heading = " << m_goal << std::endl;
+        }
     }
     
     // Sensors updated callback
     void sensors_event_update(kybernetes::controller::SensorController::state state)
     {
-        // If we see something straight ahead
-        if(state.sonars[2] < 90)
+        // Output sonar readings
+        std::cout << "Soanrs = ";
+        for(int i = 0; i < 5; i++)
         {
-            // We need to react fast, but react based on if the obstacle more to
-            // the left than the right.
-            if(state.sonars[1] < state.sonars[3])
-            {
-                motion_controller->setDrift(-500);
-            } else
-            {
-                motion_controller->setDrift(500);
-            }
+            std::cout << state.sonars[i] << "\t";
         }
+        std::cout << std::endl;
+    }
+    
+    // The obstacle map took in a sonar reading
+    void occupancy_event_update(const kybernetes::navigation::OccupancyGrid& map)
+    {
+        // Nothing to hold yet
+        if(!m_haveGoal)
+            return;
         
-        // Is an obstacle visible to our left or right of center
-        else if(state.sonars[1] < 90)
-        {
-            motion_controller->setDrift(-500);
-        } else if(state.sonars[3] < 90)
-        {
-            motion_controller->setDrift(500);
-        }
+        // Pick the free direction closest to the heading we are holding
+        kybernetes::navigation::VectorFieldHistogram::result result = avoidance.compute(map, m_goal);
         
-        // Is an obstacle slightly to our left or right
-        else if(state.sonars[0] < 90)
+        // Boxed in, stop until something moves
+        if(result.blocked)
         {
-            motion_controller->setDrift(-350);
-        } else if(state.sonars[4] < 90)
-        {
-            motion_controller->setDrift(350);
+            motion_controller->setThrottle(0);
+            std::cout << "Blocked" << std::endl;
+            return;
         }
         
-        // If there is no obstacle of any threat
-        else
-            motion_controller->setDrift(0);
-        
-        // Make sure the robot is traversing
+        // Steer for it and make sure the robot is traversing
+        motion_controller->setDrift(result.drift);
         motion_controller->setThrottle(20);
-        
-        // Output sonar readings
-        std::cout << "Soanrs = ";
-        for(int i = 0; i < 5; i++)
-        {
-            std::cout << state.sonars[i] << "\t";
-        }
-        std::cout << std::endl;
+        std::cout << "Direction = " << result.direction << ", wheel position = " << result.drift << std::endl;
     }
     
     // Motion controller updated callback
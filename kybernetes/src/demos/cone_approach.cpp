@@ -0,0 +1,211 @@
+/*
+ *  cone_approach.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Language deps
+#include <iostream>
+#include <signal.h>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+// Kybernetes deps
+#include <kybernetes/controller/sensor_controller.hpp>
+#include <kybernetes/controller/motion_controller.hpp>
+#include <kybernetes/controller/visual_servo.hpp>
+#include <kybernetes/sensor/razorgyro.hpp>
+#include <kybernetes/sensor/uvccamera.hpp>
+#include <kybernetes/cv/cv.hpp>
+
+// Size of the camera images
+#define IMAGE_WIDTH  320
+#define IMAGE_HEIGHT 240
+
+// Fewest pixels in range for the cone to have been seen
+#define MINIMUM_PIXELS 50
+
+// Flags
+volatile bool __kill = false;
+
+// Catch the kill signal
+void handle_sigint (int sig)
+{
+    std::cout << "Terminating" << std::endl;
+    __kill = true;
+}
+
+// Demo object, drives at a colored cone until the front bumper touches it
+class cone_approach_demo
+{
+    // Motion controller interface object
+    kybernetes::controller::MotionController *motion_controller;
+    
+    // Sensor controller interface object
+    kybernetes::controller::SensorController *sensor_controller;
+    
+    // IMU sensor control object
+    kybernetes::sensor::IMU                  *imu;
+    
+    // The camera and the steering toward what it sees
+    kybernetes::sensor::UVCCamera            *camera;
+    kybernetes::controller::VisualServo      *servo;
+    
+    // Color range of the cone (YUV) and the throttle to approach at
+    uint8_t                                   m_low[3];
+    uint8_t                                   m_high[3];
+    unsigned short                            m_throttle;
+    
+public:
+    // Construct the cone approach demo
+    cone_approach_demo(const uint8_t low[3], const uint8_t high[3], unsigned short throttle) : m_throttle(throttle)
+    {
+        std::copy(low, low + 3, m_low);
+        std::copy(high, high + 3, m_high);
+        
+        // Start the camera looking straight ahead
+        camera = new kybernetes::sensor::UVCCamera("/dev/video0", IMAGE_WIDTH, IMAGE_HEIGHT, V4L2_PIX_FMT_YUYV, 4);
+        camera->set_latest_only(true);
+        camera->ptz_reset();
+        
+        // Start the motion controller and the steering (across the image the driver gave us)
+        motion_controller = new kybernetes::controller::MotionController("/dev/kybernetes/motion_controller", B57600);
+        servo = new kybernetes::controller::VisualServo(*motion_controller, camera->imageWidth());
+        
+        // Start the razor imu, the servo keeps its headings
+        imu = new kybernetes::sensor::RazorGyro("/dev/kybernetes/imu", B57600);
+        imu->registerCallback(servo);
+        
+        // Start the sensor controller, touching the cone stops the truck
+        sensor_controller = new kybernetes::controller::SensorController("/dev/kybernetes/sensor_controller", B57600);
+        sensor_controller->setReflex(motion_controller, BUMPER_FRONT_LEFT | BUMPER_FRONT_RIGHT, 0);
+    }
+    
+    // Stop the cone approach demo
+    ~cone_approach_demo()
+    {
+        // Close the camera
+        delete camera;
+        
+        // The reflex mustn't outlive the motion controller
+        sensor_controller->setReflex(NULL, 0, 0);
+        delete sensor_controller;
+        
+        // Unregister the servo and close the imu
+        imu->unregisterCallback(servo);
+        delete imu;
+        
+        // Close the motion controller
+        delete servo;
+        delete motion_controller;
+    }
+    
+    // Demo main method, steers on every frame
+    void run()
+    {
+        // The driver may not have granted the size asked for
+        unsigned int         width  = camera->imageWidth();
+        unsigned int         height = camera->imageHeight();
+        std::vector<uint8_t> mask(width * height);
+        
+        // The reflex has stopped the truck once more when the bumper touches the cone
+        unsigned int         touches = sensor_controller->reflexes();
+        while(!__kill)
+        {
+            // Wait for a frame
+            struct v4l2_buffer buffer;
+            void*              data;
+            size_t             size;
+            double             timestamp;
+            if(camera->capture_buffer(&buffer, &data, &size, &timestamp))
+                break;
+            int    pan       = camera->pan();
+            
+            // Find the pixels of the cone's color and return the frame to the camera
+            kybernetes::cv::yuv422_bithreshold(data, &mask[0], width, height, m_low[0], m_low[1], m_low[2], m_high[0], m_high[1], m_high[2]);
+            camera->release_buffer(&buffer);
+            
+            // The cone is at the mean column of the pixels found
+            unsigned long count = 0, sum = 0;
+            for(size_t i = 0; i < mask.size(); i++)
+            {
+                if(mask[i])
+                {
+                    count++;
+                    sum += i % width;
+                }
+            }
+            
+            // Wait for the gyro to give a heading
+            if(!servo->isReady())
+                continue;
+            
+            // Steer toward the cone (or where it was last seen)
+            kybernetes::controller::VisualServo::command command = (count >= MINIMUM_PIXELS) ? servo->observe((double) sum / count, pan, timestamp) : servo->hold(timestamp);
+            std::cout << "Bearing = " << command.bearing << ", Error = " << command.error << ", wheel position = " << command.drift << ", Latency = " << command.latency * 1000.0 << " ms" << (command.locked ? "" : " (lost)") << std::endl;
+            
+            // The bumper touched the cone
+            if(sensor_controller->reflexes() != touches)
+            {
+                std::cout << "Touched the cone" << std::endl;
+                break;
+            }
+            
+            // Keep going at speed while the cone is in sight
+            motion_controller->setThrottle(command.locked ? m_throttle : 0);
+        }
+        
+        // Stop the robot before terminating the demo
+        motion_controller->setThrottle(0);
+        
+        // Alert
+        std::cerr << "Demo has stopped, " << camera->dropped() << " frames skipped" << std::endl;
+    }
+};
+
+int main (int argc, char** argv)
+{
+    // Check that we have the color range
+    if(argc < 7)
+    {
+        std::cerr << "Usage: " << argv[0] << " <y min> <u min> <v min> <y max> <u max> <v max> [throttle]" << std::endl;
+        return 1;
+    }
+    uint8_t low[3]  = { (uint8_t) atoi(argv[1]), (uint8_t) atoi(argv[2]), (uint8_t) atoi(argv[3]) };
+    uint8_t high[3] = { (uint8_t) atoi(argv[4]), (uint8_t) atoi(argv[5]), (uint8_t) atoi(argv[6]) };
+    unsigned short throttle = (argc > 7) ? atoi(argv[7]) : 80;
+    
+    // Add a handler for Control-C
+    struct sigaction sigIntHandler;
+    sigIntHandler.sa_handler = handle_sigint;
+    sigemptyset(&sigIntHandler.sa_mask);
+    sigIntHandler.sa_flags = 0;
+    sigaction(SIGINT, &sigIntHandler, NULL);
+    
+    // Ignore sigpipe
+    signal(SIGPIPE, SIG_IGN);
+    
+    // Create the object representing the demo
+    cone_approach_demo demo(low, high, throttle);
+    
+    // Run the demo
+    demo.run();
+    
+    // Return success
+    return 0;
+}
@@ -22,13 +22,23 @@
 #include <signal.h>
 #include <fstream>
 #include <iomanip>
-#include <list>
+#include <algorithm>
+#include <cmath>
 
 // Kybernetes deps
 #include <kybernetes/controller/sensor_controller.hpp>
 #include <kybernetes/controller/motion_controller.hpp>
+#include <kybernetes/controller/watchdog.hpp>
 #include <kybernetes/sensor/razorgyro.hpp>
 #include <kybernetes/sensor/garmingps.hpp>
+#include <kybernetes/math/route.hpp>
+#include <kybernetes/math/geofence.hpp>
+#include <kybernetes/navigation/dead_reckoning.hpp>
+#include <kybernetes/navigation/occupancy_grid.hpp>
+#include <kybernetes/navigation/path_planner.hpp>
+#include <kybernetes/navigation/obstacle_map.hpp>
+#include <kybernetes/navigation/pure_pursuit.hpp>
+#include <kybernetes/utility/clock.hpp>
 
 // Flags
 volatile bool __kill = false;
@@ -43,7 +53,8 @@ void handle_sigint (int sig)
 // Demo program
 class gps_navigate_demo
     : public kybernetes::controller::MotionController::callback, public kybernetes::controller::SensorController::callback,
-      public kybernetes::sensor::IMU::callback, public kybernetes::sensor::GPS::callback
+      public kybernetes::sensor::IMU::callback, public kybernetes::sensor::GPS::callback,
+      public kybernetes::navigation::DeadReckoning::callback, public kybernetes::navigation::PathPlanner::callback
 {
     // Hardware interface objects
     kybernetes::controller::MotionController   *motion_controller;
@@ -51,98 +62,250 @@ class gps_navigate_demo
     kybernetes::sensor::IMU                    *imu;
     kybernetes::sensor::GPS                    *gps;
     
-    // Information about our path
-    std::list<kybernetes::math::GeoCoordinate> &m_path;
-    float                                       m_goal;
+    // Stops the truck if steering or throttle stall
+    kybernetes::controller::Watchdog           *watchdog;
+    int                                         m_steeringLoop;
+    int                                         m_throttleLoop;
+    
+    // Position estimate between fixes
+    kybernetes::navigation::DeadReckoning       odometry;
+    bool                                        m_fix;
+    
+    // Obstacles seen by the sonars (on odometry the gps doesn't move) and the planner routing around them
+    kybernetes::navigation::DeadReckoning       sonar_odometry;
+    kybernetes::navigation::OccupancyGrid       grid;
+    kybernetes::navigation::PathPlanner         planner;
+    
+    // Obstacles remembered from run to run (on the gps anchored odometry, in the route's frame)
+    kybernetes::navigation::ObstacleMap         obstacles;
+    
+    // Information about our route, the planned path to the next waypoint along it and the
+    // steering decided on the last gyro update
+    const kybernetes::math::Route                &m_route;
+    boost::mutex                                  m_mutex;
+    kybernetes::math::Route                       m_path;
+    kybernetes::navigation::PurePursuit          *pursuit;
+    size_t                                        m_waypoint;
+    bool                                          m_blocked;
+    bool                                          m_finished;
+    kybernetes::navigation::PurePursuit::command  m_command;
+    bool                                          m_steering;
+    
+    // Course boundary, once we leave it we stop for good
+    const kybernetes::math::Geofence           &m_geofence;
+    bool                                        m_fenced;
     
 public:
     // Constructor for GPS navigation demo
-    gps_navigate_demo(std::list<kybernetes::math::GeoCoordinate>& path)
-        : m_path(path), m_goal(0.0)
+    gps_navigate_demo(const kybernetes::math::Route& route, const kybernetes::math::Geofence& geofence, const std::string& obstacleDirectory)
+        : odometry(route.frame()), m_fix(false), sonar_odometry(kybernetes::math::LocalFrame()), grid(sonar_odometry), planner(route, odometry),
+          obstacles(odometry, route.frame()), m_route(route), pursuit(NULL), m_waypoint(0), m_blocked(false), m_finished(false), m_steering(false), m_geofence(geofence), m_fenced(false)
     {
+        // Listen to the position estimate and the planner, the planner listens to the obstacle map
+        odometry.registerCallback(this);
+        grid.registerCallback(&planner);
+        planner.registerCallback(this);
+        grid.registerCallback(&obstacles);
+        
+        // Plan around what earlier runs saw before the sonars see anything
+        if(obstacleDirectory.size())
+        {
+            if(obstacles.open(obstacleDirectory))
+                std::cout << "Loaded " << planner.seed(obstacles) << " obstacle cells from \"" << obstacleDirectory << "\"" << std::endl;
+            else
+                std::cerr << "Could not open obstacle map \"" << obstacleDirectory << "\", obstacles won't be remembered" << std::endl;
+        }
+        
         // Start the motion controller
         motion_controller = new kybernetes::controller::MotionController("/dev/kybernetes/motion_controller", B57600);
+        motion_controller->registerCallback(&odometry);
+        motion_controller->registerCallback(&sonar_odometry);
         motion_controller->registerCallback(this);
         
+        // Watch the steering (imu rate) and throttle (telemetry rate) loops
+        watchdog = new kybernetes::controller::Watchdog(*motion_controller);
+        m_steeringLoop = watchdog->watch("steering", 0.2);
+        m_throttleLoop = watchdog->watch("throttle", 0.25);
+        
         // Start the sensor controller
         sensor_controller = new kybernetes::controller::SensorController("/dev/kybernetes/sensor_controller", B57600);
+        sensor_controller->registerCallback(&grid);
         sensor_controller->registerCallback(this);
         
+        // Stop on a front bumper or anything within 30 cm without waiting on the callbacks
+        sensor_controller->setReflex(motion_controller, BUMPER_FRONT_LEFT | BUMPER_FRONT_RIGHT, (unsigned short) (0.3 / SONAR_METERS_PER_UNIT));
+        
         // Start the razor imu
         imu = new kybernetes::sensor::RazorGyro("/dev/kybernetes/imu", B57600);
+        imu->registerCallback(&odometry);
+        imu->registerCallback(&sonar_odometry);
         imu->registerCallback(this);
         
         // Start the gps (Garmin 60csx)
         gps = new kybernetes::sensor::GarminGPS("/dev/kybernetes/gps", B9600);
         gps->registerCallback(this);
+        gps->registerCallback(&odometry);
     }
     
     // Deconstructor for the GPS navigation demo
     ~gps_navigate_demo()
     {
-        // Unregister all of the callbacks
+        // Unregister all of the callbacks and the reflex
+        sensor_controller->setReflex(NULL, 0, 0);
         motion_controller->unregisterCallback(this);
+        motion_controller->unregisterCallback(&sonar_odometry);
+        motion_controller->unregisterCallback(&odometry);
         sensor_controller->unregisterCallback(this);
+        sensor_controller->unregisterCallback(&grid);
         imu->unregisterCallback(this);
+        imu->unregisterCallback(&sonar_odometry);
+        imu->unregisterCallback(&odometry);
         gps->unregisterCallback(this);
+        gps->unregisterCallback(&odometry);
+        planner.unregisterCallback(this);
+        grid.unregisterCallback(&obstacles);
+        grid.unregisterCallback(&planner);
+        odometry.unregisterCallback(this);
+        
+        // Report the stalls
+        std::vector<kybernetes::controller::Watchdog::loop> loops = watchdog->loops();
+        for(std::vector<kybernetes::controller::Watchdog::loop>::iterator it = loops.begin(); it != loops.end(); ++it)
+            std::cout << "Loop " << it->name << ": " << it->overruns << " missed deadlines, longest gap " << it->worst * 1000.0 << " ms" << std::endl;
         
         // Close all of the hardware
+        delete watchdog;
         delete motion_controller;
         delete sensor_controller;
         delete imu;
         delete gps;
+        delete pursuit;
+        
+        // Write out what was seen this run
+        obstacles.close();
     }
     
-    // The IMU updated
+    // The IMU updated, steer toward the lookahead point on the planned path
     void imu_event_update(kybernetes::sensor::IMU::state state)
     {
-        // Calculate our directional error
-        float error = m_goal - state.yaw;
-        if(error >= 180) error -= 360;
-        if(error <= -180) error += 360;
+        // Wait until a fix has anchored the position estimate
+        if(!odometry.isReady())
+            return;
+        
+        // Carry the estimate from the last telemetry frame up to now along the fresh yaw
+        kybernetes::navigation::DeadReckoning::state estimate = odometry.fetchState();
+        double elapsed = std::min(kybernetes::utility::monotonicTime() - estimate.timestamp, 0.1);
+        double heading = state.yaw * (M_PI / 180.0);
+        kybernetes::math::LocalCoordinate position(estimate.position.x + estimate.speed * elapsed * std::sin(heading),
+                                                   estimate.position.y + estimate.speed * elapsed * std::cos(heading));
         
-        // Calculate steering goal (essentially P-control; weight * error)
-        short drift = error * 30;
-        if(drift > 500) drift = 500;
-        if(drift < -500) drift = -500;
+        // Calculate the steering (pure pursuit of a point ahead on the path), once there is one
+        boost::mutex::scoped_lock lock(m_mutex);
+        if(!pursuit)
+            return;
+        kybernetes::navigation::PurePursuit::command command = pursuit->steer(position, state.yaw, estimate.speed);
+        m_command = command;
+        m_steering = true;
+        lock.unlock();
         
         // Log the decision
-        std::cout << "Current Heading = " << state.yaw << ", Target Error = " << error << ", wheel position = " << drift << std::endl;
+        std::cout << "Current Heading = " << state.yaw << ", Cross Track = " << command.progress.crossTrack << ", Steering = " << command.steering << ", wheel position = " << command.drift << std::endl;
         
         // Set the drift angle in the steering servos
-        motion_controller->setDrift(-drift);
+        motion_controller->setDrift(command.drift);
+        watchdog->feed(m_steeringLoop);
+    }
+    
+    // The planner found a new path to the next waypoint, start following it
+    void path_event_update(const kybernetes::math::Route& path, size_t waypoint)
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        delete pursuit;
+        m_path = path;
+        pursuit = new kybernetes::navigation::PurePursuit(m_path);
+        m_waypoint = waypoint;
+        m_blocked = false;
+        lock.unlock();
+        
+        std::cout << "New path to waypoint " << waypoint << ", " << path.length() << " m" << std::endl;
+    }
+    
+    // There is no way around what the sonars have seen, wait for it to move
+    void path_event_blocked(size_t waypoint)
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_blocked = true;
+        lock.unlock();
+        
+        std::cerr << "No path to waypoint " << waypoint << ", stopping" << std::endl;
+        motion_controller->setThrottle(0);
+    }
+    
+    // The last waypoint was reached
+    void path_event_finished()
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_finished = true;
+        lock.unlock();
+        
+        std::cout << "Route complete" << std::endl;
+        motion_controller->setThrottle(0);
     }
     
     // GPS Updated callback
     void gps_event_update(kybernetes::sensor::GarminGPS::state state)
     {
-        // If the GPS packet is valid and we have more to our path
-        if(state.valid && m_path.begin() != m_path.end())
+        // Without a fix we have no business moving
+        m_fix = state.valid;
+        if(!m_fix)
+            motion_controller->setThrottle(0);
+    }
+    
+    // The position estimate was re-anchored by a fix
+    void odometry_event_anchored(kybernetes::navigation::DeadReckoning::state state)
+    {
+        navigate(state.position);
+    }
+    
+    // The position estimate moved (every telemetry frame)
+    void odometry_event_update(kybernetes::navigation::DeadReckoning::state state)
+    {
+        navigate(state.position);
+    }
+    
+    // Check the geofence and pick the throttle from the last steering decision
+    void navigate(kybernetes::math::LocalCoordinate position)
+    {
+        // If we have left the course, stop the vehicle
+        if(m_geofence.isValid() && !m_geofence.contains(position))
         {
-            // Get the distance and heading to target
-            double heading = state.location.headingTo(*(m_path.begin()));
-            double distance = state.location.distanceTo(*(m_path.begin()));
-            
-            // Calculate the goal angle
-            if(heading < 0.0f) heading = 360.0f + heading;
-            m_goal = heading;
-            
-            // If we are far away, go fast
-            if(distance > 20.0)
+            if(!m_fenced)
+                std::cerr << "Left the geofence, stopping" << std::endl;
+            m_fenced = true;
+        }
+        
+        // Fetch the last steering decision and the state of the plan
+        boost::mutex::scoped_lock lock(m_mutex);
+        bool steering = m_steering && !m_blocked && !m_finished;
+        kybernetes::navigation::PurePursuit::command command = m_command;
+        double remaining = command.remaining + m_route.length() - m_route.distanceAt(std::min(m_waypoint, m_route.size() - 1));
+        lock.unlock();
+        
+        // If the GPS has a fix and we have a way forward
+        if(m_fix && !m_fenced && steering)
+        {
+            // If we are far from the end, go fast
+            if(remaining > 20.0)
                 motion_controller->setThrottle(80);
             
             // If we are approaching, go slower
-            else if(distance > 4.0)
-                motion_controller->setThrottle(50);
-            
-            // If we are on target, remove this path element and continue to the next
             else
-                m_path.pop_front();
+                motion_controller->setThrottle(50);
         }
         
-        // If the GPS 
+        // If we are lost, fenced, blocked or done
         else
             motion_controller->setThrottle(0);
+        watchdog->feed(m_throttleLoop);
     }
     
     // The main method of the demo
@@ -163,7 +326,7 @@ int main (int argc, char** argv)
     {
         // Return docs
         std::cerr << "Fatal: Too few arguments" << std::endl;
-        std::cerr << "Usage: " << argv[0] << " <coordinate list>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <coordinate list> [geofence list] [obstacle map directory]" << std::endl;
         std::cout << std::endl;
         
         // Return fail
@@ -178,27 +341,39 @@ int main (int argc, char** argv)
     sigaction(SIGINT, &sigIntHandler, NULL);
     signal(SIGPIPE, SIG_IGN);
     
-    // Load the coordinates from the manifest file
-    std::list<kybernetes::math::GeoCoordinate> path;
-    std::ifstream                              manifest(argv[1]);
-    while(!manifest.eof())
+    // Load the route from the manifest file
+    kybernetes::math::Route route;
+    if(!route.load(argv[1]))
     {
-        // Load the coordinate from the file
-        kybernetes::math::GeoCoordinate coord;
-        manifest >> coord.latitude;
-        manifest >> coord.longitude;
-        
-        // Check if the coordinate is valid
-        if(manifest.eof()) break;
-        
-        // Otherwise store the coordinate
+        std::cerr << "Fatal: Could not load coordinate list \"" << argv[1] << "\"" << std::endl;
+        return 1;
+    }
+    
+    // A route needs somewhere to go (a single waypoint is driven to from wherever we start)
+    if(route.size() == 0)
+    {
+        std::cerr << "Fatal: Coordinate list \"" << argv[1] << "\" has no waypoints" << std::endl;
+        return 1;
+    }
+    
+    // Print the route
+    for(size_t i = 0; i < route.size(); i++)
+    {
+        kybernetes::math::GeoCoordinate coord = route.frame().toGeo(route.waypoint(i));
         std::cout << std::setprecision(10) << "Coordinate = " << coord.latitude << "," << coord.longitude << std::endl;
-        path.push_back(coord);
     }
-    manifest.close();
+    std::cout << "Route length = " << route.length() << " m" << std::endl;
+    
+    // Load the geofence if one was provided
+    kybernetes::math::Geofence geofence;
+    if(argc > 2 && !geofence.load(argv[2], route.frame()))
+    {
+        std::cerr << "Fatal: Could not load geofence \"" << argv[2] << "\"" << std::endl;
+        return 1;
+    }
     
     // Create the demo
-    gps_navigate_demo demo(path);
+    gps_navigate_demo demo(route, geofence, (argc > 3) ? argv[3] : "");
 
     // Run the demo
     demo.run();
@@ -19,6 +19,7 @@
 
 // Kybernetes dependencies
 #include <kybernetes/sensor/uvccamera.hpp>
+#include <kybernetes/sensor/ptz_worker.hpp>
 #include <kybernetes/network/serversocket.hpp>
 #include <kybernetes/cv/cv.hpp>
 
@@ -42,6 +43,7 @@
 
 // Kybernetes objects
 kybernetes::sensor::UVCCamera     *camera;
+kybernetes::sensor::PTZWorker     *ptz;
 std::string                        camera_device;
 int                                width;            
 int                                height;           
@@ -95,7 +97,10 @@ void image_process_thread(void)
     // Wait for it to initialize
     camera->capture_buffer(&buffer, &data, &size);
     camera->release_buffer(&buffer);
-    camera->ptz_reset();
+    
+    // Move the camera from its own thread, the capture loop mustn't wait on control transfers
+    ptz = new kybernetes::sensor::PTZWorker(*camera);
+    ptz->reset();
     
     // Create the structuring element for erosion
     int erosion_size = 2;
@@ -150,7 +155,7 @@ void image_process_thread(void)
         
         // Instruct pan/tilt to move
         if(mX != 0 && mY != 0 && should_track)
-            camera->ptz_move(((width / 2) - mX) * pt_response, (mY - (height / 2)) * pt_response, 0);
+            ptz->moveRelative(((width / 2) - mX) * pt_response, (mY - (height / 2)) * pt_response);
                 
         // Store the resultant (free old one)
         boost::mutex::scoped_lock lock3(image_resultant_mutex);
@@ -160,6 +165,7 @@ void image_process_thread(void)
     }
 
     // Close the camera
+    delete ptz;
     delete camera;
     std::cout << " << Camera closed" << std::endl;
 }
@@ -283,7 +289,7 @@ int main(int argc, char **argv)
             }
             else if(command[0] == 'e')
             {
-                camera->ptz_reset();
+                ptz->reset();
             }
         }
         
@@ -19,6 +19,8 @@
 
 #include <kybernetes/controller/motion_controller.hpp>
 
+#include <cstring>
+
 using namespace kybernetes::io;
 using namespace kybernetes::controller;
 
@@ -28,6 +30,7 @@ MotionController::MotionController(std::string port, unsigned int baudrate) :
 {
     // Do some initialization
     m_ready = false;
+    m_halted = 0;
     
     // Start the processing thread
     this->start();
@@ -198,47 +201,68 @@ MotionController::state MotionController::fetchState()
     return m_state;
 }
 
-// Setting data
-void MotionController::setTarget(int distance, unsigned short maxThrottle)
+// Send a command in one write.  The imu and telemetry threads both steer and drive, and the
+// firmware can't tell the bytes of two interleaved commands apart.
+void MotionController::command(char type, const void *data, size_t length)
 {
     // Only set stuff if we are ready
     if(!m_ready) return;
-
-    // Write the command characters
-    std::string command = "#p";
-    m_device->write((char *) command.data(), 2);
     
-    // Write the position target
-    m_device->write((char *) &distance, 4);
+    // Assemble the command characters and the argument bytes
+    char buffer[8] = {'#', type};
+    memcpy(buffer + 2, data, length);
     
-    // Write the throttle bytes
-    m_device->write((char *) &maxThrottle, 2);
+    // Write them out, unless they would move a halted truck
+    boost::mutex::scoped_lock lock(m_writeMutex);
+    if(m_halted && (type == 't' || type == 'p')) return;
+    m_device->write(buffer, length + 2);
 }
 
-void MotionController::setThrottle(unsigned short throttle)
+// Setting data
+void MotionController::setTarget(int distance, unsigned short maxThrottle)
 {
-    // Only set stuff if we are ready
-    if(!m_ready) return;
+    // Write the position target and the throttle bytes
+    char arguments[6];
+    memcpy(arguments, &distance, 4);
+    memcpy(arguments + 4, &maxThrottle, 2);
+    command('p', arguments, 6);
+}
 
-    // Write the command characters
-    std::string command = "#t";
-    m_device->write((char *) command.data(), 2);
-    
+void MotionController::setThrottle(unsigned short throttle)
+{
     // Write the throttle bytes
-    m_device->write((char *) &throttle, 2);
+    command('t', &throttle, 2);
 }
 
 void MotionController::setDrift(unsigned short drift)
+{
+    // Write the drift bytes
+    command('s', &drift, 2);
+}
+
+// Stop now, and keep throttle and position commands from moving the truck until released
+void MotionController::halt(unsigned char reason)
 {
     // Only set stuff if we are ready
     if(!m_ready) return;
-
-    // Write the command characters
-    std::string command = "#s";
-    m_device->write((char *) command.data(), 2);
     
-    // Write the throttle bytes
-    m_device->write((char *) &drift, 2);
+    // Write the stop in the same lock that blocks the commands after it
+    char buffer[4] = {'#', 't', 0, 0};
+    boost::mutex::scoped_lock lock(m_writeMutex);
+    m_halted |= reason;
+    m_device->write(buffer, 4);
+}
+
+void MotionController::release(unsigned char reason)
+{
+    boost::mutex::scoped_lock lock(m_writeMutex);
+    m_halted &= ~reason;
+}
+
+bool MotionController::isHalted()
+{
+    boost::mutex::scoped_lock lock(m_writeMutex);
+    return m_halted != 0;
 }
 
 // Store a callback object in our callbacks list
@@ -18,6 +18,7 @@
  */
 
 #include <kybernetes/controller/sensor_controller.hpp>
+#include <kybernetes/utility/clock.hpp>
 
 using namespace kybernetes::io;
 using namespace kybernetes::controller;
@@ -28,6 +29,14 @@ SensorController::SensorController(std::string port, unsigned int baudrate) :
 {
     // Do some initialization
     m_ready = false;
+    m_fresh = false;
+    m_reflex = NULL;
+    m_reflexBumpers = 0;
+    m_reflexSonar = 0;
+    m_reflexTripped = false;
+    m_reflexCount = 0;
+    m_reflexClear = 0;
+    m_reflexLast = 0.0;
     
     // Start the processing thread
     this->start();
@@ -42,17 +51,21 @@ SensorController::~SensorController()
 // Thread control
 void SensorController::start()
 {
-    // Start the processing thread
+    // Start the processing and callback threads
     m_thread = boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&SensorController::do_parsing, this)));
+    m_dispatcher = boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&SensorController::do_dispatch, this)));
 }
 
 void SensorController::stop()
 {
-    // Interrupt the thread
+    // Interrupt the threads
     m_thread->interrupt();
+    m_dispatcher->interrupt();
     
-    // Join the thread
+    // Join the threads (the parsing thread may already have joined the dispatcher)
     m_thread->join();
+    if(m_dispatcher->joinable())
+        m_dispatcher->join();
 }
 
 // Thread which parses the data from the sensor controller
@@ -140,14 +153,16 @@ void SensorController::do_parsing()
                 m_thread->interrupt();
             }
             
-            // Swap with shared copy
+            // Swap with shared copy, and stop if something is in the way before anyone hears of it
             boost::mutex::scoped_lock lock(m_mutex);
             m_state = state;
-            lock.unlock();
+            reflex(state);
             
-            // Execute queued callbacks for the "sensor controller updates" event
-            for(std::list<SensorController::callback *>::iterator it = m_callbacks.begin(); it != m_callbacks.end(); ++it)
-                (*it)->sensors_event_update(state);
+            // Hand the reading to the callbacks, replacing one they haven't got to yet
+            m_pending = state;
+            m_fresh = true;
+            lock.unlock();
+            m_available.notify_one();
         }
         
     } catch (boost::thread_interrupted)
@@ -158,6 +173,12 @@ void SensorController::do_parsing()
     // Alert
     std::cerr << "[SensorController:" << m_port << "] Stopped updating sensor data" << std::endl;
     
+    // Let the callbacks finish with the last reading before telling them we've stopped (a stop
+    // request arriving now mustn't cut the wait short)
+    boost::this_thread::disable_interruption noInterruption;
+    m_dispatcher->interrupt();
+    m_dispatcher->join();
+    
     // Execute queued callbacks for the "sensor controller goes down" event
     m_ready = false;
     for(std::list<SensorController::callback *>::iterator it = m_callbacks.begin(); it != m_callbacks.end(); ++it)
@@ -167,6 +188,86 @@ void SensorController::do_parsing()
     delete m_device;
 }
 
+// Thread which hands the readings to the callbacks
+void SensorController::do_dispatch()
+{
+    try
+    {
+        while(1)
+        {
+            // Wait for a reading
+            boost::mutex::scoped_lock lock(m_mutex);
+            while(!m_fresh)
+                m_available.wait(lock);
+            SensorController::state state = m_pending;
+            m_fresh = false;
+            lock.unlock();
+            
+            // Execute queued callbacks for the "sensor controller updates" event
+            for(std::list<SensorController::callback *>::iterator it = m_callbacks.begin(); it != m_callbacks.end(); ++it)
+                (*it)->sensors_event_update(state);
+        }
+    } catch (boost::thread_interrupted)
+    {
+        
+    }
+}
+
+// Halt or release the motion controller on a new reading (called with the state locked)
+void SensorController::reflex(const SensorController::state& s)
+{
+    if(!m_reflex)
+        return;
+    
+    // Check the bumpers and the sonars (a zero is no reading)
+    bool tripped = (s.bumpers & m_reflexBumpers) != 0;
+    for(int i = 0; i < 5 && !tripped; i++)
+        tripped = s.sonars[i] && s.sonars[i] < m_reflexSonar;
+    
+    // Halt on the reading that trips it
+    double now = kybernetes::utility::monotonicTime();
+    if(tripped)
+    {
+        if(!m_reflexTripped)
+        {
+            m_reflex->halt(HALT_REFLEX);
+            m_reflexCount++;
+        }
+        m_reflexTripped = true;
+        m_reflexClear = 0;
+        m_reflexLast = now;
+    }
+    
+    // Release once it has stayed clear for long enough
+    else if(m_reflexTripped && ++m_reflexClear >= REFLEX_CLEAR_READINGS && now - m_reflexLast >= REFLEX_HOLD)
+    {
+        m_reflex->release(HALT_REFLEX);
+        m_reflexTripped = false;
+    }
+}
+
+// Set up the reflex stop
+void SensorController::setReflex(MotionController *controller, unsigned char bumperMask, unsigned short sonarThreshold)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    
+    // Don't leave the old controller halted
+    if(m_reflex && m_reflexTripped)
+        m_reflex->release(HALT_REFLEX);
+    m_reflex = controller;
+    m_reflexBumpers = bumperMask;
+    m_reflexSonar = sonarThreshold;
+    m_reflexTripped = false;
+    m_reflexClear = 0;
+}
+
+// Number of times the reflex has stopped the truck
+unsigned int SensorController::reflexes()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_reflexCount;
+}
+
 SensorController::state SensorController::fetchState()
 {
     boost::mutex::scoped_lock lock(m_mutex);
@@ -0,0 +1,187 @@
+/*
+ *  speed_controller.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/controller/speed_controller.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace kybernetes::controller;
+
+// Longest frame interval integrated (s), a stall in telemetry mustn't wind the loop up
+static const double MAXIMUM_INTERVAL = 0.2;
+
+// Default tuning for the truck.  The feedforward alone lands within about 20% of the speed, the
+// loop takes out the rest in well under a second.
+SpeedController::parameters SpeedController::defaultParameters()
+{
+    SpeedController::parameters p;
+    p.offset      = 10.0;
+    p.gain        = 25.0;
+    p.kp          = 12.0;
+    p.ki          = 40.0;
+    p.lead        = 0.15;
+    p.maxThrottle = 100;
+    p.smoothing   = 0.5;
+    p.interval    = 0.04;
+    p.refresh     = 0.2;
+    return p;
+}
+
+// Constructor for the object
+SpeedController::SpeedController(MotionController& controller, double metersPerUnit)
+    : m_controller(controller), m_parameters(defaultParameters()), m_metersPerUnit(metersPerUnit), m_target(0.0), m_speed(0.0), m_acceleration(0.0),
+      m_odometer(0.0f), m_frameTime(0.0), m_haveOdometer(false), m_integral(0.0), m_throttle(0), m_writeTime(0.0), m_writes(0)
+{
+
+}
+
+// Constructor for the object
+SpeedController::SpeedController(MotionController& controller, const parameters& p, double metersPerUnit)
+    : m_controller(controller), m_parameters(p), m_metersPerUnit(metersPerUnit), m_target(0.0), m_speed(0.0), m_acceleration(0.0),
+      m_odometer(0.0f), m_frameTime(0.0), m_haveOdometer(false), m_integral(0.0), m_throttle(0), m_writeTime(0.0), m_writes(0)
+{
+
+}
+
+// Throttle for the current target and speed
+unsigned short SpeedController::calculate(double elapsed, double& integral) const
+{
+    // Stopping is always immediate
+    integral = 0.0;
+    if(m_target <= 0.0)
+        return 0;
+
+    // Feedforward plus PI
+    double error    = m_target - m_speed;
+    double throttle = m_parameters.offset + m_parameters.gain * m_target;
+    double ahead    = m_target - (m_speed + m_acceleration * m_parameters.lead);
+    integral  = m_integral + m_parameters.ki * ahead * elapsed;
+    throttle += m_parameters.kp * error + integral;
+
+    // Don't wind up against the limits
+    if(throttle > m_parameters.maxThrottle)
+    {
+        if(error > 0.0)
+            integral = m_integral;
+        throttle = m_parameters.maxThrottle;
+    }
+    else if(throttle < 0.0)
+    {
+        if(error < 0.0)
+            integral = m_integral;
+        throttle = 0.0;
+    }
+    return (unsigned short) (throttle + 0.5);
+}
+
+// Write a throttle if it changed (or hasn't been sent for a while) and the last write wasn't too recent
+void SpeedController::command(unsigned short throttle, bool force)
+{
+    double now = kybernetes::utility::monotonicTime();
+    if(!force && ((throttle == m_throttle && now - m_writeTime < m_parameters.refresh) || now - m_writeTime < m_parameters.interval))
+        return;
+    m_controller.setThrottle(throttle);
+    m_throttle  = throttle;
+    m_writeTime = now;
+    m_writes++;
+}
+
+// Set the speed to hold, the feedforward goes out now rather than on the next frame
+void SpeedController::setSpeed(double speed)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_target = std::max(speed, 0.0);
+    double         integral;
+    unsigned short throttle = calculate(0.0, integral);
+    m_integral = integral;
+    command(throttle, m_target == 0.0);
+}
+
+void SpeedController::stop()
+{
+    setSpeed(0.0);
+}
+
+// Speed wanted and measured
+double SpeedController::target()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_target;
+}
+
+double SpeedController::speed()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_speed;
+}
+
+// Last throttle written and the number of writes
+unsigned short SpeedController::throttle()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_throttle;
+}
+
+unsigned int SpeedController::writes()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_writes;
+}
+
+// A telemetry frame arrived, measure the speed and run the loop
+void SpeedController::motors_event_update(MotionController::state s)
+{
+    // Odometer delta since the last frame
+    boost::mutex::scoped_lock lock(m_mutex);
+    double now      = kybernetes::utility::monotonicTime();
+    double step     = (s.odometer - m_odometer) * m_metersPerUnit;
+    double interval = now - m_frameTime;
+    bool   first    = !m_haveOdometer;
+    m_odometer     = s.odometer;
+    m_frameTime    = now;
+    m_haveOdometer = true;
+    if(first || interval <= 0.0)
+        return;
+
+    // Smooth the speed, skipping odometer resets and anything else the truck couldn't have driven
+    if(s.odometer != 0.0f && std::fabs(step) <= ODOMETER_MAXIMUM_STEP)
+    {
+        double last = m_speed;
+        m_speed        += m_parameters.smoothing * (step / interval - m_speed);
+        m_acceleration  = (m_speed - last) / interval;
+    }
+
+    // With the radio's enable released the firmware holds the truck (and while halted by a reflex
+    // so do we), don't wind up meanwhile
+    if(!s.enabled || m_controller.isHalted())
+    {
+        m_integral = 0.0;
+        if(m_controller.isHalted())
+            m_throttle = 0;
+        return;
+    }
+
+    // Run the loop
+    double         integral;
+    unsigned short throttle = calculate(std::min(interval, MAXIMUM_INTERVAL), integral);
+    m_integral = integral;
+    command(throttle, false);
+}
@@ -0,0 +1,167 @@
+/*
+ *  visual_servo.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/controller/visual_servo.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace kybernetes::controller;
+
+// Wrap an angle to (-180, 180] degrees
+static double wrap(double angle)
+{
+    angle = std::fmod(angle, 360.0);
+    if(angle > 180.0)
+        angle -= 360.0;
+    else if(angle <= -180.0)
+        angle += 360.0;
+    return angle;
+}
+
+// Default tuning for the truck.  The field of view is the Orbit's, the steering matches the pure
+// pursuit follower's.  Half a second of yaw covers the frame latency many times over.
+VisualServo::parameters VisualServo::defaultParameters()
+{
+    VisualServo::parameters p;
+    p.fieldOfView     = 60.0;
+    p.gain            = 1.0;
+    p.maximumSteering = 25.0;
+    p.driftPerDegree  = 20.0;
+    p.history         = 0.5;
+    p.timeout         = 0.5;
+    return p;
+}
+
+// Constructor for the object
+VisualServo::VisualServo(MotionController& controller, unsigned int width)
+    : m_controller(controller), m_parameters(defaultParameters()), m_bearing(0.0), m_seen(0.0)
+{
+    // Pixels from the center per unit of tangent of the bearing
+    m_center      = width / 2.0;
+    m_focalLength = m_center / std::tan(m_parameters.fieldOfView * (M_PI / 360.0));
+}
+
+// Constructor for the object
+VisualServo::VisualServo(MotionController& controller, unsigned int width, const parameters& p)
+    : m_controller(controller), m_parameters(p), m_bearing(0.0), m_seen(0.0)
+{
+    // Pixels from the center per unit of tangent of the bearing
+    m_center      = width / 2.0;
+    m_focalLength = m_center / std::tan(m_parameters.fieldOfView * (M_PI / 360.0));
+}
+
+// Heading at a time (call with the lock held and a heading stored)
+double VisualServo::headingAt(double timestamp) const
+{
+    // Outside of the history the closest heading is all there is
+    if(timestamp <= m_headings.front().timestamp)
+        return m_headings.front().yaw;
+    if(timestamp >= m_headings.back().timestamp)
+        return m_headings.back().yaw;
+
+    // Find the updates either side and interpolate (the short way around)
+    std::deque<sample>::const_iterator it = m_headings.begin();
+    while((it + 1)->timestamp < timestamp)
+        ++it;
+    double fraction = (timestamp - it->timestamp) / ((it + 1)->timestamp - it->timestamp);
+    return it->yaw + fraction * wrap((it + 1)->yaw - it->yaw);
+}
+
+// Steer for the held bearing (call with the lock held)
+VisualServo::command VisualServo::steer(double timestamp)
+{
+    VisualServo::command c;
+    c.bearing  = m_bearing;
+    c.latency  = kybernetes::utility::monotonicTime() - timestamp;
+    c.locked   = m_seen > 0.0 && timestamp - m_seen < m_parameters.timeout;
+
+    // Straighten out once the target is lost
+    if(!c.locked)
+    {
+        c.error    = 0.0;
+        c.steering = 0.0;
+        c.drift    = 0;
+        m_controller.setDrift(0);
+        return c;
+    }
+
+    // Turn toward the bearing from the current heading
+    c.error    = wrap(m_bearing - m_headings.back().yaw);
+    c.steering = std::max(-m_parameters.maximumSteering, std::min(m_parameters.maximumSteering, m_parameters.gain * c.error));
+    c.drift    = (short) -(c.steering * m_parameters.driftPerDegree);
+    m_controller.setDrift(c.drift);
+    return c;
+}
+
+// The target was seen in a frame
+VisualServo::command VisualServo::observe(double column, double pan, double timestamp)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    // Nothing to steer against without a heading
+    if(m_headings.empty())
+    {
+        VisualServo::command c = { 0.0, 0.0, 0.0, 0, 0.0, false };
+        return c;
+    }
+
+    // The target's bearing off the camera's axis, plus the turret, plus the heading when the
+    // frame was exposed
+    double offset = std::atan((column - m_center) / m_focalLength) * (180.0 / M_PI);
+    m_bearing = std::fmod(headingAt(timestamp) + pan + offset + 360.0, 360.0);
+    m_seen    = timestamp;
+    return steer(timestamp);
+}
+
+// A frame without the target
+VisualServo::command VisualServo::hold(double timestamp)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    // Nothing to steer against without a heading
+    if(m_headings.empty())
+    {
+        VisualServo::command c = { 0.0, 0.0, 0.0, 0, 0.0, false };
+        return c;
+    }
+    return steer(timestamp);
+}
+
+// Whether the gyro has given a heading yet
+bool VisualServo::isReady()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return !m_headings.empty();
+}
+
+// The IMU updated, remember the heading
+void VisualServo::imu_event_update(kybernetes::sensor::IMU::state s)
+{
+    double now = kybernetes::utility::monotonicTime();
+    boost::mutex::scoped_lock lock(m_mutex);
+    sample h = { now, s.yaw };
+    m_headings.push_back(h);
+
+    // Forget headings older than any frame will be
+    while(m_headings.size() > 2 && now - m_headings.front().timestamp > m_parameters.history)
+        m_headings.pop_front();
+}
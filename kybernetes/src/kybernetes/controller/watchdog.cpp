@@ -0,0 +1,126 @@
+/*
+ *  watchdog.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/controller/watchdog.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+#include <iostream>
+#include <algorithm>
+
+using namespace kybernetes::controller;
+
+// Constructor for the object
+Watchdog::Watchdog(MotionController& controller, double period)
+    : m_controller(controller), m_period(period)
+{
+    // Start the watching thread
+    m_thread = boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&Watchdog::do_watching, this)));
+}
+
+Watchdog::~Watchdog()
+{
+    // Stop the watching thread
+    m_thread->interrupt();
+    m_thread->join();
+}
+
+// Watch a loop
+int Watchdog::watch(const std::string& name, double deadline)
+{
+    Watchdog::loop l;
+    l.name     = name;
+    l.deadline = deadline;
+    l.last     = 0.0;
+    l.expired  = false;
+    l.overruns = 0;
+    l.worst    = 0.0;
+
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_loops.push_back(l);
+    return m_loops.size() - 1;
+}
+
+// The loop sent its command, if it had stalled the truck can move again (unless another has too)
+void Watchdog::feed(int id)
+{
+    double now = kybernetes::utility::monotonicTime();
+    boost::mutex::scoped_lock lock(m_mutex);
+    Watchdog::loop& l = m_loops[id];
+    if(l.expired)
+    {
+        l.worst   = std::max(l.worst, now - l.last);
+        l.expired = false;
+        bool halted = false;
+        for(std::vector<Watchdog::loop>::iterator it = m_loops.begin(); it != m_loops.end(); ++it)
+            halted = halted || it->expired;
+        if(!halted)
+            m_controller.release(HALT_WATCHDOG);
+    }
+    l.last = now;
+}
+
+// State of the loops
+Watchdog::loop Watchdog::status(int id)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_loops[id];
+}
+
+std::vector<Watchdog::loop> Watchdog::loops()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_loops;
+}
+
+// Thread which checks the loops against their deadlines
+void Watchdog::do_watching()
+{
+    try
+    {
+        while(1)
+        {
+            // Find the loops that just went past their deadlines
+            std::vector<Watchdog::loop> overdue;
+            double now = kybernetes::utility::monotonicTime();
+            boost::mutex::scoped_lock lock(m_mutex);
+            for(std::vector<Watchdog::loop>::iterator it = m_loops.begin(); it != m_loops.end(); ++it)
+            {
+                if(it->last > 0.0 && !it->expired && now - it->last > it->deadline)
+                {
+                    it->expired = true;
+                    it->overruns++;
+                    overdue.push_back(*it);
+                }
+            }
+
+            // Stop the truck, then complain
+            if(overdue.size())
+                m_controller.halt(HALT_WATCHDOG);
+            lock.unlock();
+            for(std::vector<Watchdog::loop>::iterator it = overdue.begin(); it != overdue.end(); ++it)
+                std::cerr << "[Watchdog] " << it->name << " missed its " << it->deadline * 1000.0 << " ms deadline, stopping" << std::endl;
+
+            // Wait for the next check
+            boost::this_thread::sleep(boost::posix_time::microseconds((long) (m_period * 1e6)));
+        }
+    } catch (boost::thread_interrupted)
+    {
+
+    }
+}
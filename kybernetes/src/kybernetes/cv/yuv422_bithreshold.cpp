@@ -0,0 +1,174 @@
+/*
+ *  yuv422_bithreshold.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/cv/cv.hpp>
+
+// Processor feature detection
+#if defined(__arm__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+namespace kybernetes
+{
+    namespace cv
+    {
+        // The kernels threshold the first width pixels of each row, a multiple of their block
+        // (built with the instruction set's flags in their own files)
+        typedef void (*bithreshold_function)(const uint8_t *source, size_t sourceStride, uint8_t *destination, size_t destinationStride,
+                                             unsigned int width, unsigned int height, const uint8_t *lower, const uint8_t *upper);
+#if defined(__i386__) || defined(__x86_64__)
+        void yuv422_bithreshold_sse2(const uint8_t *source, size_t sourceStride, uint8_t *destination, size_t destinationStride,
+                                     unsigned int width, unsigned int height, const uint8_t *lower, const uint8_t *upper);
+        void yuv422_bithreshold_avx2(const uint8_t *source, size_t sourceStride, uint8_t *destination, size_t destinationStride,
+                                     unsigned int width, unsigned int height, const uint8_t *lower, const uint8_t *upper);
+#endif
+#if defined(__arm__) || defined(__aarch64__)
+        void yuv422_bithreshold_neon(const uint8_t *source, size_t sourceStride, uint8_t *destination, size_t destinationStride,
+                                     unsigned int width, unsigned int height, const uint8_t *lower, const uint8_t *upper);
+#endif
+    }
+}
+
+using namespace kybernetes::cv;
+
+// The scalar version, which the others are checked against.  Also finishes the rows the kernels
+// leave (from pixel start on).
+static void yuv422_bithreshold_scalar(const uint8_t *source, size_t sourceStride, uint8_t *destination, size_t destinationStride,
+                                      unsigned int start, unsigned int width, unsigned int height, const uint8_t *lower, const uint8_t *upper)
+{
+    for(unsigned int y = 0; y < height; y++)
+    {
+        const uint8_t *row = source + y * sourceStride;
+        uint8_t       *out = destination + y * destinationStride;
+        for(unsigned int x = start; x < width; x++)
+        {
+            // Each pair of pixels shares the U and V of its YUYV group
+            const uint8_t *group = row + (x >> 1) * 4;
+            uint8_t l = row[x * 2], u = group[1], v = group[3];
+            int in = (l >= lower[0]) & (l <= upper[0]) & (u >= lower[1]) & (u <= upper[1]) & (v >= lower[2]) & (v <= upper[2]);
+            out[x] = -in;
+        }
+    }
+}
+
+// The kernels, their block (pixels) and whether the processor has their instructions
+typedef struct _bithreshold_entry
+{
+    const char           *name;
+    bithreshold_function  function;
+    unsigned int          block;
+} bithreshold_entry;
+
+static const bithreshold_entry kernels[BITHRESHOLD_KERNELS] =
+{
+    { "scalar", NULL, 1 },
+#if defined(__i386__) || defined(__x86_64__)
+    { "sse2",   yuv422_bithreshold_sse2, 16 },
+    { "avx2",   yuv422_bithreshold_avx2, 32 },
+#else
+    { "sse2",   NULL, 0 },
+    { "avx2",   NULL, 0 },
+#endif
+#if defined(__arm__) || defined(__aarch64__)
+    { "neon",   yuv422_bithreshold_neon, 16 },
+#else
+    { "neon",   NULL, 0 },
+#endif
+};
+
+// The kernel in use (picked on first use)
+static int selected = -1;
+
+bool kybernetes::cv::bithreshold_available(bithreshold_kernel kernel)
+{
+    switch(kernel)
+    {
+        case BITHRESHOLD_SCALAR:
+            return true;
+#if defined(__i386__) || defined(__x86_64__)
+        case BITHRESHOLD_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case BITHRESHOLD_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+#if defined(__aarch64__)
+        case BITHRESHOLD_NEON:
+            return true;
+#elif defined(__arm__)
+        case BITHRESHOLD_NEON:
+            return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#endif
+        default:
+            return false;
+    }
+}
+
+bool kybernetes::cv::bithreshold_select(bithreshold_kernel kernel)
+{
+    if(kernel < BITHRESHOLD_SCALAR || kernel >= BITHRESHOLD_KERNELS || !bithreshold_available(kernel))
+        return false;
+    selected = kernel;
+    return true;
+}
+
+bithreshold_kernel kybernetes::cv::bithreshold_selected()
+{
+    // Pick the widest kernel the processor has
+    if(selected < 0)
+    {
+        selected = BITHRESHOLD_SCALAR;
+        for(int k = BITHRESHOLD_SCALAR; k < BITHRESHOLD_KERNELS; k++)
+            if(bithreshold_available((bithreshold_kernel) k) && kernels[k].block >= kernels[selected].block)
+                selected = k;
+    }
+    return (bithreshold_kernel) selected;
+}
+
+const char *kybernetes::cv::bithreshold_name(bithreshold_kernel kernel)
+{
+    if(kernel < BITHRESHOLD_SCALAR || kernel >= BITHRESHOLD_KERNELS)
+        return "unknown";
+    return kernels[kernel].name;
+}
+
+void kybernetes::cv::yuv422_bithreshold(const void *source, size_t sourceStride, void *destination, size_t destinationStride, unsigned int width, unsigned int height,
+                                        uint8_t ly, uint8_t lu, uint8_t lv, uint8_t uy, uint8_t uu, uint8_t uv)
+{
+    const uint8_t lower[3] = { ly, lu, lv };
+    const uint8_t upper[3] = { uy, uu, uv };
+
+    // The kernel takes as many whole blocks of each row as there are, the rest is done here
+    const bithreshold_entry& kernel = kernels[bithreshold_selected()];
+    unsigned int             done   = 0;
+    if(kernel.function && width >= kernel.block)
+    {
+        done = width - width % kernel.block;
+        kernel.function((const uint8_t *) source, sourceStride, (uint8_t *) destination, destinationStride, done, height, lower, upper);
+    }
+    if(done < width)
+        yuv422_bithreshold_scalar((const uint8_t *) source, sourceStride, (uint8_t *) destination, destinationStride, done, width, height, lower, upper);
+}
+
+void kybernetes::cv::yuv422_bithreshold(void *source, void *destination, uint16_t width, uint16_t height, uint8_t ly, uint8_t lu, uint8_t lv, uint8_t uy, uint8_t uu, uint8_t uv)
+{
+    // Tightly packed rows
+    yuv422_bithreshold(source, ((width + 1) / 2) * 4, destination, width, width, height, ly, lu, lv, uy, uu, uv);
+}
@@ -0,0 +1,66 @@
+/*
+ *  yuv422_bithreshold_avx2.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/cv/cv.hpp>
+
+// Only built for x86 (with -mavx2)
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace kybernetes
+{
+    namespace cv
+    {
+        // The SSE2 kernel at twice the width, 32 pixels (64 bytes of YUYV) at a time.  Packing works
+        // within each 128 bit half, so the halves are put back in order before storing.
+        void yuv422_bithreshold_avx2(const uint8_t *source, size_t sourceStride, uint8_t *destination, size_t destinationStride,
+                                     unsigned int width, unsigned int height, const uint8_t *lower, const uint8_t *upper)
+        {
+            const __m256i low  = _mm256_set1_epi32(lower[0] | (lower[1] << 8) | (lower[0] << 16) | (lower[2] << 24));
+            const __m256i high = _mm256_set1_epi32(upper[0] | (upper[1] << 8) | (upper[0] << 16) | (upper[2] << 24));
+
+            for(unsigned int y = 0; y < height; y++)
+            {
+                const uint8_t *row = source + y * sourceStride;
+                uint8_t       *out = destination + y * destinationStride;
+                for(unsigned int x = 0; x < width; x += 32, row += 64, out += 32)
+                {
+                    __m256i a = _mm256_loadu_si256((const __m256i *) row);
+                    __m256i b = _mm256_loadu_si256((const __m256i *) (row + 32));
+
+                    // Each byte within its bounds
+                    __m256i ma = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(a, low), a), _mm256_cmpeq_epi8(_mm256_min_epu8(a, high), a));
+                    __m256i mb = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(b, low), b), _mm256_cmpeq_epi8(_mm256_min_epu8(b, high), b));
+
+                    // U and V's masks and'ed into the low byte of the pair's words
+                    __m256i ca = _mm256_srli_epi16(ma, 8);
+                    __m256i cb = _mm256_srli_epi16(mb, 8);
+                    ca = _mm256_and_si256(ca, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(ca, 0xB1), 0xB1));
+                    cb = _mm256_and_si256(cb, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(cb, 0xB1), 0xB1));
+
+                    // Pack the pixels' masks to bytes and reorder the 64 bit quarters
+                    __m256i packed = _mm256_packus_epi16(_mm256_and_si256(ma, ca), _mm256_and_si256(mb, cb));
+                    _mm256_storeu_si256((__m256i *) out, _mm256_permute4x64_epi64(packed, 0xD8));
+                }
+            }
+        }
+    }
+}
+#endif
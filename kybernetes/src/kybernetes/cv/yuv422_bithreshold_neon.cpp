@@ -0,0 +1,62 @@
+/*
+ *  yuv422_bithreshold_neon.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/cv/cv.hpp>
+
+// Only built for ARM (with NEON)
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+
+namespace kybernetes
+{
+    namespace cv
+    {
+        // Threshold 16 pixels (32 bytes of YUYV) at a time.  As the assembly version did, the load
+        // splits the groups into the first Ys, the Us, the second Ys and the Vs, and the store zips the
+        // two Ys' masks back together.
+        void yuv422_bithreshold_neon(const uint8_t *source, size_t sourceStride, uint8_t *destination, size_t destinationStride,
+                                     unsigned int width, unsigned int height, const uint8_t *lower, const uint8_t *upper)
+        {
+            const uint8x8_t ly = vdup_n_u8(lower[0]), lu = vdup_n_u8(lower[1]), lv = vdup_n_u8(lower[2]);
+            const uint8x8_t uy = vdup_n_u8(upper[0]), uu = vdup_n_u8(upper[1]), uv = vdup_n_u8(upper[2]);
+
+            for(unsigned int y = 0; y < height; y++)
+            {
+                const uint8_t *row = source + y * sourceStride;
+                uint8_t       *out = destination + y * destinationStride;
+                for(unsigned int x = 0; x < width; x += 16, row += 32, out += 16)
+                {
+                    uint8x8x4_t pixels = vld4_u8(row);
+
+                    // The pair's U and V within their bounds
+                    uint8x8_t chroma = vand_u8(vand_u8(vcge_u8(pixels.val[1], lu), vcle_u8(pixels.val[1], uu)),
+                                               vand_u8(vcge_u8(pixels.val[3], lv), vcle_u8(pixels.val[3], uv)));
+
+                    // And each Y
+                    uint8x8x2_t mask;
+                    mask.val[0] = vand_u8(chroma, vand_u8(vcge_u8(pixels.val[0], ly), vcle_u8(pixels.val[0], uy)));
+                    mask.val[1] = vand_u8(chroma, vand_u8(vcge_u8(pixels.val[2], ly), vcle_u8(pixels.val[2], uy)));
+                    vst2_u8(out, mask);
+                }
+            }
+        }
+    }
+}
+#endif
@@ -0,0 +1,66 @@
+/*
+ *  yuv422_bithreshold_sse2.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/cv/cv.hpp>
+
+// Only built for x86 (with -msse2)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+namespace kybernetes
+{
+    namespace cv
+    {
+        // Threshold 16 pixels (32 bytes of YUYV) at a time.  The bytes are compared in place against
+        // bounds laid out as Y U Y V, then each Y's mask is and'ed with its pair's U and V masks, and the
+        // pixels' bytes packed out of the groups.
+        void yuv422_bithreshold_sse2(const uint8_t *source, size_t sourceStride, uint8_t *destination, size_t destinationStride,
+                                     unsigned int width, unsigned int height, const uint8_t *lower, const uint8_t *upper)
+        {
+            const __m128i low  = _mm_set1_epi32(lower[0] | (lower[1] << 8) | (lower[0] << 16) | (lower[2] << 24));
+            const __m128i high = _mm_set1_epi32(upper[0] | (upper[1] << 8) | (upper[0] << 16) | (upper[2] << 24));
+
+            for(unsigned int y = 0; y < height; y++)
+            {
+                const uint8_t *row = source + y * sourceStride;
+                uint8_t       *out = destination + y * destinationStride;
+                for(unsigned int x = 0; x < width; x += 16, row += 32, out += 16)
+                {
+                    __m128i a = _mm_loadu_si128((const __m128i *) row);
+                    __m128i b = _mm_loadu_si128((const __m128i *) (row + 16));
+
+                    // Each byte within its bounds (unsigned, x == max(x, low) and x == min(x, high))
+                    __m128i ma = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(a, low), a), _mm_cmpeq_epi8(_mm_min_epu8(a, high), a));
+                    __m128i mb = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(b, low), b), _mm_cmpeq_epi8(_mm_min_epu8(b, high), b));
+
+                    // U and V's masks into the low byte of the pair's words, and'ed with each other
+                    __m128i ca = _mm_srli_epi16(ma, 8);
+                    __m128i cb = _mm_srli_epi16(mb, 8);
+                    ca = _mm_and_si128(ca, _mm_shufflehi_epi16(_mm_shufflelo_epi16(ca, 0xB1), 0xB1));
+                    cb = _mm_and_si128(cb, _mm_shufflehi_epi16(_mm_shufflelo_epi16(cb, 0xB1), 0xB1));
+
+                    // Which leaves each word the mask of its pixel, pack them to bytes
+                    _mm_storeu_si128((__m128i *) out, _mm_packus_epi16(_mm_and_si128(ma, ca), _mm_and_si128(mb, cb)));
+                }
+            }
+        }
+    }
+}
+#endif
@@ -0,0 +1,55 @@
+/*
+ *  yuv_planar_bithreshold.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/cv/cv.hpp>
+
+// Threshold planar YUV, the chroma rows are shared by 1 << shift luma rows
+static void planar_bithreshold(const uint8_t *source, uint8_t *destination, unsigned int width, unsigned int height, unsigned int shift,
+                               uint8_t ly, uint8_t lu, uint8_t lv, uint8_t uy, uint8_t uu, uint8_t uv)
+{
+    unsigned int  chromaWidth = (width + 1) / 2;
+    const uint8_t *u          = source + width * height;
+    const uint8_t *v          = u + chromaWidth * ((height + (1 << shift) - 1) >> shift);
+
+    for(unsigned int y = 0; y < height; y++)
+    {
+        const uint8_t *luma = source + y * width;
+        const uint8_t *cb   = u + (y >> shift) * chromaWidth;
+        const uint8_t *cr   = v + (y >> shift) * chromaWidth;
+        uint8_t       *out  = destination + y * width;
+
+        // Pixels in range are 0xFF, like the packed version's comparison masks
+        for(unsigned int x = 0; x < width; x++)
+        {
+            bool in = luma[x] >= ly && luma[x] <= uy && cb[x >> 1] >= lu && cb[x >> 1] <= uu && cr[x >> 1] >= lv && cr[x >> 1] <= uv;
+            out[x] = in ? 0xFF : 0x00;
+        }
+    }
+}
+
+void kybernetes::cv::yuv422p_bithreshold(const void *source, void *destination, uint16_t width, uint16_t height, uint8_t ly, uint8_t lu, uint8_t lv, uint8_t uy, uint8_t uu, uint8_t uv)
+{
+    planar_bithreshold((const uint8_t *) source, (uint8_t *) destination, width, height, 0, ly, lu, lv, uy, uu, uv);
+}
+
+void kybernetes::cv::yuv420p_bithreshold(const void *source, void *destination, uint16_t width, uint16_t height, uint8_t ly, uint8_t lu, uint8_t lv, uint8_t uy, uint8_t uu, uint8_t uv)
+{
+    planar_bithreshold((const uint8_t *) source, (uint8_t *) destination, width, height, 1, ly, lu, lv, uy, uu, uv);
+}
@@ -0,0 +1,52 @@
+/*
+ *  fast_math.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/math/fast_math.hpp>
+
+// The loops below are plain element wise loops over the branch free scalar kernels, which
+// is the form the auto-vectorizer handles.  They live in this file rather than the header so
+// that only this file is built with the flags the vectorizer needs (see CMakeLists.txt).
+
+// atan2 over arrays
+void kybernetes::math::fastAtan2(const float *y, const float *x, float *result, unsigned int count)
+{
+    for(unsigned int i = 0; i < count; i++)
+        result[i] = fastAtan2(y[i], x[i]);
+}
+
+// sin over an array
+void kybernetes::math::fastSin(const float *x, float *result, unsigned int count)
+{
+    for(unsigned int i = 0; i < count; i++)
+        result[i] = fastSinQuadrant(x[i], 0);
+}
+
+// cos over an array
+void kybernetes::math::fastCos(const float *x, float *result, unsigned int count)
+{
+    for(unsigned int i = 0; i < count; i++)
+        result[i] = fastSinQuadrant(x[i], 1);
+}
+
+// sqrt over an array
+void kybernetes::math::fastSqrt(const float *x, float *result, unsigned int count)
+{
+    for(unsigned int i = 0; i < count; i++)
+        result[i] = fastSqrt(x[i]);
+}
@@ -0,0 +1,277 @@
+/*
+ *  geofence.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/math/geofence.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+using namespace kybernetes::math;
+
+// Default constructor, an empty fence contains nothing
+Geofence::Geofence()
+    : m_cellSize(2.0), m_originX(0.0), m_originY(0.0), m_columns(0), m_rows(0)
+{
+
+}
+
+// Construct a fence from a polygon
+Geofence::Geofence(const std::vector<GeoCoordinate>& polygon, const LocalFrame& frame, double cellSize)
+    : m_frame(frame), m_cellSize(cellSize), m_originX(0.0), m_originY(0.0), m_columns(0), m_rows(0)
+{
+    build(polygon);
+}
+
+// Load the polygon from a coordinate list file
+bool Geofence::load(const std::string& path, const LocalFrame& frame, double cellSize)
+{
+    // Read the vertices
+    std::vector<GeoCoordinate> polygon;
+    if(!loadCoordinateList(path, polygon) || polygon.size() < 3)
+        return false;
+
+    // Build the index
+    m_frame = frame;
+    m_cellSize = cellSize;
+    build(polygon);
+    return true;
+}
+
+// Build the grid index
+void Geofence::build(const std::vector<GeoCoordinate>& polygon)
+{
+    // Clear any previous polygon
+    m_vertices.clear();
+    m_cells.clear();
+    m_crossingEdges.clear();
+    m_nearestEdges.clear();
+    m_columns = m_rows = 0;
+
+    // Project the polygon into the frame, the closing vertex is implied
+    for(std::vector<GeoCoordinate>::const_iterator it = polygon.begin(); it != polygon.end(); ++it)
+        m_vertices.push_back(m_frame.toLocal(*it));
+    if(m_vertices.size() > 1 && m_vertices.front().x == m_vertices.back().x && m_vertices.front().y == m_vertices.back().y)
+        m_vertices.pop_back();
+    if(m_vertices.size() < 3)
+    {
+        m_vertices.clear();
+        return;
+    }
+
+    // Find the bounds of the polygon, with a cell of margin around it
+    double minX = m_vertices[0].x, maxX = m_vertices[0].x;
+    double minY = m_vertices[0].y, maxY = m_vertices[0].y;
+    for(size_t i = 1; i < m_vertices.size(); i++)
+    {
+        minX = std::min(minX, m_vertices[i].x);
+        maxX = std::max(maxX, m_vertices[i].x);
+        minY = std::min(minY, m_vertices[i].y);
+        maxY = std::max(maxY, m_vertices[i].y);
+    }
+    m_originX = minX - m_cellSize;
+    m_originY = minY - m_cellSize;
+    m_columns = (int) std::ceil((maxX - m_originX) / m_cellSize) + 1;
+    m_rows    = (int) std::ceil((maxY - m_originY) / m_cellSize) + 1;
+
+    // Any point in a cell is within this distance of its center
+    double radius = m_cellSize * M_SQRT1_2;
+
+    // Index every cell
+    unsigned int edges = m_vertices.size();
+    std::vector<double> distances(edges);
+    m_cells.resize(m_columns * m_rows);
+    for(int i = 0; i < m_columns * m_rows; i++)
+    {
+        cell& c = m_cells[i];
+        LocalCoordinate center = cellCenter(i);
+        c.inside = containsSlow(center);
+
+        // Distance from the center to every edge
+        double nearest = std::numeric_limits<double>::max();
+        for(unsigned int e = 0; e < edges; e++)
+        {
+            distances[e] = edgeDistance(e, center);
+            nearest = std::min(nearest, distances[e]);
+        }
+
+        // Edges within the circumscribed circle may pass through the cell.  The segment from
+        // the center to a query point can only cross these.
+        c.crossingBegin = m_crossingEdges.size();
+        for(unsigned int e = 0; e < edges; e++)
+            if(distances[e] <= radius)
+                m_crossingEdges.push_back(e);
+        c.crossingCount = m_crossingEdges.size() - c.crossingBegin;
+
+        // For a point within radius of the center, the nearest edge is no further than
+        // nearest + radius, and an edge further than nearest + 2 * radius from the center is
+        // at least nearest + radius from the point, so only the edges in between can be nearest
+        c.nearestBegin = m_nearestEdges.size();
+        for(unsigned int e = 0; e < edges; e++)
+            if(distances[e] <= nearest + 2.0 * radius)
+                m_nearestEdges.push_back(e);
+        c.nearestCount = m_nearestEdges.size() - c.nearestBegin;
+    }
+}
+
+// Distance from a position to an edge of the polygon
+double Geofence::edgeDistance(unsigned int edge, const LocalCoordinate& position) const
+{
+    const LocalCoordinate& a = m_vertices[edge];
+    const LocalCoordinate& b = m_vertices[(edge + 1) % m_vertices.size()];
+
+    // Project the position onto the edge
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    double l2 = dx*dx + dy*dy;
+    double t  = (l2 > 0.0) ? ((position.x - a.x) * dx + (position.y - a.y) * dy) / l2 : 0.0;
+    t = std::max(0.0, std::min(t, 1.0));
+
+    // Distance to the projected point
+    double ex = position.x - (a.x + dx * t);
+    double ey = position.y - (a.y + dy * t);
+    return std::sqrt(ex*ex + ey*ey);
+}
+
+// Check if the segment (p, q) crosses an edge of the polygon
+bool Geofence::edgeCrosses(unsigned int edge, const LocalCoordinate& p, const LocalCoordinate& q) const
+{
+    const LocalCoordinate& a = m_vertices[edge];
+    const LocalCoordinate& b = m_vertices[(edge + 1) % m_vertices.size()];
+
+    // Use the same half open rule as the ray cast, the edge counts if exactly one of its ends
+    // is on the left of the line through (p, q) and the crossing is between p and q
+    double ex = q.x - p.x, ey = q.y - p.y;
+    double sa = ex * (a.y - p.y) - ey * (a.x - p.x);
+    double sb = ex * (b.y - p.y) - ey * (b.x - p.x);
+    if((sa > 0.0) == (sb > 0.0))
+        return false;
+
+    // Which side of the edge are p and q on
+    double fx = b.x - a.x, fy = b.y - a.y;
+    double sp = fx * (p.y - a.y) - fy * (p.x - a.x);
+    double sq = fx * (q.y - a.y) - fy * (q.x - a.x);
+    return (sp > 0.0) != (sq > 0.0);
+}
+
+// Ray cast point in polygon test against every edge
+bool Geofence::containsSlow(const LocalCoordinate& position) const
+{
+    bool inside = false;
+    size_t n = m_vertices.size();
+    for(size_t i = 0, j = n - 1; i < n; j = i++)
+    {
+        const LocalCoordinate& a = m_vertices[i];
+        const LocalCoordinate& b = m_vertices[j];
+        if(((a.y > position.y) != (b.y > position.y)) &&
+           (position.x < (b.x - a.x) * (position.y - a.y) / (b.y - a.y) + a.x))
+            inside = !inside;
+    }
+    return inside;
+}
+
+// Distance to the nearest edge, checking every edge
+double Geofence::distanceSlow(const LocalCoordinate& position) const
+{
+    double nearest = std::numeric_limits<double>::max();
+    for(unsigned int e = 0; e < m_vertices.size(); e++)
+        nearest = std::min(nearest, edgeDistance(e, position));
+    return nearest;
+}
+
+// Get the cell containing a position, or -1 if its off the grid
+int Geofence::cellIndex(const LocalCoordinate& position) const
+{
+    int column = (int) std::floor((position.x - m_originX) / m_cellSize);
+    int row    = (int) std::floor((position.y - m_originY) / m_cellSize);
+    if(column < 0 || column >= m_columns || row < 0 || row >= m_rows)
+        return -1;
+    return row * m_columns + column;
+}
+
+// Get the center of a cell
+LocalCoordinate Geofence::cellCenter(int index) const
+{
+    return LocalCoordinate(m_originX + ((index % m_columns) + 0.5) * m_cellSize,
+                           m_originY + ((index / m_columns) + 0.5) * m_cellSize);
+}
+
+// Check if the geofence has a polygon
+bool Geofence::isValid() const
+{
+    return !m_vertices.empty();
+}
+
+// Check if a position is inside of the fence
+bool Geofence::contains(const LocalCoordinate& position) const
+{
+    // Off the grid is outside the polygon's bounds
+    int index = cellIndex(position);
+    if(index < 0)
+        return false;
+
+    // Start with the state of the cell center and flip for every edge crossed on the way
+    // from the center to the position
+    const cell& c = m_cells[index];
+    LocalCoordinate center = cellCenter(index);
+    bool inside = c.inside;
+    for(unsigned int i = c.crossingBegin; i < c.crossingBegin + c.crossingCount; i++)
+        if(edgeCrosses(m_crossingEdges[i], center, position))
+            inside = !inside;
+    return inside;
+}
+
+// Get the distance to the boundary of the fence
+double Geofence::distanceToBoundary(const LocalCoordinate& position) const
+{
+    // Without a polygon there is no boundary
+    if(m_vertices.empty())
+        return std::numeric_limits<double>::max();
+
+    // Off the grid, fall back to checking every edge
+    int index = cellIndex(position);
+    if(index < 0)
+        return distanceSlow(position);
+
+    // Only check the edges that can be nearest to this cell
+    const cell& c = m_cells[index];
+    double nearest = std::numeric_limits<double>::max();
+    for(unsigned int i = c.nearestBegin; i < c.nearestBegin + c.nearestCount; i++)
+        nearest = std::min(nearest, edgeDistance(m_nearestEdges[i], position));
+    return nearest;
+}
+
+// Signed distance to the boundary, positive inside
+double Geofence::clearance(const LocalCoordinate& position) const
+{
+    double distance = distanceToBoundary(position);
+    return contains(position) ? distance : -distance;
+}
+
+// Check if a geographic position is inside of the fence
+bool Geofence::contains(const GeoCoordinate& position) const
+{
+    return contains(m_frame.toLocal(position));
+}
+
+// Signed distance to the boundary from a geographic position
+double Geofence::clearance(const GeoCoordinate& position) const
+{
+    return clearance(m_frame.toLocal(position));
+}
@@ -19,6 +19,8 @@
 
 #include <kybernetes/math/gps_common.hpp>
 #include <cmath>
+#include <fstream>
+#include <iomanip>
 
 using namespace kybernetes::math;
 
@@ -83,4 +85,36 @@ double GeoCoordinate::distanceTo(GeoCoordinate &coordinate)
     double a = (s1 * s1) + (s2 * s2 * std::cos(rlat1) * std::cos(rlat2));
     double c = 2 * std::atan2(std::sqrt(a), std::sqrt(1.0 - a));
     return R * c;
-}
\ No newline at end of file
+}
+
+// Load the coordinates from a manifest file
+bool kybernetes::math::loadCoordinateList(const std::string& path, std::vector<GeoCoordinate>& coordinates)
+{
+    // Open the manifest
+    std::ifstream manifest(path.c_str());
+    if(!manifest.is_open())
+        return false;
+    
+    // Read coordinate pairs until we run out of file
+    GeoCoordinate coordinate;
+    while(manifest >> coordinate.latitude >> coordinate.longitude)
+        coordinates.push_back(coordinate);
+    
+    // Return success if we read until the end of the file
+    return manifest.eof();
+}
+
+// Write the coordinates to a manifest file
+bool kybernetes::math::saveCoordinateList(const std::string& path, const std::vector<GeoCoordinate>& coordinates)
+{
+    // Open the manifest
+    std::ofstream manifest(path.c_str());
+    if(!manifest.is_open())
+        return false;
+    
+    // Write a pair per line, 7 places is about a centimeter
+    manifest << std::fixed << std::setprecision(7);
+    for(std::vector<GeoCoordinate>::const_iterator it = coordinates.begin(); it != coordinates.end(); ++it)
+        manifest << it->latitude << " " << it->longitude << std::endl;
+    return manifest.good();
+}
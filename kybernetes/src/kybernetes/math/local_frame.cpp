@@ -0,0 +1,92 @@
+/*
+ *  local_frame.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/math/local_frame.hpp>
+#include <cmath>
+
+using namespace kybernetes::math;
+
+// Mean radius of the earth in meters (same as GeoCoordinate::distanceTo)
+static const double EARTH_RADIUS = 6371000.0;
+
+// Default constructor
+LocalCoordinate::LocalCoordinate()
+    : x(0.0), y(0.0)
+{
+
+}
+
+// Constructor, just copy in the easting and northing
+LocalCoordinate::LocalCoordinate(double _x, double _y)
+    : x(_x), y(_y)
+{
+
+}
+
+// Get the compass heading to another local coordinate
+double LocalCoordinate::headingTo(const LocalCoordinate& coordinate) const
+{
+    // atan2 with the axes swapped gives a heading clockwise from north
+    double heading = std::atan2(coordinate.x - x, coordinate.y - y) * (180.0 / M_PI);
+    return heading;
+}
+
+// Get the distance in meters to another local coordinate
+double LocalCoordinate::distanceTo(const LocalCoordinate& coordinate) const
+{
+    double dx = coordinate.x - x;
+    double dy = coordinate.y - y;
+    return std::sqrt(dx*dx + dy*dy);
+}
+
+// Default constructor
+LocalFrame::LocalFrame()
+{
+    m_metersPerDegreeLatitude  = EARTH_RADIUS * (M_PI / 180.0);
+    m_metersPerDegreeLongitude = m_metersPerDegreeLatitude;
+}
+
+// Construct a frame about an origin
+LocalFrame::LocalFrame(const GeoCoordinate& origin)
+    : m_origin(origin)
+{
+    // Lines of longitude converge by the cosine of the latitude
+    m_metersPerDegreeLatitude  = EARTH_RADIUS * (M_PI / 180.0);
+    m_metersPerDegreeLongitude = m_metersPerDegreeLatitude * std::cos(origin.latitude * (M_PI / 180.0));
+}
+
+// Project a geographic coordinate into the frame
+LocalCoordinate LocalFrame::toLocal(const GeoCoordinate& coordinate) const
+{
+    return LocalCoordinate((coordinate.longitude - m_origin.longitude) * m_metersPerDegreeLongitude,
+                           (coordinate.latitude  - m_origin.latitude)  * m_metersPerDegreeLatitude);
+}
+
+// Project a local coordinate back out to the globe
+GeoCoordinate LocalFrame::toGeo(const LocalCoordinate& coordinate) const
+{
+    return GeoCoordinate(m_origin.latitude  + (coordinate.y / m_metersPerDegreeLatitude),
+                         m_origin.longitude + (coordinate.x / m_metersPerDegreeLongitude));
+}
+
+// Get the origin of the frame
+const GeoCoordinate& LocalFrame::origin() const
+{
+    return m_origin;
+}
@@ -0,0 +1,263 @@
+/*
+ *  route.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/math/route.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+using namespace kybernetes::math;
+
+// When searching near a previous result, each meter of jump along the route costs as much as
+// 0.1 m of distance from the route.  This keeps progress on the current leg where an out and
+// back course passes over itself.  Jumping backwards costs more, since the vehicle normally
+// makes forward progress, which breaks the tie at the turnaround of a retraced leg.
+static const double CONTINUITY_WEIGHT = 0.01;
+static const double BACKTRACK_FACTOR  = 4.0;
+
+// Default constructor, an empty route
+Route::Route()
+{
+
+}
+
+// Construct a route laid out about its first waypoint
+Route::Route(const std::vector<GeoCoordinate>& waypoints)
+{
+    if(waypoints.size())
+        m_frame = LocalFrame(waypoints.front());
+    build(waypoints);
+}
+
+// Construct a route in a provided frame
+Route::Route(const std::vector<GeoCoordinate>& waypoints, const LocalFrame& frame)
+    : m_frame(frame)
+{
+    build(waypoints);
+}
+
+// Load the route from a coordinate list file
+bool Route::load(const std::string& path)
+{
+    // Read the waypoints
+    std::vector<GeoCoordinate> waypoints;
+    if(!loadCoordinateList(path, waypoints))
+        return false;
+
+    // Rebuild about the first waypoint
+    if(waypoints.size())
+        m_frame = LocalFrame(waypoints.front());
+    build(waypoints);
+    return true;
+}
+
+// Precompute everything that doesn't depend on the position of the vehicle
+void Route::build(const std::vector<GeoCoordinate>& waypoints)
+{
+    // Clear any previous route
+    m_waypoints.clear();
+    m_directions.clear();
+    m_lengths.clear();
+    m_headings.clear();
+    m_cumulative.clear();
+
+    // Project the waypoints into the frame
+    for(std::vector<GeoCoordinate>::const_iterator it = waypoints.begin(); it != waypoints.end(); ++it)
+        m_waypoints.push_back(m_frame.toLocal(*it));
+
+    // Compute the segment data
+    double along = 0.0;
+    for(size_t i = 0; i < m_waypoints.size(); i++)
+    {
+        // Store the distance along the route to this waypoint
+        m_cumulative.push_back(along);
+        if(i + 1 == m_waypoints.size())
+            break;
+
+        // Segment vector
+        double dx = m_waypoints[i+1].x - m_waypoints[i].x;
+        double dy = m_waypoints[i+1].y - m_waypoints[i].y;
+        double length = std::sqrt(dx*dx + dy*dy);
+
+        // Duplicate waypoints leave a zero length segment, give it a direction anyways
+        if(length > 0.0)
+            m_directions.push_back(LocalCoordinate(dx / length, dy / length));
+        else
+            m_directions.push_back(LocalCoordinate(0.0, 1.0));
+        m_lengths.push_back(length);
+        m_headings.push_back(m_waypoints[i].headingTo(m_waypoints[i+1]));
+        along += length;
+    }
+}
+
+// Number of waypoints
+size_t Route::size() const
+{
+    return m_waypoints.size();
+}
+
+// Number of segments
+size_t Route::segments() const
+{
+    return m_lengths.size();
+}
+
+// Total length of the route in meters
+double Route::length() const
+{
+    return m_cumulative.size() ? m_cumulative.back() : 0.0;
+}
+
+// The frame the route is laid out in
+const LocalFrame& Route::frame() const
+{
+    return m_frame;
+}
+
+// Get a waypoint in the local frame
+const LocalCoordinate& Route::waypoint(size_t index) const
+{
+    return m_waypoints[index];
+}
+
+// Get the distance along the route to a waypoint
+double Route::distanceAt(size_t index) const
+{
+    return m_cumulative[index];
+}
+
+// Get the compass heading of a segment
+double Route::heading(size_t segment) const
+{
+    return m_headings[segment];
+}
+
+// Find the segment containing a distance along the route
+size_t Route::segmentAt(double along) const
+{
+    // No segments, everything is on the first waypoint
+    if(m_lengths.empty())
+        return 0;
+
+    // Find the first waypoint beyond the distance, the segment before it contains the distance
+    std::vector<double>::const_iterator it = std::upper_bound(m_cumulative.begin(), m_cumulative.end(), along);
+    size_t segment = (it == m_cumulative.begin()) ? 0 : (it - m_cumulative.begin()) - 1;
+    return std::min(segment, m_lengths.size() - 1);
+}
+
+// Get the point at a distance along the route (clamped to the ends of the route)
+LocalCoordinate Route::pointAt(double along) const
+{
+    // Empty and single point routes
+    if(m_waypoints.empty())
+        return LocalCoordinate();
+    if(m_lengths.empty())
+        return m_waypoints.front();
+
+    // Clamp the distance to the route
+    along = std::max(0.0, std::min(along, length()));
+
+    // Interpolate along the containing segment
+    size_t segment = segmentAt(along);
+    double t = along - m_cumulative[segment];
+    return LocalCoordinate(m_waypoints[segment].x + m_directions[segment].x * t,
+                           m_waypoints[segment].y + m_directions[segment].y * t);
+}
+
+// Project a position onto a single segment, replacing the result if it scores better.  The score is
+// the squared distance from the route plus the weighted squared jump from a reference distance along it.
+void Route::projectSegment(size_t segment, const LocalCoordinate& position, double reference, double weight, progress& result, double& score) const
+{
+    // Vector from the start of the segment to the position
+    const LocalCoordinate& a = m_waypoints[segment];
+    const LocalCoordinate& d = m_directions[segment];
+    double vx = position.x - a.x;
+    double vy = position.y - a.y;
+
+    // Distance along the segment of the closest point
+    double t = vx * d.x + vy * d.y;
+    t = std::max(0.0, std::min(t, m_lengths[segment]));
+
+    // Distance from the closest point
+    double cx = a.x + d.x * t;
+    double cy = a.y + d.y * t;
+    double ex = position.x - cx;
+    double ey = position.y - cy;
+    double e2 = ex*ex + ey*ey;
+
+    // Keep this segment if it is the best so far
+    double along = m_cumulative[segment] + t;
+    double jump  = along - reference;
+    double cost  = e2 + ((jump < 0.0) ? BACKTRACK_FACTOR : 1.0) * weight * jump * jump;
+    if(cost < score)
+    {
+        score = cost;
+        result.segment = segment;
+        result.along = along;
+        result.closest = LocalCoordinate(cx, cy);
+
+        // Cross track error is signed by which side of the segment direction we're on
+        double side = d.y * vx - d.x * vy;
+        result.crossTrack = (side < 0.0) ? -std::sqrt(e2) : std::sqrt(e2);
+    }
+}
+
+// Find the closest point on the entire route
+Route::progress Route::locate(const LocalCoordinate& position) const
+{
+    // Default to the start of the route
+    progress result;
+    result.segment = 0;
+    result.along = 0.0;
+    result.crossTrack = 0.0;
+    if(m_waypoints.empty())
+        return result;
+    result.closest = m_waypoints.front();
+    result.crossTrack = position.distanceTo(result.closest);
+
+    // Check every segment
+    double score = std::numeric_limits<double>::max();
+    for(size_t i = 0; i < m_lengths.size(); i++)
+        projectSegment(i, position, 0.0, 0.0, result, score);
+    return result;
+}
+
+// Find the closest point on the route near a previous result
+Route::progress Route::locate(const LocalCoordinate& position, const progress& previous, double behind, double ahead) const
+{
+    // Default to the start of the route
+    progress result = previous;
+    if(m_lengths.empty())
+        return locate(position);
+
+    // Only consider the segments within the window around the previous result
+    size_t first = segmentAt(previous.along - behind);
+    size_t last  = segmentAt(previous.along + ahead);
+    double score = std::numeric_limits<double>::max();
+    for(size_t i = first; i <= last; i++)
+        projectSegment(i, position, previous.along, CONTINUITY_WEIGHT, result, score);
+    return result;
+}
+
+// Get the point a distance further along the route
+LocalCoordinate Route::lookahead(const progress& current, double distance) const
+{
+    return pointAt(current.along + distance);
+}
@@ -0,0 +1,130 @@
+/*
+ *  dead_reckoning.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/navigation/dead_reckoning.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+#include <cmath>
+
+using namespace kybernetes::controller;
+using namespace kybernetes::navigation;
+using namespace kybernetes::sensor;
+
+// Constructor for the object
+DeadReckoning::DeadReckoning(const kybernetes::math::LocalFrame& frame, double metersPerUnit)
+    : m_frame(frame), m_yaw(0.0), m_haveYaw(false), m_odometer(0.0f), m_haveOdometer(false), m_frameTime(0.0), m_metersPerUnit(metersPerUnit)
+{
+    // Do some initialization
+    m_state.heading   = 0.0;
+    m_state.speed     = 0.0;
+    m_state.sinceFix  = 0.0;
+    m_state.timestamp = 0.0;
+    m_state.valid     = false;
+}
+
+// Obtaining data
+DeadReckoning::state DeadReckoning::fetchState()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_state;
+}
+
+// The estimate is ready once a fix has anchored it
+bool DeadReckoning::isReady()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_state.valid;
+}
+
+// Store a callback object in our callbacks list
+void DeadReckoning::registerCallback(DeadReckoning::callback *c)
+{
+    m_callbacks.push_back(c);
+}
+
+// Remove a stored callback object in our callbacks list
+void DeadReckoning::unregisterCallback(DeadReckoning::callback *c)
+{
+    m_callbacks.remove(c);
+}
+
+// A telemetry frame arrived, step the estimate along the current yaw
+void DeadReckoning::motors_event_update(MotionController::state s)
+{
+    // Integrate the odometer delta
+    boost::mutex::scoped_lock lock(m_mutex);
+    double now = kybernetes::utility::monotonicTime();
+    double step = m_haveOdometer ? (s.odometer - m_odometer) * m_metersPerUnit : 0.0;
+    double interval = m_haveOdometer ? now - m_frameTime : 0.0;
+    m_odometer = s.odometer;
+    m_frameTime = now;
+    m_haveOdometer = true;
+
+    // Drop odometer resets and anything else the vehicle couldn't have driven in one frame
+    if(s.odometer == 0.0f || std::fabs(step) > ODOMETER_MAXIMUM_STEP)
+        step = 0.0;
+    if(interval > 0.0)
+        m_state.speed = step / interval;
+
+    // Move along the yaw (compass heading, so x is the sine component)
+    if(m_haveYaw)
+    {
+        double heading = m_yaw * (M_PI / 180.0);
+        m_state.position.x += step * std::sin(heading);
+        m_state.position.y += step * std::cos(heading);
+        m_state.heading = m_yaw;
+    }
+    m_state.sinceFix += std::fabs(step);
+    m_state.timestamp = now;
+    DeadReckoning::state state = m_state;
+    lock.unlock();
+
+    // Execute queued callbacks for the "estimate updated" event
+    if(!state.valid) return;
+    for(std::list<DeadReckoning::callback *>::iterator it = m_callbacks.begin(); it != m_callbacks.end(); ++it)
+        (*it)->odometry_event_update(state);
+}
+
+// The imu updated, store the heading for the next step
+void DeadReckoning::imu_event_update(IMU::state s)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_yaw = s.yaw;
+    m_haveYaw = true;
+}
+
+// The gps updated, re-anchor on a valid fix
+void DeadReckoning::gps_event_update(GPS::state s)
+{
+    // Ignore invalid fixes
+    if(!s.valid) return;
+
+    // Snap the estimate to the fix
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_state.position  = m_frame.toLocal(s.location);
+    m_state.sinceFix  = 0.0;
+    m_state.timestamp = kybernetes::utility::monotonicTime();
+    m_state.valid     = true;
+    DeadReckoning::state state = m_state;
+    lock.unlock();
+
+    // Execute queued callbacks for the "estimate anchored" event
+    for(std::list<DeadReckoning::callback *>::iterator it = m_callbacks.begin(); it != m_callbacks.end(); ++it)
+        (*it)->odometry_event_anchored(state);
+}
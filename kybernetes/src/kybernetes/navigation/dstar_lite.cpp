@@ -0,0 +1,444 @@
+/*
+ *  dstar_lite.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/navigation/dstar_lite.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace kybernetes::navigation;
+
+// Cost of an untraversable edge, and of the two kinds of step (99 / 70 is within 0.01% of
+// root 2).  Infinity leaves room for sums of costs without overflowing.
+static const unsigned int INFINITE = 1u << 30;
+static const unsigned int STRAIGHT = 70;
+static const unsigned int DIAGONAL = 99;
+
+// Neighbors, the four straight steps first then the diagonals (E, N, W, S, NE, NW, SW, SE)
+static const int DX[8] = { 1, 0, -1,  0, 1, -1, -1,  1 };
+static const int DY[8] = { 0, 1,  0, -1, 1,  1, -1, -1 };
+
+// Sum of costs, saturating at infinity
+static inline unsigned int sum(unsigned int a, unsigned int b)
+{
+    return std::min(INFINITE, a + b);
+}
+
+// Constructor for the object
+DStarLite::DStarLite(int width, int height)
+    : m_width(width), m_height(height), m_stride(width + 2), m_start(0), m_goal(0), m_last(0), m_km(0), m_initialized(false), m_expanded(0)
+{
+    // Per cell state, the border is blocked and every other cell free
+    unsigned int cells = (unsigned int) (m_stride * (height + 2));
+    m_g.resize(cells, INFINITE);
+    m_rhs.resize(cells, INFINITE);
+    m_position.resize(cells, -1);
+    m_blocked.resize(cells, 0);
+    for(int x = 0; x < m_stride; x++)
+    {
+        m_blocked[x] = 1;
+        m_blocked[cells - 1 - x] = 1;
+    }
+    for(int y = 0; y < height + 2; y++)
+    {
+        m_blocked[y * m_stride] = 1;
+        m_blocked[y * m_stride + m_stride - 1] = 1;
+    }
+
+    // Neighbor offsets in the padded arrays
+    for(int i = 0; i < 8; i++)
+    {
+        m_offsets[i] = DY[i] * m_stride + DX[i];
+        m_costs[i]   = (i < 4) ? STRAIGHT : DIAGONAL;
+    }
+}
+
+// Index of a cell in the padded arrays
+unsigned int DStarLite::index(int x, int y) const
+{
+    return (unsigned int) ((y + 1) * m_stride + (x + 1));
+}
+
+// Cell at an index of the padded arrays
+DStarLite::cell DStarLite::coordinates(unsigned int node) const
+{
+    DStarLite::cell c;
+    c.x = (int) (node % m_stride) - 1;
+    c.y = (int) (node / m_stride) - 1;
+    return c;
+}
+
+// Octile distance, exact on an empty grid so it never overestimates
+unsigned int DStarLite::heuristic(unsigned int a, unsigned int b) const
+{
+    int dx = std::abs((int) (a % m_stride) - (int) (b % m_stride));
+    int dy = std::abs((int) (a / m_stride) - (int) (b / m_stride));
+    return (DIAGONAL - STRAIGHT) * (unsigned int) std::min(dx, dy) + STRAIGHT * (unsigned int) std::max(dx, dy);
+}
+
+// Cost of the step from a cell to a neighbor (an index into the offsets).  Diagonal steps are
+// only allowed if both of the cells they pass between are free.  Costs are symmetric, the step
+// back from the neighbor costs the same.
+unsigned int DStarLite::cost(unsigned int a, int direction) const
+{
+    if(m_blocked[a] || m_blocked[a + m_offsets[direction]])
+        return INFINITE;
+    if(direction >= 4 && (m_blocked[a + DX[direction]] || m_blocked[a + DY[direction] * m_stride]))
+        return INFINITE;
+    return m_costs[direction];
+}
+
+// Priority of a cell
+void DStarLite::key(unsigned int node, unsigned int& k1, unsigned int& k2) const
+{
+    k2 = std::min(m_g[node], m_rhs[node]);
+    k1 = k2 + heuristic(m_start, node) + m_km;
+}
+
+// The one step lookahead cost of a cell, the cheapest way to the goal through a neighbor
+unsigned int DStarLite::lookahead(unsigned int node) const
+{
+    unsigned int best = INFINITE;
+    for(int i = 0; i < 8; i++)
+    {
+        unsigned int c = cost(node, i);
+        if(c != INFINITE)
+            best = std::min(best, sum(c, m_g[node + m_offsets[i]]));
+    }
+    return best;
+}
+
+// Queue or dequeue a cell depending on whether it is consistent
+void DStarLite::updateVertex(unsigned int node)
+{
+    bool queued = m_position[node] >= 0;
+    if(m_g[node] != m_rhs[node])
+    {
+        unsigned int k1, k2;
+        key(node, k1, k2);
+        if(queued)
+            update(node, k1, k2);
+        else
+            push(node, k1, k2);
+    }
+    else if(queued)
+        remove(node);
+}
+
+// Expand cells until the start is consistent and nothing queued could improve it
+void DStarLite::computeShortestPath()
+{
+    m_expanded = 0;
+    while(!m_heap.empty())
+    {
+        // Stop once nothing queued could make the start cheaper.  The start may be left
+        // overconsistent, its rhs is the cost of the path.
+        DStarLite::entry top = m_heap[0];
+        DStarLite::entry start;
+        key(m_start, start.k1, start.k2);
+        if(!less(top, start) && m_rhs[m_start] <= m_g[m_start])
+            break;
+
+        // Requeue a cell whose key is out of date (the start moved since it was queued)
+        unsigned int u = top.node;
+        DStarLite::entry current;
+        key(u, current.k1, current.k2);
+        current.node = u;
+        if(less(top, current))
+        {
+            update(u, current.k1, current.k2);
+            continue;
+        }
+        m_expanded++;
+
+        // Overconsistent, the cell got cheaper, settle it and offer it to its neighbors (edge costs
+        // are symmetric, the predecessors are the neighbors)
+        if(m_g[u] > m_rhs[u])
+        {
+            m_g[u] = m_rhs[u];
+            remove(u);
+            for(int i = 0; i < 8; i++)
+            {
+                unsigned int s = u + m_offsets[i];
+                unsigned int c = cost(u, i);
+                if(s != m_goal && c != INFINITE && c + m_g[u] < m_rhs[s])
+                {
+                    m_rhs[s] = c + m_g[u];
+                    updateVertex(s);
+                }
+            }
+        }
+
+        // Underconsistent, the cell got more expensive, so every neighbor that went through it
+        // (and the cell itself) has to look again
+        else
+        {
+            unsigned int old = m_g[u];
+            m_g[u] = INFINITE;
+            for(int i = 0; i < 8; i++)
+            {
+                unsigned int s = u + m_offsets[i];
+                if(s != m_goal && m_rhs[s] == sum(cost(u, i), old))
+                    m_rhs[s] = lookahead(s);
+                updateVertex(s);
+            }
+            if(u != m_goal && m_rhs[u] == old)
+                m_rhs[u] = lookahead(u);
+            updateVertex(u);
+        }
+    }
+}
+
+// Start a search from scratch toward the goal
+void DStarLite::initialize()
+{
+    std::fill(m_g.begin(), m_g.end(), INFINITE);
+    std::fill(m_rhs.begin(), m_rhs.end(), INFINITE);
+    std::fill(m_position.begin(), m_position.end(), -1);
+    m_heap.clear();
+    m_changed.clear();
+    m_km   = 0;
+    m_last = m_start;
+
+    // The search grows out of the goal
+    m_rhs[m_goal] = 0;
+    push(m_goal, heuristic(m_start, m_goal), 0);
+    m_initialized = true;
+}
+
+// Lexicographic order of the keys
+bool DStarLite::less(const entry& a, const entry& b) const
+{
+    return a.k1 < b.k1 || (a.k1 == b.k1 && a.k2 < b.k2);
+}
+
+// Store an entry at a position of the heap
+void DStarLite::place(int position, const entry& e)
+{
+    m_heap[position] = e;
+    m_position[e.node] = position;
+}
+
+// Move an entry toward the root until its parent is smaller
+void DStarLite::siftUp(int position)
+{
+    DStarLite::entry e = m_heap[position];
+    while(position > 0)
+    {
+        int parent = (position - 1) / DSTAR_HEAP_ARITY;
+        if(!less(e, m_heap[parent]))
+            break;
+        place(position, m_heap[parent]);
+        position = parent;
+    }
+    place(position, e);
+}
+
+// Move an entry toward the leaves until its children are larger
+void DStarLite::siftDown(int position)
+{
+    DStarLite::entry e = m_heap[position];
+    int size = (int) m_heap.size();
+    while(true)
+    {
+        // Find the smallest child, they sit next to each other
+        int first = position * DSTAR_HEAP_ARITY + 1;
+        if(first >= size)
+            break;
+        int last     = std::min(first + DSTAR_HEAP_ARITY, size);
+        int smallest = first;
+        for(int child = first + 1; child < last; child++)
+            if(less(m_heap[child], m_heap[smallest]))
+                smallest = child;
+        if(!less(m_heap[smallest], e))
+            break;
+        place(position, m_heap[smallest]);
+        position = smallest;
+    }
+    place(position, e);
+}
+
+// Queue a cell
+void DStarLite::push(unsigned int node, unsigned int k1, unsigned int k2)
+{
+    DStarLite::entry e;
+    e.k1   = k1;
+    e.k2   = k2;
+    e.node = node;
+    m_heap.push_back(e);
+    m_position[node] = (int) m_heap.size() - 1;
+    siftUp((int) m_heap.size() - 1);
+}
+
+// Change the key of a queued cell
+void DStarLite::update(unsigned int node, unsigned int k1, unsigned int k2)
+{
+    int position = m_position[node];
+    DStarLite::entry e;
+    e.k1   = k1;
+    e.k2   = k2;
+    e.node = node;
+    bool decreased = less(e, m_heap[position]);
+    m_heap[position] = e;
+    if(decreased)
+        siftUp(position);
+    else
+        siftDown(position);
+}
+
+// Dequeue a cell, the last entry takes its place
+void DStarLite::remove(unsigned int node)
+{
+    int position = m_position[node];
+    m_position[node] = -1;
+    DStarLite::entry last = m_heap.back();
+    m_heap.pop_back();
+    if(position == (int) m_heap.size())
+        return;
+    bool decreased = less(last, m_heap[position]);
+    place(position, last);
+    if(decreased)
+        siftUp(position);
+    else
+        siftDown(position);
+}
+
+// Grid size
+int DStarLite::width() const
+{
+    return m_width;
+}
+
+int DStarLite::height() const
+{
+    return m_height;
+}
+
+// Block or clear a cell, cells outside the grid are always blocked
+void DStarLite::setBlocked(int x, int y, bool blocked)
+{
+    if(x < 0 || y < 0 || x >= m_width || y >= m_height)
+        return;
+    unsigned int node = index(x, y);
+    if((m_blocked[node] != 0) == blocked)
+        return;
+    m_blocked[node] = blocked ? 1 : 0;
+    m_changed.push_back(node);
+}
+
+bool DStarLite::isBlocked(int x, int y) const
+{
+    if(x < 0 || y < 0 || x >= m_width || y >= m_height)
+        return true;
+    return m_blocked[index(x, y)] != 0;
+}
+
+// Move the start, clamped onto the grid
+void DStarLite::setStart(int x, int y)
+{
+    m_start = index(std::max(0, std::min(m_width - 1, x)), std::max(0, std::min(m_height - 1, y)));
+}
+
+// Set a new goal, clamped onto the grid.  The search is rooted at the goal so it starts over.
+void DStarLite::setGoal(int x, int y)
+{
+    m_goal        = index(std::max(0, std::min(m_width - 1, x)), std::max(0, std::min(m_height - 1, y)));
+    m_initialized = false;
+}
+
+// Bring the search up to date
+bool DStarLite::plan()
+{
+    if(!m_initialized)
+        initialize();
+    else
+    {
+        // Keys already queued were computed from where the start was, raise the bound instead of
+        // requeueing them
+        m_km  += heuristic(m_last, m_start);
+        m_last = m_start;
+
+        // A changed cell changes the edges around it, including the diagonals past its corners, all
+        // of which end at it or one of its neighbors
+        for(std::vector<unsigned int>::iterator it = m_changed.begin(); it != m_changed.end(); ++it)
+        {
+            if(*it != m_goal)
+            {
+                m_rhs[*it] = lookahead(*it);
+                updateVertex(*it);
+            }
+            for(int i = 0; i < 8; i++)
+            {
+                unsigned int s = *it + m_offsets[i];
+                if(s != m_goal)
+                {
+                    m_rhs[s] = lookahead(s);
+                    updateVertex(s);
+                }
+            }
+        }
+        m_changed.clear();
+    }
+    computeShortestPath();
+    return m_rhs[m_start] != INFINITE;
+}
+
+// Cost of the path from the start in cells
+float DStarLite::cost() const
+{
+    return (m_rhs[m_start] == INFINITE) ? -1.0f : (float) m_rhs[m_start] / STRAIGHT;
+}
+
+// Follow the cheapest neighbor from the start to the goal
+bool DStarLite::path(std::vector<cell>& cells) const
+{
+    cells.clear();
+    if(!m_initialized || m_rhs[m_start] == INFINITE)
+        return false;
+
+    // Every step lowers the cost, so the walk can't be longer than the grid
+    unsigned int node  = m_start;
+    unsigned int limit = (unsigned int) (m_width * m_height);
+    cells.push_back(coordinates(node));
+    while(node != m_goal && cells.size() <= limit)
+    {
+        int          best     = -1;
+        unsigned int bestCost = INFINITE;
+        for(int i = 0; i < 8; i++)
+        {
+            unsigned int c = cost(node, i);
+            if(c != INFINITE && sum(c, m_g[node + m_offsets[i]]) < bestCost)
+            {
+                bestCost = sum(c, m_g[node + m_offsets[i]]);
+                best     = i;
+            }
+        }
+        if(best < 0)
+            return false;
+        node += m_offsets[best];
+        cells.push_back(coordinates(node));
+    }
+    return node == m_goal;
+}
+
+// Cells expanded by the last plan
+unsigned int DStarLite::expanded() const
+{
+    return m_expanded;
+}
@@ -0,0 +1,392 @@
+/*
+ *  fusion_filter.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/navigation/fusion_filter.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+#include <cmath>
+
+using namespace kybernetes::controller;
+using namespace kybernetes::navigation;
+using namespace kybernetes::sensor;
+using namespace kybernetes::math;
+
+// Convert between degrees and radians
+static const double DEG2RAD = M_PI / 180.0;
+static const double RAD2DEG = 180.0 / M_PI;
+
+// Wrap an angle in radians to [-pi, pi)
+static double wrap(double angle)
+{
+    while(angle >= M_PI)  angle -= 2.0 * M_PI;
+    while(angle < -M_PI)  angle += 2.0 * M_PI;
+    return angle;
+}
+
+// Default tuning for the Garmin and the Razor
+FusionFilter::parameters FusionFilter::defaultParameters()
+{
+    parameters p;
+    p.gpsNoise            = 3.0;
+    p.speedNoise          = 0.1;
+    p.headingNoise        = 5.0;
+    p.rateNoise           = 2.0;
+    p.accelerationNoise   = 2.0;
+    p.biasNoise           = 0.05;
+    p.initialHeadingError = 20.0;
+    p.gpsLatency          = 0.3;
+    p.absoluteYaw         = false;
+    p.metersPerUnit       = ODOMETER_METERS_PER_UNIT;
+    return p;
+}
+
+// Constructor for the object
+FusionFilter::FusionFilter(const LocalFrame& frame)
+    : m_frame(frame), m_parameters(defaultParameters())
+{
+    initialize();
+}
+
+// Constructor for the object with custom tuning
+FusionFilter::FusionFilter(const LocalFrame& frame, const parameters& p)
+    : m_frame(frame), m_parameters(p)
+{
+    initialize();
+}
+
+// Reset the filter and its history
+void FusionFilter::initialize()
+{
+    // An empty filter, nothing known yet
+    m_base = snapshot();
+    m_base.time = 0.0;
+    m_base.rate = 0.0;
+    m_base.lastYaw = m_base.lastYawTime = 0.0;
+    m_base.lastOdometer = m_base.lastOdometerTime = 0.0;
+    m_base.haveYaw = m_base.haveOdometer = m_base.initialized = false;
+    m_baseTime = -HUGE_VAL;
+    m_current = m_base;
+
+    // Empty history
+    m_head = 0;
+    m_count = 0;
+    m_dropped = 0;
+}
+
+// Propagate the filter forward to a time
+void FusionFilter::predict(snapshot& f, double time) const
+{
+    // Never step backwards
+    double dt = time - f.time;
+    if(dt <= 0.0) return;
+    f.time = time;
+
+    // The heading integrates the gyro rate (held since the last yaw sample) less the bias
+    double theta = f.x.m[STATE_HEADING][0];
+    double v     = f.x.m[STATE_SPEED][0];
+    double s     = std::sin(theta);
+    double c     = std::cos(theta);
+    f.x.m[STATE_HEADING][0] = wrap(theta + (f.rate - f.x.m[STATE_BIAS][0]) * dt);
+    if(!f.initialized) return;
+
+    // Move along the heading (compass heading, so x is the sine component)
+    f.x.m[STATE_X][0] += v * s * dt;
+    f.x.m[STATE_Y][0] += v * c * dt;
+
+    // Jacobian of the motion model
+    covariance F = covariance::identity();
+    F.m[STATE_X][STATE_HEADING] =  v * c * dt;
+    F.m[STATE_X][STATE_SPEED]   =  s * dt;
+    F.m[STATE_Y][STATE_HEADING] = -v * s * dt;
+    F.m[STATE_Y][STATE_SPEED]   =  c * dt;
+    F.m[STATE_HEADING][STATE_BIAS] = -dt;
+
+    // Propagate the covariance and add the process noise
+    f.P = F * f.P * F.transpose();
+    double rate = m_parameters.rateNoise * DEG2RAD;
+    double bias = m_parameters.biasNoise * DEG2RAD;
+    f.P.m[STATE_HEADING][STATE_HEADING] += rate * rate * dt;
+    f.P.m[STATE_SPEED][STATE_SPEED]     += m_parameters.accelerationNoise * m_parameters.accelerationNoise * dt;
+    f.P.m[STATE_BIAS][STATE_BIAS]       += bias * bias * dt;
+}
+
+// Kalman measurement update
+template <unsigned int M>
+void FusionFilter::correct(snapshot& f, const Matrix<M, 1>& innovation, const Matrix<M, STATE_SIZE>& H, const Matrix<M, M>& R) const
+{
+    // Kalman gain
+    Matrix<STATE_SIZE, M> PHt = f.P * H.transpose();
+    Matrix<M, M>          S   = H * PHt + R;
+    Matrix<STATE_SIZE, M> K   = PHt * inverse(S);
+
+    // Update the state and covariance
+    f.x = f.x + K * innovation;
+    f.x.m[STATE_HEADING][0] = wrap(f.x.m[STATE_HEADING][0]);
+    f.P = (covariance::identity() - K * H) * f.P;
+
+    // Keep the covariance symmetric
+    for(unsigned int i = 0; i < STATE_SIZE; i++)
+        for(unsigned int j = 0; j < i; j++)
+            f.P.m[i][j] = f.P.m[j][i] = 0.5 * (f.P.m[i][j] + f.P.m[j][i]);
+}
+
+// Apply a sample to the filter
+void FusionFilter::apply(snapshot& f, const sample& s) const
+{
+    // A yaw sample sets the rate the heading turns at until the next one
+    if(s.type == SAMPLE_YAW)
+    {
+        double yaw = s.a * DEG2RAD;
+        if(f.haveYaw && s.timestamp > f.lastYawTime)
+            f.rate = wrap(yaw - f.lastYaw) / (s.timestamp - f.lastYawTime);
+
+        // The first yaw is our only idea of the heading
+        if(!f.haveYaw)
+        {
+            f.x.m[STATE_HEADING][0] = wrap(yaw);
+            f.P.m[STATE_HEADING][STATE_HEADING] = std::pow(m_parameters.initialHeadingError * DEG2RAD, 2);
+            f.time = s.timestamp;
+        }
+        f.lastYaw = yaw;
+        f.lastYawTime = s.timestamp;
+        f.haveYaw = true;
+        predict(f, s.timestamp);
+
+        // A yaw referenced to north also measures the heading
+        if(m_parameters.absoluteYaw)
+        {
+            Matrix<1, STATE_SIZE> H;
+            H.m[0][STATE_HEADING] = 1.0;
+            Matrix<1, 1> y(wrap(yaw - f.x.m[STATE_HEADING][0]));
+            Matrix<1, 1> R(std::pow(m_parameters.headingNoise * DEG2RAD, 2));
+            correct(f, y, H, R);
+        }
+    }
+
+    // The odometer measures speed over the interval since the last frame, except across a reset
+    // or anything else the vehicle couldn't have driven in one frame
+    else if(s.type == SAMPLE_ODOMETER)
+    {
+        predict(f, s.timestamp);
+        double step = (s.a - f.lastOdometer) * m_parameters.metersPerUnit;
+        if(f.haveOdometer && s.timestamp > f.lastOdometerTime && s.a != 0.0 && std::fabs(step) <= ODOMETER_MAXIMUM_STEP)
+        {
+            Matrix<1, STATE_SIZE> H;
+            H.m[0][STATE_SPEED] = 1.0;
+            double speed = step / (s.timestamp - f.lastOdometerTime);
+            Matrix<1, 1> y(speed - f.x.m[STATE_SPEED][0]);
+            Matrix<1, 1> R(m_parameters.speedNoise * m_parameters.speedNoise);
+            correct(f, y, H, R);
+        }
+        f.lastOdometer = s.a;
+        f.lastOdometerTime = s.timestamp;
+        f.haveOdometer = true;
+    }
+
+    // A fix measures position
+    else if(s.type == SAMPLE_POSITION)
+    {
+        // Measurement noise is the worse of the configured noise and the reported error
+        double noise = std::max(m_parameters.gpsNoise, s.c);
+
+        // The first fix initializes the position
+        if(!f.initialized)
+        {
+            f.x.m[STATE_X][0] = s.a;
+            f.x.m[STATE_Y][0] = s.b;
+            f.P.m[STATE_X][STATE_X] = f.P.m[STATE_Y][STATE_Y] = noise * noise;
+            f.P.m[STATE_SPEED][STATE_SPEED] = 1.0;
+            f.P.m[STATE_BIAS][STATE_BIAS] = std::pow(1.0 * DEG2RAD, 2);
+            if(!f.haveYaw)
+                f.P.m[STATE_HEADING][STATE_HEADING] = M_PI * M_PI;
+            f.initialized = true;
+            f.time = std::max(f.time, s.timestamp);
+            return;
+        }
+
+        // Otherwise correct with it
+        predict(f, s.timestamp);
+        Matrix<2, STATE_SIZE> H;
+        H.m[0][STATE_X] = 1.0;
+        H.m[1][STATE_Y] = 1.0;
+        Matrix<2, 1> y;
+        y.m[0][0] = s.a - f.x.m[STATE_X][0];
+        y.m[1][0] = s.b - f.x.m[STATE_Y][0];
+        Matrix<2, 2> R;
+        R.m[0][0] = R.m[1][1] = noise * noise;
+        correct(f, y, H, R);
+    }
+}
+
+// Access the history by age (0 is the oldest)
+FusionFilter::entry& FusionFilter::history(unsigned int index)
+{
+    return m_history[(m_head + index) % FUSION_HISTORY];
+}
+
+// Apply a sample in timestamp order (call with the lock held)
+void FusionFilter::process(const sample& s)
+{
+    // Find where the sample belongs, usually at the end
+    unsigned int position = m_count;
+    while(position > 0 && history(position - 1).s.timestamp > s.timestamp)
+        position--;
+
+    // Its older than the history goes back, we can't rewind that far
+    if(position == 0 && s.timestamp < m_baseTime)
+    {
+        m_dropped++;
+        return;
+    }
+
+    // Make room for the sample, retiring the oldest entry if the history is full
+    if(m_count == FUSION_HISTORY)
+    {
+        if(position == 0)
+        {
+            m_dropped++;
+            return;
+        }
+        m_base = history(0).f;
+        m_baseTime = history(0).s.timestamp;
+        m_head = (m_head + 1) % FUSION_HISTORY;
+        m_count--;
+        position--;
+    }
+    for(unsigned int i = m_count; i > position; i--)
+        history(i) = history(i - 1);
+    m_count++;
+
+    // Resume from the entry before the sample and apply it
+    snapshot f = (position > 0) ? history(position - 1).f : m_base;
+    apply(f, s);
+    history(position).s = s;
+    history(position).f = f;
+
+    // Replay everything after it
+    for(unsigned int i = position + 1; i < m_count; i++)
+    {
+        apply(f, history(i).s);
+        history(i).f = f;
+    }
+    m_current = f;
+}
+
+// Apply a sample and notify the callbacks
+void FusionFilter::submit(const sample& s)
+{
+    // Apply the sample
+    boost::mutex::scoped_lock lock(m_mutex);
+    process(s);
+    FusionFilter::state state = toState(m_current);
+    lock.unlock();
+
+    // Execute queued callbacks for the "estimate updated" event
+    for(std::list<FusionFilter::callback *>::iterator it = m_callbacks.begin(); it != m_callbacks.end(); ++it)
+        (*it)->fusion_event_update(state);
+}
+
+// Convert the filter to the public state structure
+FusionFilter::state FusionFilter::toState(const snapshot& f) const
+{
+    state s;
+    s.position      = LocalCoordinate(f.x.m[STATE_X][0], f.x.m[STATE_Y][0]);
+    s.heading       = f.x.m[STATE_HEADING][0] * RAD2DEG;
+    if(s.heading < 0.0) s.heading += 360.0;
+    s.speed         = f.x.m[STATE_SPEED][0];
+    s.bias          = f.x.m[STATE_BIAS][0] * RAD2DEG;
+    s.positionError = std::sqrt(f.P.m[STATE_X][STATE_X] + f.P.m[STATE_Y][STATE_Y]);
+    s.headingError  = std::sqrt(f.P.m[STATE_HEADING][STATE_HEADING]) * RAD2DEG;
+    s.timestamp     = f.time;
+    s.valid         = f.initialized;
+    return s;
+}
+
+// Obtaining data
+FusionFilter::state FusionFilter::fetchState()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return toState(m_current);
+}
+
+// The filter is ready once a fix has initialized it
+bool FusionFilter::isReady()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_current.initialized;
+}
+
+// Number of samples that arrived too late to apply
+unsigned int FusionFilter::dropped()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_dropped;
+}
+
+// Store a callback object in our callbacks list
+void FusionFilter::registerCallback(FusionFilter::callback *c)
+{
+    m_callbacks.push_back(c);
+}
+
+// Remove a stored callback object in our callbacks list
+void FusionFilter::unregisterCallback(FusionFilter::callback *c)
+{
+    m_callbacks.remove(c);
+}
+
+// Add a yaw sample (degrees)
+void FusionFilter::addYaw(double timestamp, double yaw)
+{
+    sample s = { SAMPLE_YAW, timestamp, yaw, 0.0, 0.0 };
+    submit(s);
+}
+
+// Add an odometer sample (odometer units)
+void FusionFilter::addOdometer(double timestamp, double odometer)
+{
+    sample s = { SAMPLE_ODOMETER, timestamp, odometer, 0.0, 0.0 };
+    submit(s);
+}
+
+// Add a position sample in the local frame, with its error in meters
+void FusionFilter::addPosition(double timestamp, const LocalCoordinate& position, double error)
+{
+    sample s = { SAMPLE_POSITION, timestamp, position.x, position.y, error };
+    submit(s);
+}
+
+// The motion controller updated
+void FusionFilter::motors_event_update(MotionController::state s)
+{
+    addOdometer(kybernetes::utility::monotonicTime(), s.odometer);
+}
+
+// The imu updated
+void FusionFilter::imu_event_update(IMU::state s)
+{
+    addYaw(kybernetes::utility::monotonicTime(), s.yaw);
+}
+
+// The gps updated, the fix was measured a latency before we got it
+void FusionFilter::gps_event_update(GPS::state s)
+{
+    if(!s.valid) return;
+    addPosition(kybernetes::utility::monotonicTime() - m_parameters.gpsLatency, m_frame.toLocal(s.location), s.error);
+}
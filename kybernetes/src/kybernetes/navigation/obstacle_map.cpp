@@ -0,0 +1,353 @@
+/*
+ *  obstacle_map.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/navigation/obstacle_map.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+using namespace kybernetes::math;
+using namespace kybernetes::navigation;
+
+// Spread the bits of a word out to the even bits of a double word
+static uint64_t spread(uint32_t v)
+{
+    uint64_t x = v;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x << 8))  & 0x00FF00FF00FF00FFULL;
+    x = (x | (x << 4))  & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x << 2))  & 0x3333333333333333ULL;
+    x = (x | (x << 1))  & 0x5555555555555555ULL;
+    return x;
+}
+
+// Default tuning for the truck.  A cell has to be seen occupied for a few sonar readings to count,
+// and seen clear for twice as many to be forgotten, so a person walking by fades but a wall doesn't.
+ObstacleMap::parameters ObstacleMap::defaultParameters()
+{
+    ObstacleMap::parameters p;
+    p.resolution = 0.25;
+    p.range      = 5.0;
+    p.hit        = 4;
+    p.miss       = 2;
+    p.threshold  = 20;
+    p.keepRadius = 2;
+    return p;
+}
+
+// Constructor for the object
+ObstacleMap::ObstacleMap(DeadReckoning& odometry, const LocalFrame& frame)
+    : m_odometry(odometry), m_frame(frame), m_parameters(defaultParameters())
+{
+
+}
+
+// Constructor for the object
+ObstacleMap::ObstacleMap(DeadReckoning& odometry, const LocalFrame& frame, const parameters& p)
+    : m_odometry(odometry), m_frame(frame), m_parameters(p)
+{
+
+}
+
+ObstacleMap::~ObstacleMap()
+{
+    close();
+}
+
+// Quadkey of a tile, the coordinates (offset to be unsigned) with their bits interleaved
+uint64_t ObstacleMap::quadkey(int tx, int ty)
+{
+    return spread((uint32_t) tx ^ 0x80000000u) | (spread((uint32_t) ty ^ 0x80000000u) << 1);
+}
+
+// File a tile is kept in
+std::string ObstacleMap::filename(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.tile", (unsigned long long) key);
+    return m_directory + name;
+}
+
+// Find a tile, mapping it from its file or creating it if asked to
+int8_t* ObstacleMap::fetch(int tx, int ty, bool create)
+{
+    // Already mapped
+    uint64_t key = quadkey(tx, ty);
+    std::map<uint64_t, ObstacleMap::tile>::iterator it = m_tiles.find(key);
+    if(it != m_tiles.end())
+        return it->second.cells;
+
+    // Map it from its file, created (zeroed, all unknown) if need be
+    ObstacleMap::tile t;
+    t.x = tx;
+    t.y = ty;
+    if(m_directory.size())
+    {
+        t.descriptor = ::open(filename(key).c_str(), O_RDWR | (create ? O_CREAT : 0), 0644);
+        if(t.descriptor < 0)
+            return NULL;
+        void *cells = MAP_FAILED;
+        if(ftruncate(t.descriptor, OBSTACLE_TILE_BYTES) == 0)
+            cells = mmap(NULL, OBSTACLE_TILE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, t.descriptor, 0);
+        if(cells == MAP_FAILED)
+        {
+            ::close(t.descriptor);
+            return NULL;
+        }
+        t.cells = (int8_t *) cells;
+    }
+
+    // Or make a tile in memory
+    else
+    {
+        if(!create)
+            return NULL;
+        void *cells = mmap(NULL, OBSTACLE_TILE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(cells == MAP_FAILED)
+            throw std::bad_alloc();
+        t.cells      = (int8_t *) cells;
+        t.descriptor = -1;
+    }
+    m_tiles[key] = t;
+    return t.cells;
+}
+
+// Unmap a tile, the kernel writes back what changed
+void ObstacleMap::release(std::map<uint64_t, ObstacleMap::tile>::iterator it)
+{
+    munmap(it->second.cells, OBSTACLE_TILE_BYTES);
+    if(it->second.descriptor >= 0)
+        ::close(it->second.descriptor);
+    m_tiles.erase(it);
+}
+
+// Drop the tiles far from a tile.  Tiles only in memory have nowhere to go, they stay.
+void ObstacleMap::evict(int tx, int ty)
+{
+    if(m_directory.empty())
+        return;
+    std::map<uint64_t, ObstacleMap::tile>::iterator it = m_tiles.begin();
+    while(it != m_tiles.end())
+    {
+        std::map<uint64_t, ObstacleMap::tile>::iterator current = it++;
+        if(std::max(std::abs(current->second.x - tx), std::abs(current->second.y - ty)) > m_parameters.keepRadius)
+            release(current);
+    }
+}
+
+// Keep the map in a directory
+bool ObstacleMap::open(const std::string& directory)
+{
+    close();
+
+    // Create the directory if it isn't there
+    struct stat info;
+    if(mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+        return false;
+    if(stat(directory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+        return false;
+
+    // A map remembers the origin of its frame, it is meaningless in any other
+    std::string origin = directory + "/origin";
+    std::vector<GeoCoordinate> stored;
+    if(loadCoordinateList(origin, stored))
+    {
+        if(stored.size() != 1 || std::fabs(stored[0].latitude - m_frame.origin().latitude) > 1e-9 ||
+           std::fabs(stored[0].longitude - m_frame.origin().longitude) > 1e-9)
+            return false;
+    }
+
+    // A new map, record the origin (in the format of a coordinate list)
+    else
+    {
+        std::ofstream file(origin.c_str());
+        file << std::setprecision(12) << m_frame.origin().latitude << " " << m_frame.origin().longitude << std::endl;
+        if(!file.good())
+            return false;
+    }
+    m_directory = directory;
+    return true;
+}
+
+// Write out and unmap every tile
+void ObstacleMap::close()
+{
+    while(m_tiles.size())
+    {
+        if(m_tiles.begin()->second.descriptor >= 0)
+            msync(m_tiles.begin()->second.cells, OBSTACLE_TILE_BYTES, MS_SYNC);
+        release(m_tiles.begin());
+    }
+    m_directory.clear();
+}
+
+// Schedule the mapped tiles to be written out
+void ObstacleMap::flush()
+{
+    for(std::map<uint64_t, ObstacleMap::tile>::iterator it = m_tiles.begin(); it != m_tiles.end(); ++it)
+        if(it->second.descriptor >= 0)
+            msync(it->second.cells, OBSTACLE_TILE_BYTES, MS_ASYNC);
+}
+
+// Global cell coordinates of a position
+int ObstacleMap::cellX(double x) const
+{
+    return (int) std::floor(x / m_parameters.resolution);
+}
+
+int ObstacleMap::cellY(double y) const
+{
+    return (int) std::floor(y / m_parameters.resolution);
+}
+
+// Log odds of a cell
+int8_t ObstacleMap::at(int x, int y) const
+{
+    std::map<uint64_t, ObstacleMap::tile>::const_iterator it = m_tiles.find(quadkey(x >> OBSTACLE_TILE_SHIFT, y >> OBSTACLE_TILE_SHIFT));
+    if(it == m_tiles.end())
+        return 0;
+    return it->second.cells[((y & OBSTACLE_TILE_MASK) << OBSTACLE_TILE_SHIFT) | (x & OBSTACLE_TILE_MASK)];
+}
+
+// Every obstacle between two corners.  Tiles that aren't mapped are read from their files without
+// mapping them, so a whole course can be scanned without holding it in memory.
+void ObstacleMap::obstacles(const LocalCoordinate& low, const LocalCoordinate& high, std::vector<LocalCoordinate>& result) const
+{
+    int x0 = cellX(low.x), x1 = cellX(high.x);
+    int y0 = cellY(low.y), y1 = cellY(high.y);
+    int8_t buffer[OBSTACLE_TILE_BYTES];
+    for(int ty = y0 >> OBSTACLE_TILE_SHIFT; ty <= y1 >> OBSTACLE_TILE_SHIFT; ty++)
+    {
+        for(int tx = x0 >> OBSTACLE_TILE_SHIFT; tx <= x1 >> OBSTACLE_TILE_SHIFT; tx++)
+        {
+            // Find the cells of the tile, if it exists
+            uint64_t      key   = quadkey(tx, ty);
+            const int8_t *cells = NULL;
+            std::map<uint64_t, ObstacleMap::tile>::const_iterator it = m_tiles.find(key);
+            if(it != m_tiles.end())
+                cells = it->second.cells;
+            else if(m_directory.size())
+            {
+                int descriptor = ::open(filename(key).c_str(), O_RDONLY);
+                if(descriptor < 0)
+                    continue;
+                if(read(descriptor, buffer, OBSTACLE_TILE_BYTES) == OBSTACLE_TILE_BYTES)
+                    cells = buffer;
+                ::close(descriptor);
+            }
+            if(!cells)
+                continue;
+
+            // Collect the centers of the obstacles within the corners
+            for(int i = 0; i < OBSTACLE_TILE_BYTES; i++)
+            {
+                if(cells[i] <= m_parameters.threshold)
+                    continue;
+                int x = (tx << OBSTACLE_TILE_SHIFT) | (i & OBSTACLE_TILE_MASK);
+                int y = (ty << OBSTACLE_TILE_SHIFT) | (i >> OBSTACLE_TILE_SHIFT);
+                if(x >= x0 && x <= x1 && y >= y0 && y <= y1)
+                    result.push_back(LocalCoordinate((x + 0.5) * m_parameters.resolution, (y + 0.5) * m_parameters.resolution));
+            }
+        }
+    }
+}
+
+// Map information
+const ObstacleMap::parameters& ObstacleMap::configuration() const
+{
+    return m_parameters;
+}
+
+size_t ObstacleMap::mapped() const
+{
+    return m_tiles.size();
+}
+
+// The sonar grid updated, fold what it sees around the robot into the map
+void ObstacleMap::occupancy_event_update(const OccupancyGrid& grid)
+{
+    // Wait for a fix to put the robot in the frame
+    if(!m_odometry.isReady())
+        return;
+    DeadReckoning::state pose = m_odometry.fetchState();
+
+    // Only keep the tiles around the robot in memory
+    int rx = cellX(pose.position.x), ry = cellY(pose.position.y);
+    evict(rx >> OBSTACLE_TILE_SHIFT, ry >> OBSTACLE_TILE_SHIFT);
+
+    // The sonar grid's frame lines up with ours through where the two estimates put the robot now
+    double offsetX   = pose.position.x - grid.position().x;
+    double offsetY   = pose.position.y - grid.position().y;
+    int    radius    = (int) std::ceil(m_parameters.range / m_parameters.resolution);
+    int    threshold = grid.configuration().threshold;
+    double step      = m_parameters.resolution;
+
+    // Visit the cells in range, a row at a time so the tile seldom changes
+    int     lastX = 0, lastY = 0;
+    int8_t *cells = NULL;
+    for(int y = ry - radius; y <= ry + radius; y++)
+    {
+        for(int x = rx - radius; x <= rx + radius; x++)
+        {
+            // The sonar cells under this one
+            double left   = x * step - offsetX;
+            double bottom = y * step - offsetY;
+            int    gx0 = grid.cellX(left),   gx1 = std::max(gx0 + 1, grid.cellX(left + step));
+            int    gy0 = grid.cellY(bottom), gy1 = std::max(gy0 + 1, grid.cellY(bottom + step));
+            bool   occupied = false, seen = false;
+            for(int gy = gy0; gy < gy1 && !occupied; gy++)
+            {
+                for(int gx = gx0; gx < gx1 && !occupied; gx++)
+                {
+                    int v = grid.at(gx, gy);
+                    occupied = v > threshold;
+                    seen     = seen || v < 0;
+                }
+            }
+            if(!occupied && !seen)
+                continue;
+
+            // Find the tile, making one if this is the first thing seen in it
+            if(!cells || (x >> OBSTACLE_TILE_SHIFT) != lastX || (y >> OBSTACLE_TILE_SHIFT) != lastY)
+            {
+                lastX = x >> OBSTACLE_TILE_SHIFT;
+                lastY = y >> OBSTACLE_TILE_SHIFT;
+                cells = fetch(lastX, lastY, true);
+                if(!cells)
+                    continue;
+            }
+
+            // Move the cell's log odds toward what was seen
+            int8_t& cell = cells[((y & OBSTACLE_TILE_MASK) << OBSTACLE_TILE_SHIFT) | (x & OBSTACLE_TILE_MASK)];
+            cell = (int8_t) std::max(-OCCUPANCY_LIMIT, std::min(OCCUPANCY_LIMIT, cell + (occupied ? m_parameters.hit : -m_parameters.miss)));
+        }
+    }
+}
@@ -0,0 +1,324 @@
+/*
+ *  occupancy_grid.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/navigation/occupancy_grid.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <new>
+
+using namespace kybernetes::controller;
+using namespace kybernetes::math;
+using namespace kybernetes::navigation;
+
+// Default geometry for the sonar ring.  The beam width is the MaxSonar's at a meter or so, and
+// a return has to be seen twice before a cell counts as an obstacle.
+OccupancyGrid::parameters OccupancyGrid::defaultParameters()
+{
+    OccupancyGrid::parameters p;
+    p.resolution     = 0.1;
+    p.mountAngles[0] = -60.0;
+    p.mountAngles[1] = -30.0;
+    p.mountAngles[2] =   0.0;
+    p.mountAngles[3] =  30.0;
+    p.mountAngles[4] =  60.0;
+    p.beamWidth      = 30.0;
+    p.rays           = 3;
+    p.minimumRange   = 0.15;
+    p.maximumRange   = 5.0;
+    p.hit            = 30;
+    p.miss           = -6;
+    p.decayRate      = 20.0;
+    p.threshold      = 40;
+    return p;
+}
+
+// Constructor for the object
+OccupancyGrid::OccupancyGrid(DeadReckoning& odometry)
+    : m_odometry(odometry), m_parameters(defaultParameters())
+{
+    // Allocate the cells on a cache line
+    void *cells = NULL;
+    if(posix_memalign(&cells, 64, OCCUPANCY_GRID_SIZE * OCCUPANCY_GRID_SIZE) != 0)
+        throw std::bad_alloc();
+    m_cells = (int8_t *) cells;
+    clear();
+}
+
+// Constructor for the object
+OccupancyGrid::OccupancyGrid(DeadReckoning& odometry, const parameters& p)
+    : m_odometry(odometry), m_parameters(p)
+{
+    // Allocate the cells on a cache line
+    void *cells = NULL;
+    if(posix_memalign(&cells, 64, OCCUPANCY_GRID_SIZE * OCCUPANCY_GRID_SIZE) != 0)
+        throw std::bad_alloc();
+    m_cells = (int8_t *) cells;
+    clear();
+}
+
+OccupancyGrid::~OccupancyGrid()
+{
+    free(m_cells);
+}
+
+// Store a callback object in our callbacks list
+void OccupancyGrid::registerCallback(OccupancyGrid::callback *c)
+{
+    m_callbacks.push_back(c);
+}
+
+// Remove a stored callback object in our callbacks list
+void OccupancyGrid::unregisterCallback(OccupancyGrid::callback *c)
+{
+    m_callbacks.remove(c);
+}
+
+// Forget everything and center on the origin
+void OccupancyGrid::clear()
+{
+    std::memset(m_cells, 0, OCCUPANCY_GRID_SIZE * OCCUPANCY_GRID_SIZE);
+    m_originX      = -OCCUPANCY_GRID_SIZE / 2;
+    m_originY      = -OCCUPANCY_GRID_SIZE / 2;
+    m_position     = LocalCoordinate();
+    m_heading      = 0.0;
+    m_lastUpdate   = 0.0;
+    m_pendingDecay = 0.0;
+}
+
+// Clear the row of the window a global row wraps onto (one contiguous run of cells)
+void OccupancyGrid::clearRow(int y)
+{
+    std::memset(m_cells + ((y & OCCUPANCY_GRID_MASK) << OCCUPANCY_GRID_SHIFT), 0, OCCUPANCY_GRID_SIZE);
+}
+
+// Clear the column of the window a global column wraps onto
+void OccupancyGrid::clearColumn(int x)
+{
+    int8_t *cell = m_cells + (x & OCCUPANCY_GRID_MASK);
+    for(unsigned int i = 0; i < OCCUPANCY_GRID_SIZE; i++, cell += OCCUPANCY_GRID_SIZE)
+        *cell = 0;
+}
+
+// Move the window to center on a position.  The cells that stay in view don't move, only
+// the rows and columns scrolling in (which reuse the storage of those scrolling out) are cleared.
+void OccupancyGrid::recenter(const LocalCoordinate& position)
+{
+    int originX = cellX(position.x) - OCCUPANCY_GRID_SIZE / 2;
+    int originY = cellY(position.y) - OCCUPANCY_GRID_SIZE / 2;
+
+    // Moved out of view entirely
+    if(std::abs(originX - m_originX) >= OCCUPANCY_GRID_SIZE || std::abs(originY - m_originY) >= OCCUPANCY_GRID_SIZE)
+    {
+        std::memset(m_cells, 0, OCCUPANCY_GRID_SIZE * OCCUPANCY_GRID_SIZE);
+        m_originX = originX;
+        m_originY = originY;
+        return;
+    }
+
+    // Clear the columns scrolling in
+    for(int x = m_originX + OCCUPANCY_GRID_SIZE; x < originX + OCCUPANCY_GRID_SIZE; x++)
+        clearColumn(x);
+    for(int x = originX; x < m_originX; x++)
+        clearColumn(x);
+    m_originX = originX;
+
+    // Clear the rows scrolling in
+    for(int y = m_originY + OCCUPANCY_GRID_SIZE; y < originY + OCCUPANCY_GRID_SIZE; y++)
+        clearRow(y);
+    for(int y = originY; y < m_originY; y++)
+        clearRow(y);
+    m_originY = originY;
+}
+
+// Add log odds to a cell in the window, saturating at the limit
+void OccupancyGrid::adjust(int x, int y, int amount)
+{
+    if((unsigned int) (x - m_originX) >= OCCUPANCY_GRID_SIZE || (unsigned int) (y - m_originY) >= OCCUPANCY_GRID_SIZE)
+        return;
+    int8_t& cell = m_cells[((y & OCCUPANCY_GRID_MASK) << OCCUPANCY_GRID_SHIFT) | (x & OCCUPANCY_GRID_MASK)];
+    cell = (int8_t) std::max(-OCCUPANCY_LIMIT, std::min(OCCUPANCY_LIMIT, cell + amount));
+}
+
+// Clear the cells along a ray (compass angle in radians) short of a range
+void OccupancyGrid::trace(const LocalCoordinate& from, double angle, double range)
+{
+    // Step half a cell at a time, each cell is visited once
+    double step = m_parameters.resolution * 0.5;
+    double dx   = std::sin(angle) * step;
+    double dy   = std::cos(angle) * step;
+    int    lastX = cellX(from.x) + 1, lastY = cellY(from.y);
+    double end  = range - m_parameters.resolution;
+    double x = from.x, y = from.y;
+    for(double t = 0.0; t < end; t += step, x += dx, y += dy)
+    {
+        int cx = cellX(x), cy = cellY(y);
+        if(cx == lastX && cy == lastY)
+            continue;
+        adjust(cx, cy, m_parameters.miss);
+        lastX = cx;
+        lastY = cy;
+    }
+}
+
+// Mark the arc of a beam (compass angle and width in radians) at a range
+void OccupancyGrid::mark(const LocalCoordinate& from, double angle, double width, double range)
+{
+    // Enough points along the arc that neighbors are within a cell of each other
+    unsigned int points = (unsigned int) std::ceil(range * width / m_parameters.resolution) + 1;
+    int lastX = cellX(from.x) + 1, lastY = cellY(from.y);
+    for(unsigned int i = 0; i < points; i++)
+    {
+        double a  = angle - width * 0.5 + (points > 1 ? width * i / (points - 1) : width * 0.5);
+        int    cx = cellX(from.x + std::sin(a) * range);
+        int    cy = cellY(from.y + std::cos(a) * range);
+        if(cx == lastX && cy == lastY)
+            continue;
+        adjust(cx, cy, m_parameters.hit);
+        lastX = cx;
+        lastY = cy;
+    }
+}
+
+// Apply a sonar reading taken at a pose
+void OccupancyGrid::insert(const LocalCoordinate& position, double heading, const SensorController::state& s)
+{
+    m_position = position;
+    m_heading  = heading;
+
+    // Project each sonar along its mounting angle
+    double width = m_parameters.beamWidth * (M_PI / 180.0);
+    for(unsigned int i = 0; i < 5; i++)
+    {
+        // A sonar which didn't read says nothing about the space (as for the reflex)
+        if(s.sonars[i] == 0)
+            continue;
+
+        // The sonars read their minimum for anything closer, and past the maximum they only tell us
+        // the space is clear
+        double range = s.sonars[i] * SONAR_METERS_PER_UNIT;
+        bool   hit   = range < m_parameters.maximumRange;
+        range = std::max(m_parameters.minimumRange, std::min(m_parameters.maximumRange, range));
+
+        // Clear the space in front of the return, then mark the return
+        double angle = (heading + m_parameters.mountAngles[i]) * (M_PI / 180.0);
+        for(unsigned int j = 0; j < m_parameters.rays; j++)
+            trace(position, angle - width * 0.5 + (m_parameters.rays > 1 ? width * j / (m_parameters.rays - 1) : width * 0.5), range);
+        if(hit)
+            mark(position, angle, width, range);
+    }
+}
+
+// Move every cell toward unknown.  This is written as a straight min/max over the block in
+// 8 bit arithmetic so it compiles to vector code (16 cells per instruction with NEON).  Passes
+// are limited to the headroom above the log odds limit so the arithmetic can't overflow, and the
+// cells are read through a local pointer, through the member the compiler has to assume a store
+// to a cell could change it.
+void OccupancyGrid::decay(int amount)
+{
+    int8_t *cells = m_cells;
+    while(amount > 0)
+    {
+        int8_t step = (int8_t) std::min(amount, 127 - OCCUPANCY_LIMIT);
+        for(unsigned int i = 0; i < OCCUPANCY_GRID_SIZE * OCCUPANCY_GRID_SIZE; i++)
+        {
+            int8_t cell = cells[i];
+            int8_t up   = cell + step;
+            int8_t down = cell - step;
+            cells[i] = std::max(down, std::min(up, (int8_t) 0));
+        }
+        amount -= step;
+    }
+}
+
+// Global cell coordinates of a position
+int OccupancyGrid::cellX(double x) const
+{
+    return (int) std::floor(x / m_parameters.resolution);
+}
+
+int OccupancyGrid::cellY(double y) const
+{
+    return (int) std::floor(y / m_parameters.resolution);
+}
+
+// Log odds at a position
+int8_t OccupancyGrid::at(const LocalCoordinate& position) const
+{
+    return at(cellX(position.x), cellY(position.y));
+}
+
+// Is there an obstacle at a position
+bool OccupancyGrid::occupied(const LocalCoordinate& position) const
+{
+    return at(position) > m_parameters.threshold;
+}
+
+// Grid information
+const OccupancyGrid::parameters& OccupancyGrid::configuration() const
+{
+    return m_parameters;
+}
+
+const LocalCoordinate& OccupancyGrid::position() const
+{
+    return m_position;
+}
+
+double OccupancyGrid::heading() const
+{
+    return m_heading;
+}
+
+int OccupancyGrid::originX() const
+{
+    return m_originX;
+}
+
+int OccupancyGrid::originY() const
+{
+    return m_originY;
+}
+
+// A sonar reading arrived, apply it at the current pose
+void OccupancyGrid::sensors_event_update(SensorController::state s)
+{
+    // Follow the robot and apply the reading
+    DeadReckoning::state pose = m_odometry.fetchState();
+    recenter(pose.position);
+    insert(pose.position, pose.heading, s);
+
+    // Decay by however much time has passed
+    double now = kybernetes::utility::monotonicTime();
+    if(m_lastUpdate > 0.0)
+        m_pendingDecay += (now - m_lastUpdate) * m_parameters.decayRate;
+    m_lastUpdate = now;
+    if(m_pendingDecay >= 1.0)
+    {
+        decay((int) m_pendingDecay);
+        m_pendingDecay -= (int) m_pendingDecay;
+    }
+
+    // Execute queued callbacks for the "grid updated" event
+    for(std::list<OccupancyGrid::callback *>::iterator it = m_callbacks.begin(); it != m_callbacks.end(); ++it)
+        (*it)->occupancy_event_update(*this);
+}
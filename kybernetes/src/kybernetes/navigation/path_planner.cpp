@@ -0,0 +1,336 @@
+/*
+ *  path_planner.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/navigation/path_planner.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+using namespace kybernetes::math;
+using namespace kybernetes::navigation;
+
+// States of a cell in the obstacle map
+static const unsigned char FREE     = 0;
+static const unsigned char OCCUPIED = 1;
+
+// Corner of the box around a route, grown by a margin
+static LocalCoordinate lowerCorner(const Route& route, double margin)
+{
+    LocalCoordinate corner;
+    for(size_t i = 0; i < route.size(); i++)
+    {
+        corner.x = (i == 0) ? route.waypoint(i).x : std::min(corner.x, route.waypoint(i).x);
+        corner.y = (i == 0) ? route.waypoint(i).y : std::min(corner.y, route.waypoint(i).y);
+    }
+    return LocalCoordinate(corner.x - margin, corner.y - margin);
+}
+
+// Length of a run of cells (in cells)
+static double length(const std::vector<DStarLite::cell>& path, size_t from)
+{
+    double l = 0.0;
+    for(size_t i = from; i + 1 < path.size(); i++)
+        l += (path[i].x != path[i+1].x && path[i].y != path[i+1].y) ? M_SQRT2 : 1.0;
+    return l;
+}
+
+// Cells across the box around a route along an axis
+static int span(const Route& route, const PathPlanner::parameters& p, bool vertical)
+{
+    double low = 0.0, high = 0.0;
+    for(size_t i = 0; i < route.size(); i++)
+    {
+        double v = vertical ? route.waypoint(i).y : route.waypoint(i).x;
+        low  = (i == 0) ? v : std::min(low, v);
+        high = (i == 0) ? v : std::max(high, v);
+    }
+    return (int) std::ceil((high - low + 2.0 * p.margin) / p.resolution) + 1;
+}
+
+// Default tuning for the truck.  Half meter cells leave a gap of three free cells (a meter and a
+// half) as the narrowest the truck will be planned through.
+PathPlanner::parameters PathPlanner::defaultParameters()
+{
+    PathPlanner::parameters p;
+    p.resolution    = 0.5;
+    p.margin        = 20.0;
+    p.robotRadius   = 0.35;
+    p.range         = 5.0;
+    p.arrivalRadius = 4.0;
+    p.hysteresis    = 0.25;
+    return p;
+}
+
+// Constructor for the object
+PathPlanner::PathPlanner(const Route& route, DeadReckoning& odometry)
+    : m_route(route), m_odometry(odometry), m_parameters(defaultParameters()),
+      m_planner(span(route, m_parameters, false), span(route, m_parameters, true))
+{
+    layout();
+}
+
+// Constructor for the object
+PathPlanner::PathPlanner(const Route& route, DeadReckoning& odometry, const parameters& p)
+    : m_route(route), m_odometry(odometry), m_parameters(p),
+      m_planner(span(route, p, false), span(route, p, true))
+{
+    layout();
+}
+
+// Lay out the grid over the route, nothing is known to be in the way
+void PathPlanner::layout()
+{
+    m_corner    = lowerCorner(m_route, m_parameters.margin);
+    m_obstacles.assign(m_planner.width() * m_planner.height(), FREE);
+    m_inflation = (int) std::ceil(m_parameters.robotRadius / m_parameters.resolution);
+    m_waypoint  = 0;
+    m_goal      = m_route.size();
+    m_robot.x   = -1;
+    m_robot.y   = -1;
+    m_reachable = false;
+    m_finished  = false;
+    m_path.clear();
+}
+
+// Store a callback object in our callbacks list
+void PathPlanner::registerCallback(PathPlanner::callback *c)
+{
+    m_callbacks.push_back(c);
+}
+
+// Remove a stored callback object in our callbacks list
+void PathPlanner::unregisterCallback(PathPlanner::callback *c)
+{
+    m_callbacks.remove(c);
+}
+
+// Waypoint being planned to
+size_t PathPlanner::waypoint() const
+{
+    return m_waypoint;
+}
+
+// Mark the obstacles a map remembers
+unsigned int PathPlanner::seed(const ObstacleMap& map)
+{
+    // Fetch the obstacles over the planning grid
+    std::vector<LocalCoordinate> points;
+    LocalCoordinate far(m_corner.x + m_planner.width() * m_parameters.resolution, m_corner.y + m_planner.height() * m_parameters.resolution);
+    map.obstacles(m_corner, far, points);
+
+    // Mark their cells, and block the cells around them
+    unsigned int marked = 0;
+    for(std::vector<LocalCoordinate>::iterator it = points.begin(); it != points.end(); ++it)
+    {
+        DStarLite::cell c = cellOf(*it);
+        if(c.x < 0 || c.y < 0 || c.x >= m_planner.width() || c.y >= m_planner.height())
+            continue;
+        unsigned char& cell = m_obstacles[c.y * m_planner.width() + c.x];
+        if(cell == OCCUPIED)
+            continue;
+        cell = OCCUPIED;
+        refresh(c.x, c.y, m_inflation);
+        marked++;
+    }
+    return marked;
+}
+
+// Cell of a position in the planning grid
+DStarLite::cell PathPlanner::cellOf(const LocalCoordinate& position) const
+{
+    DStarLite::cell c;
+    c.x = (int) std::floor((position.x - m_corner.x) / m_parameters.resolution);
+    c.y = (int) std::floor((position.y - m_corner.y) / m_parameters.resolution);
+    return c;
+}
+
+// A cell is blocked if an obstacle is within the robot's radius of it.  The robot's own cell never
+// is, brushing past something must not leave it with nowhere to start from.
+void PathPlanner::refresh(int x, int y, int radius)
+{
+    int width = m_planner.width(), height = m_planner.height();
+    for(int cy = std::max(0, y - radius); cy <= std::min(height - 1, y + radius); cy++)
+    {
+        for(int cx = std::max(0, x - radius); cx <= std::min(width - 1, x + radius); cx++)
+        {
+            bool blocked = false;
+            for(int oy = std::max(0, cy - m_inflation); oy <= std::min(height - 1, cy + m_inflation) && !blocked; oy++)
+                for(int ox = std::max(0, cx - m_inflation); ox <= std::min(width - 1, cx + m_inflation) && !blocked; ox++)
+                    blocked = m_obstacles[oy * width + ox] == OCCUPIED;
+            m_planner.setBlocked(cx, cy, blocked && !(cx == m_robot.x && cy == m_robot.y));
+        }
+    }
+}
+
+// Copy the obstacles around the robot out of the sonar grid.  A planning cell is occupied if any
+// sonar cell in it is, free if none are and some have been seen clear, and otherwise (never seen,
+// or forgotten by the sonar grid) left as it was.
+bool PathPlanner::transfer(const OccupancyGrid& grid, const LocalCoordinate& offset)
+{
+    int    radius    = (int) std::ceil(m_parameters.range / m_parameters.resolution);
+    int    width     = m_planner.width(), height = m_planner.height();
+    int    threshold = grid.configuration().threshold;
+    double step      = m_parameters.resolution;
+    bool   changed   = false;
+    for(int y = std::max(0, m_robot.y - radius); y <= std::min(height - 1, m_robot.y + radius); y++)
+    {
+        for(int x = std::max(0, m_robot.x - radius); x <= std::min(width - 1, m_robot.x + radius); x++)
+        {
+            // The sonar cells under this one, the grids line up in the sonar grid's frame
+            double left   = m_corner.x + x * step - offset.x;
+            double bottom = m_corner.y + y * step - offset.y;
+            int    gx0 = grid.cellX(left),   gx1 = grid.cellX(left + step);
+            int    gy0 = grid.cellY(bottom), gy1 = grid.cellY(bottom + step);
+            bool   occupied = false, seen = false;
+            for(int gy = gy0; gy < gy1 && !occupied; gy++)
+            {
+                for(int gx = gx0; gx < gx1 && !occupied; gx++)
+                {
+                    int v = grid.at(gx, gy);
+                    occupied = v > threshold;
+                    seen     = seen || v < 0;
+                }
+            }
+
+            // Update the obstacle map, and the blocked cells around any change
+            unsigned char& cell = m_obstacles[y * width + x];
+            unsigned char  now  = occupied ? OCCUPIED : (seen ? FREE : cell);
+            if(now != cell)
+            {
+                cell = now;
+                refresh(x, y, m_inflation);
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+// The path being followed is kept if the robot is still on it, nothing has been found in its way,
+// and it isn't much longer than the best path
+bool PathPlanner::keep(const std::vector<DStarLite::cell>& path) const
+{
+    // Find where the robot is along it
+    size_t here = m_path.size();
+    int    best = 3;
+    for(size_t i = 0; i < m_path.size(); i++)
+    {
+        int d = std::max(std::abs(m_path[i].x - m_robot.x), std::abs(m_path[i].y - m_robot.y));
+        if(d < best)
+        {
+            best = d;
+            here = i;
+        }
+    }
+    if(here == m_path.size())
+        return false;
+
+    // Check the rest of it is clear
+    for(size_t i = here + 1; i < m_path.size(); i++)
+        if(m_planner.isBlocked(m_path[i].x, m_path[i].y))
+            return false;
+    return length(m_path, here) <= length(path, 0) * (1.0 + m_parameters.hysteresis);
+}
+
+// Send the path to the listeners, straight runs of cells become single segments
+void PathPlanner::publish(const std::vector<DStarLite::cell>& cells)
+{
+    m_path = cells;
+
+    // Keep the cells where the path turns, the last point is the waypoint itself
+    std::vector<GeoCoordinate> points;
+    for(size_t i = 0; i + 1 < cells.size(); i++)
+    {
+        if(i > 0 && cells[i].x - cells[i-1].x == cells[i+1].x - cells[i].x && cells[i].y - cells[i-1].y == cells[i+1].y - cells[i].y)
+            continue;
+        LocalCoordinate center(m_corner.x + (cells[i].x + 0.5) * m_parameters.resolution, m_corner.y + (cells[i].y + 0.5) * m_parameters.resolution);
+        points.push_back(m_route.frame().toGeo(center));
+    }
+    points.push_back(m_route.frame().toGeo(m_route.waypoint(m_waypoint)));
+
+    // Execute queued callbacks for the "path updated" event
+    Route path(points, m_route.frame());
+    for(std::list<PathPlanner::callback *>::iterator it = m_callbacks.begin(); it != m_callbacks.end(); ++it)
+        (*it)->path_event_update(path, m_waypoint);
+}
+
+// The sonar grid updated, replan if the way ahead changed
+void PathPlanner::occupancy_event_update(const OccupancyGrid& grid)
+{
+    // Wait for a fix to put the robot on the route
+    if(m_finished || !m_odometry.isReady())
+        return;
+    DeadReckoning::state pose = m_odometry.fetchState();
+
+    // Move on from the waypoints we have reached
+    while(m_waypoint < m_route.size() && pose.position.distanceTo(m_route.waypoint(m_waypoint)) < m_parameters.arrivalRadius)
+        m_waypoint++;
+    if(m_waypoint >= m_route.size())
+    {
+        m_finished = true;
+        for(std::list<PathPlanner::callback *>::iterator it = m_callbacks.begin(); it != m_callbacks.end(); ++it)
+            (*it)->path_event_finished();
+        return;
+    }
+
+    // A new waypoint roots a new search
+    bool replan = !m_reachable;
+    if(m_goal != m_waypoint)
+    {
+        DStarLite::cell goal = cellOf(m_route.waypoint(m_waypoint));
+        m_planner.setGoal(goal.x, goal.y);
+        m_goal = m_waypoint;
+        m_path.clear();
+        replan = true;
+    }
+
+    // Follow the robot, its old cell may go back to being blocked
+    DStarLite::cell robot = cellOf(pose.position);
+    if(robot.x != m_robot.x || robot.y != m_robot.y)
+    {
+        DStarLite::cell last = m_robot;
+        m_robot = robot;
+        refresh(last.x, last.y, 0);
+        refresh(robot.x, robot.y, 0);
+        m_planner.setStart(robot.x, robot.y);
+    }
+
+    // Bring in the obstacles in view, lining the sonar grid's frame up with the route's through
+    // where the two estimates put the robot now
+    LocalCoordinate offset(pose.position.x - grid.position().x, pose.position.y - grid.position().y);
+    replan = transfer(grid, offset) || replan;
+
+    // The path only needs repairing if something changed in the way
+    if(!replan)
+        return;
+    std::vector<DStarLite::cell> path;
+    m_reachable = m_planner.plan() && m_planner.path(path);
+    if(m_reachable)
+    {
+        if(!keep(path))
+            publish(path);
+    }
+    else
+    {
+        m_path.clear();
+        for(std::list<PathPlanner::callback *>::iterator it = m_callbacks.begin(); it != m_callbacks.end(); ++it)
+            (*it)->path_event_blocked(m_waypoint);
+    }
+}
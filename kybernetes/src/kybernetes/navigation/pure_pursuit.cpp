@@ -0,0 +1,125 @@
+/*
+ *  pure_pursuit.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/navigation/pure_pursuit.hpp>
+#include <kybernetes/math/fast_math.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace kybernetes::math;
+using namespace kybernetes::navigation;
+
+// Default tuning for the truck.  The geometry and the drift scale want measuring on the vehicle;
+// 20 drift per degree puts the old +/-500 drift limit at the 25 degree steering stops.
+PurePursuit::parameters PurePursuit::defaultParameters()
+{
+    PurePursuit::parameters p;
+    p.wheelbase        = 0.5;
+    p.minimumLookahead = 2.0;
+    p.maximumLookahead = 8.0;
+    p.lookaheadTime    = 1.0;
+    p.maximumSteering  = 25.0;
+    p.driftPerDegree   = 20.0;
+    p.arrivalRadius    = 4.0;
+    p.searchBehind     = 5.0;
+    p.searchAhead      = 20.0;
+    return p;
+}
+
+// Constructor for the object
+PurePursuit::PurePursuit(const Route& route)
+    : m_route(route), m_parameters(defaultParameters()), m_tracking(false)
+{
+}
+
+// Constructor for the object
+PurePursuit::PurePursuit(const Route& route, const parameters& p)
+    : m_route(route), m_parameters(p), m_tracking(false)
+{
+}
+
+// Forget the last position
+void PurePursuit::reset()
+{
+    m_tracking = false;
+}
+
+// Compute the steering for a pose
+PurePursuit::command PurePursuit::steer(const LocalCoordinate& position, double heading, double speed)
+{
+    PurePursuit::command c;
+    c.curvature = 0.0;
+    c.steering  = 0.0;
+    c.drift     = 0;
+
+    // Nothing to follow
+    if(m_route.size() == 0)
+    {
+        c.lookahead = 0.0;
+        c.remaining = 0.0;
+        c.finished  = true;
+        return c;
+    }
+
+    // Find ourself on the route, only near the furthest position reached once we are tracking it
+    if(m_tracking)
+        c.progress = m_route.locate(position, m_progress, m_parameters.searchBehind, m_parameters.searchAhead);
+    else
+        c.progress = m_route.locate(position);
+
+    // The lookahead point only moves forward.  Circling a hairpin, the projection swings back
+    // and forth on the leg in and the target would swing with it, leaving us in orbit.
+    if(!m_tracking || c.progress.along > m_progress.along)
+        m_progress = c.progress;
+    m_tracking = true;
+
+    // Check for the end of the route
+    c.remaining = m_route.length() - m_progress.along;
+    c.finished  = c.remaining <= m_parameters.arrivalRadius &&
+                  position.distanceTo(m_route.waypoint(m_route.size() - 1)) <= m_parameters.arrivalRadius;
+
+    // Pick the target point, further ahead the faster we are moving
+    c.lookahead = std::max(m_parameters.minimumLookahead, std::min(m_parameters.maximumLookahead, std::fabs(speed) * m_parameters.lookaheadTime));
+    c.target    = m_route.lookahead(m_progress, c.lookahead);
+
+    // Express the target in the vehicle frame (forward along the heading, lateral to the right)
+    float  h       = (float) (heading * (M_PI / 180.0));
+    float  sh      = fastSin(h);
+    float  ch      = fastCos(h);
+    double dx      = c.target.x - position.x;
+    double dy      = c.target.y - position.y;
+    double forward = dx * sh + dy * ch;
+    double lateral = dx * ch - dy * sh;
+    double d2      = dx * dx + dy * dy;
+
+    // Curvature of the arc through the target tangent to the heading, and the wheel angle for it
+    if(d2 > 1e-6)
+        c.curvature = 2.0 * lateral / d2;
+    c.steering = fastAtan2((float) (m_parameters.wheelbase * c.curvature), 1.0f) * (180.0 / M_PI);
+
+    // A target behind us (the end of the route, or a bad estimate) gets full lock toward it
+    if(forward < 0.0)
+        c.steering = (lateral < 0.0) ? -m_parameters.maximumSteering : m_parameters.maximumSteering;
+
+    // Clamp to the steering stops and convert to drift
+    c.steering = std::max(-m_parameters.maximumSteering, std::min(m_parameters.maximumSteering, c.steering));
+    c.drift    = (short) -(c.steering * m_parameters.driftPerDegree);
+    return c;
+}
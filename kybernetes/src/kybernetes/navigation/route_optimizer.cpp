@@ -0,0 +1,254 @@
+/*
+ *  route_optimizer.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/navigation/route_optimizer.hpp>
+
+#include <algorithm>
+#include <limits>
+
+using namespace kybernetes::math;
+using namespace kybernetes::navigation;
+
+// Constructor for the object
+RouteOptimizer::RouteOptimizer(const std::vector<LocalCoordinate>& waypoints)
+    : m_size(waypoints.size()), m_distances(waypoints.size() * waypoints.size())
+{
+    // Build the distance matrix
+    for(size_t a = 0; a < m_size; a++)
+        for(size_t b = 0; b < m_size; b++)
+            m_distances[a * m_size + b] = waypoints[a].distanceTo(waypoints[b]);
+}
+
+// Distance between two waypoints
+double RouteOptimizer::distance(size_t a, size_t b) const
+{
+    return m_distances[a * m_size + b];
+}
+
+// Length of a route
+double RouteOptimizer::length(const std::vector<size_t>& order) const
+{
+    double total = 0.0;
+    for(size_t i = 1; i < order.size(); i++)
+        total += distance(order[i-1], order[i]);
+    return total;
+}
+
+// Whether solve gives the exact order
+bool RouteOptimizer::isExact() const
+{
+    return m_size <= ROUTE_OPTIMIZER_EXACT_LIMIT;
+}
+
+// Shortest order to visit the waypoints in
+std::vector<size_t> RouteOptimizer::solve(bool fixedEnd) const
+{
+    // Nothing to reorder
+    if(m_size < 3 || (fixedEnd && m_size < 4))
+    {
+        std::vector<size_t> order(m_size);
+        for(size_t i = 0; i < m_size; i++)
+            order[i] = i;
+        return order;
+    }
+
+    // Small courses are solved exactly
+    if(isExact())
+        return exact(fixedEnd);
+
+    // Otherwise improve a greedy route until it stops getting shorter
+    std::vector<size_t> order;
+    nearestNeighbor(order, fixedEnd);
+    while(twoOpt(order, fixedEnd) || orOpt(order, fixedEnd))
+        continue;
+    return order;
+}
+
+// Exact order by dynamic programming.  cost[set][last] is the shortest route from the start
+// through the waypoints of set that finishes at last (a member of set), waypoint i + 1 is bit i.
+std::vector<size_t> RouteOptimizer::exact(bool fixedEnd) const
+{
+    const double infinity = std::numeric_limits<double>::infinity();
+    size_t       count    = m_size - 1;
+    size_t       sets     = (size_t) 1 << count;
+    size_t       full     = sets - 1;
+    size_t       finish   = count - 1;
+
+    // Routes that only visit one waypoint come straight from the start
+    std::vector<double>        cost(sets * count, infinity);
+    std::vector<unsigned char> previous(sets * count, 0);
+    for(size_t last = 0; last < count; last++)
+        cost[((size_t) 1 << last) * count + last] = distance(0, last + 1);
+
+    // Grow the sets in increasing order, a set's subsets always come before it
+    for(size_t set = 1; set < sets; set++)
+    {
+        // The finish is only ever the last waypoint visited
+        if(fixedEnd && (set & ((size_t) 1 << finish)) && set != full)
+            continue;
+
+        for(size_t last = 0; last < count; last++)
+        {
+            // Extend routes ending at each other member of the set to this one
+            if(!(set & ((size_t) 1 << last)))
+                continue;
+            size_t rest = set & ~((size_t) 1 << last);
+            if(!rest)
+                continue;
+            double best   = infinity;
+            size_t before = 0;
+            for(size_t k = 0; k < count; k++)
+            {
+                if(!(rest & ((size_t) 1 << k)))
+                    continue;
+                double c = cost[rest * count + k] + distance(k + 1, last + 1);
+                if(c < best)
+                {
+                    best   = c;
+                    before = k;
+                }
+            }
+            cost[set * count + last]     = best;
+            previous[set * count + last] = (unsigned char) before;
+        }
+    }
+
+    // Pick where the route finishes
+    size_t last = finish;
+    if(!fixedEnd)
+    {
+        for(size_t k = 0; k < count; k++)
+            if(cost[full * count + k] < cost[full * count + last])
+                last = k;
+    }
+
+    // Walk back through the sets
+    std::vector<size_t> order(m_size);
+    size_t set = full;
+    for(size_t i = m_size - 1; i > 0; i--)
+    {
+        order[i] = last + 1;
+        size_t before = previous[set * count + last];
+        set &= ~((size_t) 1 << last);
+        last = before;
+    }
+    order[0] = 0;
+    return order;
+}
+
+// Nearest neighbor route from the start (keeping the finish for last)
+void RouteOptimizer::nearestNeighbor(std::vector<size_t>& order, bool fixedEnd) const
+{
+    std::vector<bool> visited(m_size, false);
+    order.clear();
+    order.push_back(0);
+    visited[0] = true;
+    if(fixedEnd)
+        visited[m_size - 1] = true;
+
+    // Always go to the closest waypoint not yet visited
+    while(order.size() < m_size - (fixedEnd ? 1 : 0))
+    {
+        size_t best = 0;
+        double closest = std::numeric_limits<double>::infinity();
+        for(size_t k = 0; k < m_size; k++)
+        {
+            if(!visited[k] && distance(order.back(), k) < closest)
+            {
+                closest = distance(order.back(), k);
+                best    = k;
+            }
+        }
+        order.push_back(best);
+        visited[best] = true;
+    }
+    if(fixedEnd)
+        order.push_back(m_size - 1);
+}
+
+// Reverse the stretch order[i+1 .. j] when that shortens the route.  An open end can have
+// its tail reversed, that edge just disappears.
+bool RouteOptimizer::twoOpt(std::vector<size_t>& order, bool fixedEnd) const
+{
+    bool   improved = false;
+    size_t last     = fixedEnd ? m_size - 2 : m_size - 1;
+    for(size_t i = 0; i + 1 < last; i++)
+    {
+        for(size_t j = i + 2; j <= last; j++)
+        {
+            double before = distance(order[i], order[i+1]);
+            double after  = distance(order[i], order[j]);
+            if(j + 1 < m_size)
+            {
+                before += distance(order[j], order[j+1]);
+                after  += distance(order[i+1], order[j+1]);
+            }
+            if(after < before - 1e-9)
+            {
+                std::reverse(order.begin() + i + 1, order.begin() + j + 1);
+                improved = true;
+            }
+        }
+    }
+    return improved;
+}
+
+// Move a chain of up to three waypoints (either way around) to between two others when that
+// shortens the route
+bool RouteOptimizer::orOpt(std::vector<size_t>& order, bool fixedEnd) const
+{
+    size_t last = fixedEnd ? m_size - 2 : m_size - 1;
+    for(size_t length = 1; length <= 3; length++)
+    {
+        for(size_t i = 1; i + length - 1 <= last; i++)
+        {
+            // What taking the chain order[i .. i+length-1] out saves
+            size_t first = order[i], end = order[i+length-1];
+            size_t prev  = order[i-1];
+            double saved = distance(prev, first);
+            if(i + length < m_size)
+                saved += distance(end, order[i+length]) - distance(prev, order[i+length]);
+
+            // Try it after each waypoint outside of it
+            for(size_t j = 0; j <= last; j++)
+            {
+                if(j + 1 >= i && j < i + length)
+                    continue;
+                bool   open = j + 1 >= m_size;
+                size_t next = open ? 0 : order[j+1];
+                double forward  = distance(order[j], first) + (open ? 0.0 : distance(end, next) - distance(order[j], next));
+                double backward = distance(order[j], end) + (open ? 0.0 : distance(first, next) - distance(order[j], next));
+                double added = std::min(forward, backward);
+                if(added >= saved - 1e-9)
+                    continue;
+
+                // Move it
+                std::vector<size_t> chain(order.begin() + i, order.begin() + i + length);
+                if(backward < forward)
+                    std::reverse(chain.begin(), chain.end());
+                order.erase(order.begin() + i, order.begin() + i + length);
+                size_t at = (j < i) ? j + 1 : j + 1 - length;
+                order.insert(order.begin() + at, chain.begin(), chain.end());
+                return true;
+            }
+        }
+    }
+    return false;
+}
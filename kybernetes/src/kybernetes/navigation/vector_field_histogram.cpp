@@ -0,0 +1,248 @@
+/*
+ *  vector_field_histogram.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/navigation/vector_field_histogram.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+using namespace kybernetes::math;
+using namespace kybernetes::navigation;
+
+// Width of a sector in degrees
+static const double SECTOR_WIDTH = 360.0 / VFH_SECTORS;
+
+// Default tuning for the truck.  The goal weight has to outweigh the other two together
+// so that a free path to the goal is always taken.
+VectorFieldHistogram::parameters VectorFieldHistogram::defaultParameters()
+{
+    VectorFieldHistogram::parameters p;
+    p.windowRadius   = 3.0;
+    p.robotRadius    = 0.35;
+    p.safetyMargin   = 0.15;
+    p.highThreshold  = 1.0;
+    p.lowThreshold   = 0.5;
+    p.maximumTurn    = 90.0;
+    p.wideValley     = 8;
+    p.goalWeight     = 5.0;
+    p.headingWeight  = 2.0;
+    p.previousWeight = 2.0;
+    p.driftPerDegree = 30.0;
+    p.maximumDrift   = 500;
+    return p;
+}
+
+// Constructor for the object
+VectorFieldHistogram::VectorFieldHistogram(const OccupancyGrid::parameters& grid)
+    : m_parameters(defaultParameters()), m_resolution(grid.resolution), m_previous(0), m_havePrevious(false)
+{
+    layout();
+}
+
+// Constructor for the object
+VectorFieldHistogram::VectorFieldHistogram(const OccupancyGrid::parameters& grid, const parameters& p)
+    : m_parameters(p), m_resolution(grid.resolution), m_previous(0), m_havePrevious(false)
+{
+    layout();
+}
+
+// Precompute the sector, spread and weight of every cell offset within the window
+void VectorFieldHistogram::layout()
+{
+    // Clear the histograms
+    std::fill(m_histogram, m_histogram + VFH_SECTORS, 0.0f);
+    std::fill(m_blocked, m_blocked + VFH_SECTORS, false);
+
+    // Visit the square around the robot
+    int    radius   = (int) std::ceil(m_parameters.windowRadius / m_resolution);
+    double enlarged = m_parameters.robotRadius + m_parameters.safetyMargin;
+    double window2  = m_parameters.windowRadius * m_parameters.windowRadius;
+    for(int dy = -radius; dy <= radius; dy++)
+    {
+        for(int dx = -radius; dx <= radius; dx++)
+        {
+            // Only cells within the window, the robot's own cell has no bearing
+            double d = std::sqrt((double) (dx * dx + dy * dy)) * m_resolution;
+            if(d > m_parameters.windowRadius || (dx == 0 && dy == 0))
+                continue;
+
+            // Bearing of the cell, and the angle an obstacle there blocks for the grown robot
+            double bearing = std::atan2((double) dx, (double) dy) * (180.0 / M_PI);
+            double spread  = (d <= enlarged) ? 90.0 : std::asin(enlarged / d) * (180.0 / M_PI);
+
+            // Store the offset, near cells count for more (1 at the edge of the window, 5 at the robot)
+            VectorFieldHistogram::cell c;
+            c.dx     = (short) dx;
+            c.dy     = (short) dy;
+            c.sector = (short) sectorOf(bearing);
+            c.spread = (short) std::ceil(spread / SECTOR_WIDTH);
+            c.weight = (float) (1.0 + 4.0 * (1.0 - (d * d) / window2));
+            m_window.push_back(c);
+        }
+    }
+}
+
+// Sector a compass bearing falls in
+int VectorFieldHistogram::sectorOf(double bearing) const
+{
+    int sector = (int) std::floor(bearing / SECTOR_WIDTH + 0.5) % VFH_SECTORS;
+    return (sector < 0) ? sector + VFH_SECTORS : sector;
+}
+
+// Compass bearing of the center of a sector
+double VectorFieldHistogram::bearingOf(int sector) const
+{
+    return sector * SECTOR_WIDTH;
+}
+
+// Number of sectors between two sectors, the short way around
+int VectorFieldHistogram::distance(int a, int b) const
+{
+    int d = std::abs(a - b) % VFH_SECTORS;
+    return std::min(d, VFH_SECTORS - d);
+}
+
+// Cost of heading for a sector
+double VectorFieldHistogram::cost(int sector, int goal, int heading) const
+{
+    double c = m_parameters.goalWeight * distance(sector, goal) + m_parameters.headingWeight * distance(sector, heading);
+    if(m_havePrevious)
+        c += m_parameters.previousWeight * distance(sector, m_previous);
+    return c;
+}
+
+// Pick a direction from the grid
+VectorFieldHistogram::result VectorFieldHistogram::compute(const OccupancyGrid& grid, double goal)
+{
+    // Where the robot is in the grid
+    int    rx        = grid.cellX(grid.position().x);
+    int    ry        = grid.cellY(grid.position().y);
+    int    threshold = grid.configuration().threshold;
+    double heading   = grid.heading();
+
+    // Build the polar histogram from the occupied cells in the window
+    std::fill(m_histogram, m_histogram + VFH_SECTORS, 0.0f);
+    for(std::vector<VectorFieldHistogram::cell>::const_iterator it = m_window.begin(); it != m_window.end(); ++it)
+    {
+        // Skip everything not believed to be an obstacle
+        int v = grid.at(rx + it->dx, ry + it->dy);
+        if(v <= threshold)
+            continue;
+
+        // Spread certainty squared times nearness over the sectors the obstacle blocks
+        float c = (float) v / OCCUPANCY_LIMIT;
+        float m = c * c * it->weight;
+        int   s = it->sector - it->spread;
+        if(s < 0) s += VFH_SECTORS;
+        for(int k = -it->spread; k <= it->spread; k++)
+        {
+            m_histogram[s] += m;
+            if(++s == VFH_SECTORS) s = 0;
+        }
+    }
+
+    // Threshold with hysteresis, sectors between the thresholds keep their last state
+    for(int s = 0; s < VFH_SECTORS; s++)
+    {
+        if(m_histogram[s] > m_parameters.highThreshold)
+            m_blocked[s] = true;
+        else if(m_histogram[s] < m_parameters.lowThreshold)
+            m_blocked[s] = false;
+    }
+
+    // Sectors are searched on a line from full left to full right of the heading
+    int hs    = sectorOf(heading);
+    int gs    = sectorOf(goal);
+    int reach = (int) (m_parameters.maximumTurn / SECTOR_WIDTH);
+    int gj    = (gs - hs + VFH_SECTORS + VFH_SECTORS / 2) % VFH_SECTORS - VFH_SECTORS / 2;
+
+    // Find the free valleys and score their candidate directions
+    int    best     = 0;
+    double bestCost = 0.0;
+    bool   found    = false;
+    int    wide     = (int) m_parameters.wideValley;
+    for(int j = -reach; j <= reach; j++)
+    {
+        // Skip to the start of a valley, then find its end
+        if(m_blocked[(hs + j + VFH_SECTORS) % VFH_SECTORS])
+            continue;
+        int start = j;
+        while(j < reach && !m_blocked[(hs + j + 1 + VFH_SECTORS) % VFH_SECTORS])
+            j++;
+        int end = j;
+
+        // Narrow valleys are taken down the middle, wide ones along the edges or straight
+        // at the goal if it lies inside
+        int candidates[3];
+        int count = 0;
+        if(end - start + 1 > wide)
+        {
+            candidates[count++] = start + wide / 2;
+            candidates[count++] = end - wide / 2;
+            if(gj >= start + wide / 2 && gj <= end - wide / 2)
+                candidates[count++] = gj;
+        }
+        else
+            candidates[count++] = (start + end) / 2;
+
+        // Keep the cheapest
+        for(int i = 0; i < count; i++)
+        {
+            int    sector = (hs + candidates[i] + VFH_SECTORS) % VFH_SECTORS;
+            double c      = cost(sector, gs, hs);
+            if(!found || c < bestCost)
+            {
+                best     = sector;
+                bestCost = c;
+                found    = true;
+            }
+        }
+    }
+
+    // No way through
+    VectorFieldHistogram::result r;
+    if(!found)
+    {
+        r.direction = heading;
+        r.error     = 0.0;
+        r.drift     = 0;
+        r.blocked   = true;
+        m_havePrevious = false;
+        return r;
+    }
+
+    // Steer for the chosen direction
+    m_previous     = best;
+    m_havePrevious = true;
+    r.direction = bearingOf(best);
+    r.error     = r.direction - heading;
+    while(r.error >= 180.0) r.error -= 360.0;
+    while(r.error < -180.0) r.error += 360.0;
+    double drift = std::max(-(double) m_parameters.maximumDrift, std::min((double) m_parameters.maximumDrift, r.error * m_parameters.driftPerDegree));
+    r.drift   = (short) -drift;
+    r.blocked = false;
+    return r;
+}
+
+// Access the last histogram
+const float* VectorFieldHistogram::histogram() const
+{
+    return m_histogram;
+}
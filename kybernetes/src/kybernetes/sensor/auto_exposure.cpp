@@ -0,0 +1,196 @@
+/*
+ *  auto_exposure.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/sensor/auto_exposure.hpp>
+
+// System dependencies
+#include <linux/videodev2.h>
+
+// Language deps
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+using namespace kybernetes::sensor;
+
+// Default tuning for the truck's camera
+AutoExposure::parameters AutoExposure::defaultParameters()
+{
+    AutoExposure::parameters p;
+    p.target          = 110.0;
+    p.deadband        = 8.0;
+    p.correction      = 0.6;
+    p.clipped         = 250;
+    p.maximumClipped  = 0.02;
+    p.stride          = 8;
+    p.settle          = 2;
+    p.maximumExposure = 333;
+    p.gainRange       = 4.0;
+    return p;
+}
+
+// Constructor for the object
+AutoExposure::AutoExposure(UVCCamera& camera, const parameters& p)
+    : m_camera(camera), m_parameters(p), m_exposureMinimum(0), m_exposureMaximum(0), m_gainMinimum(0), m_gainMaximum(0),
+      m_available(false), m_hasGain(false), m_wait(0)
+{
+    // Take over the exposure
+    m_status.mean = m_status.clipped = 0.0;
+    m_status.exposure = m_status.gain = 0;
+    m_status.changes = 0;
+    m_available = m_camera.controlRange(V4L2_CID_EXPOSURE_ABSOLUTE, m_exposureMinimum, m_exposureMaximum);
+    m_hasGain   = m_camera.controlRange(V4L2_CID_GAIN, m_gainMinimum, m_gainMaximum);
+    if(!m_available)
+    {
+        std::cerr << "Error: AutoExposure - the camera's exposure can't be set" << std::endl;
+        return;
+    }
+    std::map<int, int> controls;
+    controls[V4L2_CID_EXPOSURE_AUTO] = V4L2_EXPOSURE_MANUAL;
+    m_camera.setControls(controls);
+    m_status.exposure = m_camera.controlValue(V4L2_CID_EXPOSURE_ABSOLUTE);
+    m_status.gain     = m_hasGain ? m_camera.controlValue(V4L2_CID_GAIN) : 0;
+}
+
+AutoExposure::~AutoExposure()
+{
+    // Give the exposure back to the camera (UVC cameras auto expose in aperture priority)
+    if(m_available)
+    {
+        std::map<int, int> controls;
+        controls[V4L2_CID_EXPOSURE_AUTO] = V4L2_EXPOSURE_APERTURE_PRIORITY;
+        m_camera.setControls(controls);
+    }
+}
+
+bool AutoExposure::isAvailable() const
+{
+    return m_available;
+}
+
+void AutoExposure::setTarget(double target)
+{
+    m_parameters.target = target;
+}
+
+AutoExposure::status AutoExposure::state() const
+{
+    return m_status;
+}
+
+// Measure the luma of a frame
+bool AutoExposure::measure(const Frame& frame, unsigned int width, unsigned int height, unsigned int format)
+{
+    // Find the luma samples, YUYV has one every other byte and the planar formats a plane of them
+    const unsigned char *luma = (const unsigned char *) frame.data();
+    size_t               pitch;
+    size_t               step;
+    if(format == V4L2_PIX_FMT_YUYV)
+    {
+        pitch = width * 2;
+        step  = 2;
+    } else if(format == V4L2_PIX_FMT_YUV422P || format == V4L2_PIX_FMT_YUV420)
+    {
+        pitch = width;
+        step  = 1;
+    } else
+        return false;
+    if(frame.empty() || frame.size() < pitch * height || width == 0 || height == 0)
+        return false;
+
+    // Sum a grid of them
+    unsigned long sum = 0, clipped = 0, count = 0;
+    unsigned int  stride = std::max(1u, m_parameters.stride);
+    for(unsigned int y = stride / 2; y < height; y += stride)
+    {
+        const unsigned char *row = luma + y * pitch;
+        for(unsigned int x = stride / 2; x < width; x += stride)
+        {
+            unsigned char l = row[x * step];
+            sum += l;
+            clipped += (l >= m_parameters.clipped);
+            count++;
+        }
+    }
+    if(count == 0)
+        return false;
+    m_status.mean    = (double) sum / count;
+    m_status.clipped = (double) clipped / count;
+    return true;
+}
+
+// Measure a frame and correct the exposure
+int AutoExposure::update(const Frame& frame, unsigned int width, unsigned int height, unsigned int format)
+{
+    if(!m_available || !measure(frame, width, height, format))
+        return 1;
+
+    // Let the camera apply the last change before judging it
+    if(m_wait)
+    {
+        m_wait--;
+        return 0;
+    }
+
+    // Nothing to do within the deadband, unless the highlights are clipping
+    double mean = std::max(m_status.mean, 1.0);
+    bool   over = m_status.clipped > m_parameters.maximumClipped;
+    if(!over && std::fabs(mean - m_parameters.target) <= m_parameters.deadband)
+        return 0;
+
+    // Scale the light let in by a fraction of the error (in stops), brightening no more than it
+    // takes to stop the clipping
+    double ratio = std::pow(m_parameters.target / mean, m_parameters.correction);
+    if(over)
+        ratio = std::min(ratio, 0.8);
+    ratio = std::max(0.25, std::min(4.0, ratio));
+
+    // The light wanted, as exposure times the gain's amplification.  Exposure makes up as much
+    // of it as a frame allows and gain the rest, so gain is the first to come down.
+    int    longest = std::min(m_exposureMaximum, std::max(m_exposureMinimum, m_parameters.maximumExposure));
+    double span    = m_hasGain ? std::max(1, m_gainMaximum - m_gainMinimum) : 1;
+    double range   = std::max(1.0, m_parameters.gainRange);
+    double boost   = m_hasGain ? 1.0 + (m_status.gain - m_gainMinimum) / span * (range - 1.0) : 1.0;
+    double light   = m_status.exposure * boost * ratio;
+    int    exposure = std::max(m_exposureMinimum, std::min(longest, (int) std::floor(light + 0.5)));
+    int    gain     = m_status.gain;
+    if(m_hasGain)
+    {
+        double amplification = std::max(1.0, std::min(range, light / exposure));
+        gain = m_gainMinimum + (int) std::floor((amplification - 1.0) / (range - 1.0 + 1e-9) * span + 0.5);
+        gain = std::max(m_gainMinimum, std::min(m_gainMaximum, gain));
+    }
+    if(exposure == m_status.exposure && gain == m_status.gain)
+        return 0;
+
+    // Write both in one transfer
+    std::map<int, int> controls;
+    controls[V4L2_CID_EXPOSURE_ABSOLUTE] = exposure;
+    if(m_hasGain)
+        controls[V4L2_CID_GAIN] = gain;
+    if(m_camera.setControls(controls))
+        return 1;
+    m_status.exposure = exposure;
+    m_status.gain     = gain;
+    m_status.changes++;
+    m_wait = m_parameters.settle;
+    return 0;
+}
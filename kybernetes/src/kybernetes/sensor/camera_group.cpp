@@ -0,0 +1,208 @@
+/*
+ *  camera_group.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/sensor/camera_group.hpp>
+
+// System dependencies
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+// Language deps
+#include <iostream>
+#include <cmath>
+
+using namespace kybernetes::sensor;
+
+// How long the thread waits on the cameras before checking if it should stop (ms)
+static const int SERVICE_TIMEOUT = 100;
+
+// Constructor for the object
+CameraGroup::CameraGroup(const std::vector<UVCCamera *>& cameras, double tolerance)
+    : m_cameras(cameras), m_tolerance(tolerance), m_history(cameras.size()), m_sets(0)
+{
+    // Wait on every camera's descriptor, tagged with its index.  The first wake up of a camera
+    // which isn't streaming yet starts it.
+    m_epoll = epoll_create(m_cameras.size() + 1);
+    if(m_epoll < 0)
+        std::cerr << "Error: CameraGroup - could not create an epoll instance" << std::endl;
+    for(size_t i = 0; i < m_cameras.size() && m_epoll >= 0; i++)
+    {
+        struct epoll_event event;
+        event.events   = EPOLLIN;
+        event.data.u64 = i;
+        if(epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_cameras[i]->descriptor(), &event) < 0)
+            std::cerr << "Error: CameraGroup - could not wait on camera " << i << std::endl;
+    }
+
+    // Start the servicing thread
+    m_thread = boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&CameraGroup::do_servicing, this)));
+}
+
+CameraGroup::CameraGroup(size_t sources, double tolerance)
+    : m_epoll(-1), m_tolerance(tolerance), m_history(sources), m_sets(0)
+{
+
+}
+
+CameraGroup::~CameraGroup()
+{
+    // Stop the servicing thread
+    if(m_thread)
+    {
+        m_thread->interrupt();
+        m_thread->join();
+    }
+    if(m_epoll >= 0)
+        close(m_epoll);
+}
+
+// Store a callback object in our callbacks list
+void CameraGroup::registerCallback(CameraGroup::callback *c)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_callbacks.push_back(c);
+}
+
+// Remove a callback object from our callbacks list
+void CameraGroup::unregisterCallback(CameraGroup::callback *c)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_callbacks.remove(c);
+}
+
+// The last set of frames
+bool CameraGroup::latest(std::vector<Frame>& frames)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if(m_set.empty())
+        return false;
+    frames = m_set;
+    return true;
+}
+
+// Number of sets made
+unsigned long CameraGroup::sets()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_sets;
+}
+
+// Try to make a set around a camera's newest frame (m_mutex is held)
+bool CameraGroup::match(size_t camera, std::vector<Frame>& set) const
+{
+    double when = m_history[camera].back().timestamp();
+    set.assign(m_history.size(), Frame());
+    set[camera] = m_history[camera].back();
+
+    // Take the closest frame of every other camera
+    for(size_t i = 0; i < m_history.size(); i++)
+    {
+        if(i == camera)
+            continue;
+        double best = m_tolerance;
+        for(std::deque<Frame>::const_iterator it = m_history[i].begin(); it != m_history[i].end(); ++it)
+        {
+            double skew = std::fabs(it->timestamp() - when);
+            if(skew <= best)
+            {
+                best   = skew;
+                set[i] = *it;
+            }
+        }
+        if(set[i].empty())
+            return false;
+
+        // A frame already sent in the last set isn't sent in another
+        if(!m_set.empty() && set[i].sequence() == m_set[i].sequence())
+            return false;
+    }
+    return true;
+}
+
+// Pair a frame of a camera with the others
+void CameraGroup::insert(size_t camera, const Frame& frame)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if(camera >= m_history.size() || frame.empty())
+        return;
+
+    // Keep it for pairing, and see if it makes a set
+    m_history[camera].push_back(frame);
+    if(m_history[camera].size() > CAMERA_GROUP_HISTORY)
+        m_history[camera].pop_front();
+    std::vector<Frame> set;
+    bool matched = match(camera, set);
+
+    // Pass on the frame and the set
+    if(matched)
+    {
+        m_set = set;
+        m_sets++;
+    }
+    for(std::list<CameraGroup::callback *>::iterator it = m_callbacks.begin(); it != m_callbacks.end(); ++it)
+    {
+        (*it)->camera_event_frame(camera, frame);
+        if(matched)
+            (*it)->camera_event_set(set);
+    }
+}
+
+// Thread which services the cameras
+void CameraGroup::do_servicing()
+{
+    std::vector<struct epoll_event> events(m_cameras.size() + 1);
+    try
+    {
+        while(m_epoll >= 0)
+        {
+            // Wait for any of the cameras to have a frame
+            boost::this_thread::interruption_point();
+            int ready = epoll_wait(m_epoll, &events[0], events.size(), SERVICE_TIMEOUT);
+            if(ready < 0 && errno != EINTR)
+            {
+                std::cerr << "Error: CameraGroup - waiting on the cameras failed" << std::endl;
+                break;
+            }
+
+            // Take the frame from each camera that has one
+            for(int e = 0; e < ready; e++)
+            {
+                size_t camera = events[e].data.u64;
+                Frame  frame;
+                int    result = m_cameras[camera]->capture(frame, false);
+                if(result == 1)
+                {
+                    // A camera which fails would wake the thread forever, stop waiting on it
+                    std::cerr << "Error: CameraGroup - camera " << camera << " failed, no longer servicing it" << std::endl;
+                    epoll_ctl(m_epoll, EPOLL_CTL_DEL, m_cameras[camera]->descriptor(), NULL);
+                    continue;
+                } else if(result == 2)
+                    continue;
+
+                // Pair it and pass it on
+                insert(camera, frame);
+            }
+        }
+    } catch (boost::thread_interrupted)
+    {
+
+    }
+}
@@ -0,0 +1,210 @@
+/*
+ *  frame_player.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/sensor/frame_player.hpp>
+
+// System dependencies
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/videodev2.h>
+
+// Language deps
+#include <iostream>
+#include <cstring>
+
+using namespace kybernetes::sensor;
+
+// The mapped recording, unmapped once the player and its frames are gone
+struct FramePlayer::recording
+{
+    void   *data;
+    size_t  length;
+
+    recording(void *_data, size_t _length) : data(_data), length(_length) {}
+    ~recording()
+    {
+        munmap(data, length);
+    }
+};
+
+// A frame of the recording, holding the mapping
+struct FramePlayer::lease : public Frame::lease
+{
+    boost::shared_ptr<FramePlayer::recording> file;
+};
+
+// Constructor for the object
+FramePlayer::FramePlayer(const std::string& path, unsigned int width, unsigned int height, double rate, bool loop)
+    : m_width(width), m_height(height), m_format(V4L2_PIX_FMT_YUYV), m_frameSize(width * height * 2), m_frames(0), m_index(NULL),
+      m_pacer(rate), m_loop(loop), m_base(0), m_next(0)
+{
+    // Open the recording
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if(descriptor < 0)
+    {
+        std::cerr << "Error: FramePlayer - could not open \"" << path << "\"" << std::endl;
+        return;
+    }
+
+    // It has to hold something
+    struct stat info;
+    if(fstat(descriptor, &info) < 0 || info.st_size == 0)
+    {
+        std::cerr << "Error: FramePlayer - \"" << path << "\" is empty" << std::endl;
+        close(descriptor);
+        return;
+    }
+
+    // Map it, the mapping keeps the file
+    void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if(data == MAP_FAILED)
+    {
+        std::cerr << "Error: FramePlayer - could not map \"" << path << "\"" << std::endl;
+        return;
+    }
+
+    // It is read front to back
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+    boost::shared_ptr<recording> file(new recording(data, info.st_size));
+
+    // A FrameRecorder's recording describes itself, and its index says where each frame is
+    const FrameRecorder::header *h = (const FrameRecorder::header *) data;
+    if((size_t) info.st_size >= sizeof(FrameRecorder::header) && memcmp(h->magic, FRAME_RECORDING_MAGIC, sizeof(h->magic)) == 0)
+    {
+        if(h->version != FRAME_RECORDING_VERSION || h->frames == 0 || h->index > (uint64_t) info.st_size ||
+           h->frames > (info.st_size - h->index) / sizeof(FrameRecorder::entry))
+        {
+            std::cerr << "Error: FramePlayer - \"" << path << "\" is an unfinished or unknown recording" << std::endl;
+            return;
+        }
+
+        // Every frame has to be within the file
+        const FrameRecorder::entry *index = (const FrameRecorder::entry *) ((const char *) data + h->index);
+        for(uint64_t i = 0; i < h->frames; i++)
+        {
+            if(index[i].offset > (uint64_t) info.st_size || index[i].size > info.st_size - index[i].offset)
+            {
+                std::cerr << "Error: FramePlayer - \"" << path << "\" has a corrupt index (frame " << i << ")" << std::endl;
+                return;
+            }
+        }
+        m_index     = index;
+        m_width     = h->width;
+        m_height    = h->height;
+        m_format    = h->format;
+        m_frameSize = 0;
+        m_frames    = h->frames;
+        m_recording = file;
+        return;
+    }
+
+    // Otherwise it is raw, and has to hold at least a frame
+    if(m_frameSize == 0 || (size_t) info.st_size < m_frameSize)
+    {
+        std::cerr << "Error: FramePlayer - \"" << path << "\" doesn't hold a " << width << "x" << height << " frame" << std::endl;
+        return;
+    }
+    m_recording = file;
+    m_frames    = info.st_size / m_frameSize;
+}
+
+// Whether the recording could be opened
+bool FramePlayer::isOpen() const
+{
+    return m_recording.get() != NULL;
+}
+
+// Frames in the recording
+size_t FramePlayer::frames() const
+{
+    return m_frames;
+}
+
+// Play the next frame
+int FramePlayer::capture(Frame& frame)
+{
+    if(!m_recording)
+        return 1;
+
+    // Find the frame, starting over or stopping at the end
+    double        timestamp;
+    unsigned long count = m_pacer.next(timestamp);
+    unsigned long index = m_base + count;
+    m_next              = count + 1;
+    if(index >= m_frames && !m_loop)
+        return 1;
+
+    // Point it into the mapping
+    boost::shared_ptr<FramePlayer::lease> l(new FramePlayer::lease);
+    l->file      = m_recording;
+    if(m_index)
+    {
+        const FrameRecorder::entry& e = m_index[index % m_frames];
+        l->data  = (const char *) m_recording->data + e.offset;
+        l->size  = e.size;
+    } else
+    {
+        l->data  = (const char *) m_recording->data + (index % m_frames) * m_frameSize;
+        l->size  = m_frameSize;
+    }
+    l->timestamp = timestamp;
+    l->sequence  = index;
+    frame = Frame(l);
+    return 0;
+}
+
+// Play from a frame on
+void FramePlayer::seek(size_t frame)
+{
+    // The pacer keeps counting, so offset its count to land on the frame next
+    m_base = frame - m_next;
+}
+
+// The index entry of a frame
+bool FramePlayer::recorded(size_t frame, FrameRecorder::entry& e) const
+{
+    if(!m_index || frame >= m_frames)
+        return false;
+    e = m_index[frame];
+    return true;
+}
+
+unsigned int FramePlayer::imageWidth() const
+{
+    return m_width;
+}
+
+unsigned int FramePlayer::imageHeight() const
+{
+    return m_height;
+}
+
+unsigned int FramePlayer::imageFormat() const
+{
+    return m_format;
+}
+
+unsigned long FramePlayer::dropped() const
+{
+    return m_pacer.dropped();
+}
@@ -0,0 +1,319 @@
+/*
+ *  frame_recorder.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/sensor/frame_recorder.hpp>
+
+// System dependencies
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+// Language deps
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+using namespace kybernetes::sensor;
+
+// Frames start on this many bytes
+static const size_t FRAME_ALIGNMENT = 64;
+
+// Round up to a multiple of a power of two
+static uint64_t roundUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Constructor for the object
+FrameRecorder::FrameRecorder(const std::string& path, unsigned int width, unsigned int height, unsigned int format, size_t chunkSize, unsigned int chunks)
+    : m_descriptor(-1), m_written(FRAME_RECORDING_ALIGNMENT), m_position(FRAME_RECORDING_ALIGNMENT), m_direct(true), m_chunkSize(roundUp(chunkSize, FRAME_RECORDING_ALIGNMENT)),
+      m_chunk(NULL), m_fill(0), m_bytes(0), m_dropped(0), m_failed(false), m_closing(false), m_turret(NULL)
+{
+    // Describe the recording.  The header goes out now without any frames, so a recording cut
+    // short reads as unfinished, and again with the frames and index on closing.
+    memset(&m_header, 0, sizeof(m_header));
+    memcpy(m_header.magic, FRAME_RECORDING_MAGIC, sizeof(m_header.magic));
+    m_header.version = FRAME_RECORDING_VERSION;
+    m_header.width   = width;
+    m_header.height  = height;
+    m_header.format  = format;
+
+    // Create the file, skipping the page cache if the filesystem allows it
+    m_descriptor = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if(m_descriptor < 0 && errno == EINVAL)
+    {
+        std::cerr << "Warning: FrameRecorder - \"" << path << "\" can't be written directly, going through the page cache" << std::endl;
+        m_direct     = false;
+        m_descriptor = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if(m_descriptor < 0)
+    {
+        std::cerr << "Error: FrameRecorder - could not create \"" << path << "\"" << std::endl;
+        return;
+    }
+
+    // Allocate the chunks aligned for direct io
+    for(unsigned int i = 0; i < chunks + 1; i++)
+    {
+        void *chunk;
+        if(posix_memalign(&chunk, FRAME_RECORDING_ALIGNMENT, m_chunkSize))
+            break;
+        m_chunks.push_back((unsigned char *) chunk);
+    }
+    if(m_chunks.size() < 2)
+    {
+        std::cerr << "Error: FrameRecorder - could not allocate the chunks" << std::endl;
+        ::close(m_descriptor);
+        m_descriptor = -1;
+        return;
+    }
+    m_free.assign(m_chunks.begin() + 1, m_chunks.end());
+    m_chunk = m_chunks[0];
+
+    // Mark the file as a recording before any frames go in
+    if(!writeHeader())
+    {
+        std::cerr << "Error: FrameRecorder - could not write the header of \"" << path << "\"" << std::endl;
+        ::close(m_descriptor);
+        m_descriptor = -1;
+        return;
+    }
+
+    // Start the writing thread
+    m_thread = boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&FrameRecorder::do_writing, this)));
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    // Finish the recording and free the chunks
+    close();
+    for(size_t i = 0; i < m_chunks.size(); i++)
+        free(m_chunks[i]);
+}
+
+// Whether the recording is being written
+bool FrameRecorder::isOpen()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_descriptor >= 0 && !m_failed && !m_closing;
+}
+
+// Stamp the frames from a camera with the pose of its turret
+void FrameRecorder::setTurret(PTZWorker *turret)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_turret = turret;
+}
+
+// Record a frame
+int FrameRecorder::record(const Frame& frame, int pan, int tilt, bool moving)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if(m_descriptor < 0 || m_failed || m_closing || frame.empty())
+        return 1;
+
+    // Drop the frame if there aren't chunks free for all of it
+    size_t start  = roundUp(m_fill, FRAME_ALIGNMENT);
+    size_t chunks = (start + frame.size()) / m_chunkSize;
+    if(chunks > m_free.size())
+    {
+        m_dropped++;
+        return 1;
+    }
+
+    // Index it
+    entry e;
+    memset(&e, 0, sizeof(e));
+    e.offset    = m_position + start;
+    e.size      = frame.size();
+    e.sequence  = frame.sequence();
+    e.timestamp = frame.timestamp();
+    e.pan       = pan;
+    e.tilt      = tilt;
+    e.moving    = moving;
+    m_index.push_back(e);
+    m_bytes    += frame.size();
+
+    // Copy it in, passing each chunk it fills to the writer
+    memset(m_chunk + m_fill, 0, start - m_fill);
+    m_fill = start;
+    const unsigned char *data = (const unsigned char *) frame.data();
+    size_t               left = frame.size();
+    while(1)
+    {
+        if(m_fill == m_chunkSize)
+        {
+            m_full.push_back(m_chunk);
+            m_chunk     = m_free.back();
+            m_free.pop_back();
+            m_fill      = 0;
+            m_position += m_chunkSize;
+            m_changed.notify_all();
+        }
+        if(!left)
+            break;
+        size_t length = std::min(left, m_chunkSize - m_fill);
+        memcpy(m_chunk + m_fill, data, length);
+        m_fill += length;
+        data   += length;
+        left   -= length;
+    }
+    return 0;
+}
+
+// A camera captured a frame
+void FrameRecorder::camera_event_frame(const Frame& frame)
+{
+    // The pose of the turret when the frame was taken
+    PTZWorker::pose pose = {0, 0, 0.0};
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        if(m_turret)
+            pose = m_turret->applied();
+    }
+    record(frame, pose.pan, pose.tilt, frame.timestamp() < pose.timestamp);
+}
+
+// Write a block out
+bool FrameRecorder::write(const void *data, size_t length, uint64_t offset)
+{
+    const unsigned char *block = (const unsigned char *) data;
+    while(length)
+    {
+        ssize_t written = pwrite(m_descriptor, block, length, offset);
+        if(written < 0 && errno == EINTR)
+            continue;
+        if(written <= 0)
+            return false;
+        block  += written;
+        length -= written;
+        offset += written;
+    }
+    return true;
+}
+
+// Write the header block out, through an aligned buffer
+bool FrameRecorder::writeHeader()
+{
+    void *block = NULL;
+    if(posix_memalign(&block, FRAME_RECORDING_ALIGNMENT, FRAME_RECORDING_ALIGNMENT))
+        return false;
+    memset(block, 0, FRAME_RECORDING_ALIGNMENT);
+    memcpy(block, &m_header, sizeof(m_header));
+    bool written = write(block, FRAME_RECORDING_ALIGNMENT, 0);
+    free(block);
+    return written;
+}
+
+// Thread which writes the chunks
+void FrameRecorder::do_writing()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    while(1)
+    {
+        // Wait for a full chunk, or to finish
+        while(m_full.empty() && !m_closing)
+            m_changed.wait(lock);
+        if(m_full.empty())
+            break;
+
+        // Write it out without holding the lock
+        unsigned char *chunk  = m_full.front();
+        uint64_t       offset = m_written;
+        lock.unlock();
+        bool written = write(chunk, m_chunkSize, offset);
+        lock.lock();
+
+        // Give the chunk back
+        m_full.pop_front();
+        m_free.push_back(chunk);
+        m_written += m_chunkSize;
+        if(!written && !m_failed)
+        {
+            std::cerr << "Error: FrameRecorder - writing failed, stopping the recording" << std::endl;
+            m_failed = true;
+        }
+        m_changed.notify_all();
+    }
+}
+
+// Write out the rest of the frames and the index and close the file
+void FrameRecorder::close()
+{
+    // Let the writer finish the chunks waiting
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        if(m_descriptor < 0 || m_closing)
+            return;
+        m_closing = true;
+        m_changed.notify_all();
+    }
+    m_thread->join();
+
+    // The last chunk, padded out to a block
+    uint64_t end = m_position + m_fill;
+    memset(m_chunk + m_fill, 0, roundUp(m_fill, FRAME_RECORDING_ALIGNMENT) - m_fill);
+    bool written = !m_failed && write(m_chunk, roundUp(m_fill, FRAME_RECORDING_ALIGNMENT), m_position);
+
+    // The index after it through an aligned buffer, then the header
+    m_header.frames = m_index.size();
+    m_header.index  = roundUp(end, FRAME_RECORDING_ALIGNMENT);
+    size_t length   = roundUp(m_index.size() * sizeof(entry), FRAME_RECORDING_ALIGNMENT);
+    void  *block    = NULL;
+    if(written && posix_memalign(&block, FRAME_RECORDING_ALIGNMENT, std::max(length, (size_t) FRAME_RECORDING_ALIGNMENT)) == 0)
+    {
+        memset(block, 0, length);
+        if(!m_index.empty())
+            memcpy(block, &m_index[0], m_index.size() * sizeof(entry));
+        written = write(block, length, m_header.index);
+        free(block);
+        written = written && writeHeader();
+
+        // Trim the padding after the index
+        written = written && ftruncate(m_descriptor, m_header.index + m_index.size() * sizeof(entry)) == 0;
+    }
+    else
+        written = false;
+    if(!written)
+        std::cerr << "Error: FrameRecorder - the recording is incomplete" << std::endl;
+    ::close(m_descriptor);
+    m_descriptor = -1;
+}
+
+// Frames recorded
+unsigned long FrameRecorder::frames()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_index.size();
+}
+
+// Frames dropped
+unsigned long FrameRecorder::dropped()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_dropped;
+}
+
+// Bytes of frames recorded
+uint64_t FrameRecorder::bytes()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_bytes;
+}
@@ -0,0 +1,143 @@
+/*
+ *  frame_source.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/sensor/frame_source.hpp>
+#include <kybernetes/sensor/uvccamera.hpp>
+#include <kybernetes/sensor/frame_player.hpp>
+#include <kybernetes/sensor/synthetic_camera.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+#include <boost/thread/thread.hpp>
+
+#include <cmath>
+
+using namespace kybernetes::sensor;
+
+// An empty frame
+Frame::Frame()
+{
+}
+
+// A frame holding a lease
+Frame::Frame(const boost::shared_ptr<lease>& l)
+    : m_lease(l)
+{
+}
+
+bool Frame::empty() const
+{
+    return !m_lease;
+}
+
+const void* Frame::data() const
+{
+    return m_lease ? m_lease->data : NULL;
+}
+
+size_t Frame::size() const
+{
+    return m_lease ? m_lease->size : 0;
+}
+
+double Frame::timestamp() const
+{
+    return m_lease ? m_lease->timestamp : 0.0;
+}
+
+unsigned int Frame::sequence() const
+{
+    return m_lease ? m_lease->sequence : 0;
+}
+
+void Frame::release()
+{
+    m_lease.reset();
+}
+
+// Constructor for the object
+FramePacer::FramePacer(double rate)
+    : m_rate(rate), m_start(0.0), m_next(0), m_dropped(0)
+{
+}
+
+// Index of the frame to produce
+unsigned long FramePacer::next(double& timestamp)
+{
+    double now = kybernetes::utility::monotonicTime();
+
+    // Unpaced, every frame in turn
+    if(m_rate <= 0.0)
+    {
+        timestamp = now;
+        return m_next++;
+    }
+
+    // The clock starts with the first frame
+    if(m_next == 0 && m_start == 0.0)
+        m_start = now;
+
+    // Wait for the next frame, or skip to the newest one due
+    unsigned long due = (unsigned long) std::floor((now - m_start) * m_rate);
+    if(due < m_next)
+    {
+        double wait = m_start + m_next / m_rate - now;
+        boost::this_thread::sleep(boost::posix_time::microseconds((long) (wait * 1e6)));
+        due = m_next;
+    }
+    m_dropped += due - m_next;
+    m_next = due + 1;
+    timestamp = m_start + due / m_rate;
+    return due;
+}
+
+// Frames skipped
+unsigned long FramePacer::dropped() const
+{
+    return m_dropped;
+}
+
+// Open a source by name
+FrameSource* kybernetes::sensor::openFrameSource(const std::string& name, unsigned int width, unsigned int height, double rate)
+{
+    // A camera
+    if(name.compare(0, 5, "/dev/") == 0)
+    {
+        UVCCamera *camera = new UVCCamera(name, width, height, V4L2_PIX_FMT_YUYV);
+        if(!camera->isOpen())
+        {
+            delete camera;
+            return NULL;
+        }
+        return camera;
+    }
+
+    // Generated images
+    if(name == "synthetic")
+        return new SyntheticCamera(width, height, rate);
+
+    // A recording
+    FramePlayer *player = new FramePlayer(name, width, height, rate);
+    if(!player->isOpen())
+    {
+        delete player;
+        return NULL;
+    }
+    return player;
+}
@@ -0,0 +1,303 @@
+/*
+ *  mjpeg_decoder.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/sensor/mjpeg_decoder.hpp>
+
+// Pull in some boost utilities
+#include <boost/thread/mutex.hpp>
+
+// System dependencies
+#include <linux/videodev2.h>
+#include <setjmp.h>
+
+// Language deps
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+
+// External libraries
+#include <jpeglib.h>
+
+using namespace kybernetes::sensor;
+
+// The buffers for decoded frames.  A buffer is handed out by the decoder and given back by the
+// last copy of its frame, possibly from another thread.  Adding a buffer doesn't move the others.
+struct MJPEGDecoder::pool
+{
+    boost::mutex                             lock;
+    std::deque<std::vector<unsigned char> >  buffers;
+    std::vector<size_t>                      available;
+
+    // Take a free buffer, adding one if all of them are held
+    size_t take()
+    {
+        boost::mutex::scoped_lock l(lock);
+        if(available.empty())
+        {
+            buffers.push_back(std::vector<unsigned char>());
+            return buffers.size() - 1;
+        }
+        size_t index = available.back();
+        available.pop_back();
+        return index;
+    }
+
+    // Give a buffer back
+    void give(size_t index)
+    {
+        boost::mutex::scoped_lock l(lock);
+        available.push_back(index);
+    }
+};
+
+// A decoded frame, its buffer goes back to the pool once no frame holds it
+struct MJPEGDecoder::lease : public Frame::lease
+{
+    boost::shared_ptr<MJPEGDecoder::pool> images;
+    size_t                                index;
+
+    ~lease()
+    {
+        images->give(index);
+    }
+};
+
+// libjpeg exits the program on an error by default, jump back to the decode instead
+struct decode_error
+{
+    struct jpeg_error_mgr manager;
+    jmp_buf               exit;
+};
+
+static void decode_error_exit(j_common_ptr cinfo)
+{
+    longjmp(((decode_error *) cinfo->err)->exit, 1);
+}
+
+// Corrupt data warnings come with every bad frame, don't print them
+static void decode_error_output(j_common_ptr cinfo)
+{
+
+}
+
+// Constructor for the object
+MJPEGDecoder::MJPEGDecoder(FrameSource& source, unsigned int scale)
+    : m_pool(new pool), m_source(source), m_scale(1), m_format(V4L2_PIX_FMT_YUV422P), m_failed(0)
+{
+    setScale(scale);
+}
+
+// Change the scale frames are decoded at
+void MJPEGDecoder::setScale(unsigned int scale)
+{
+    // libjpeg scales by 1/1, 1/2, 1/4 or 1/8
+    m_scale = scale;
+    if(m_scale != 1 && m_scale != 2 && m_scale != 4 && m_scale != 8)
+    {
+        std::cerr << "Error: MJPEGDecoder - can't scale by 1/" << m_scale << ", decoding at full size" << std::endl;
+        m_scale = 1;
+    }
+    m_width  = (m_source.imageWidth() + m_scale - 1) / m_scale;
+    m_height = (m_source.imageHeight() + m_scale - 1) / m_scale;
+}
+
+unsigned int MJPEGDecoder::scale() const
+{
+    return m_scale;
+}
+
+// Decode a compressed image into a buffer
+int MJPEGDecoder::decode(const Frame& compressed, std::vector<unsigned char>& image)
+{
+    struct jpeg_decompress_struct cinfo;
+    decode_error                  error;
+
+    // Catch errors from the decoder
+    cinfo.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit     = decode_error_exit;
+    error.manager.output_message = decode_error_output;
+    if(setjmp(error.exit))
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return 1;
+    }
+
+    // Read the header straight from the frame.  The cameras leave out the huffman tables, which
+    // libjpeg-turbo fills in with the standard ones.
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char *) compressed.data(), compressed.size());
+    if(jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK)
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return 1;
+    }
+
+    // Only YCbCr with full resolution luma and chroma at half width (and height) can be decoded
+    // straight into the planes
+    jpeg_component_info *components = cinfo.comp_info;
+    if(cinfo.num_components != 3 || cinfo.jpeg_color_space != JCS_YCbCr || components[0].h_samp_factor != 2 ||
+       components[0].v_samp_factor > 2 || components[1].h_samp_factor != 1 || components[1].v_samp_factor != 1 ||
+       components[2].h_samp_factor != 1 || components[2].v_samp_factor != 1)
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return 1;
+    }
+
+    // Decode the raw (downsampled) components, scaled in the DCT
+    cinfo.raw_data_out        = TRUE;
+    cinfo.do_fancy_upsampling = FALSE;
+    cinfo.dct_method          = JDCT_ISLOW;
+    cinfo.scale_num           = 1;
+    cinfo.scale_denom         = m_scale;
+    jpeg_start_decompress(&cinfo);
+
+    // libjpeg-turbo scales the chroma of a scaled 4:2:0 image up in the IDCT (rather than leave
+    // it to the upsampler, which isn't run here), so a component can come out at a multiple of
+    // the size wanted.  Those are subsampled back down as they are copied out.
+    unsigned int width  = cinfo.output_width;
+    unsigned int height = cinfo.output_height;
+    unsigned int step[3];
+    size_t       planeWidth[3];
+    size_t       planeHeight[3];
+    size_t       planeOffset[3];
+    size_t       total = 0;
+    for(int c = 0; c < 3; c++)
+    {
+        step[c]        = components[c].DCT_scaled_size / cinfo.min_DCT_scaled_size;
+        planeWidth[c]  = (components[c].downsampled_width + step[c] - 1) / step[c];
+        planeHeight[c] = (components[c].downsampled_height + step[c] - 1) / step[c];
+        planeOffset[c] = total;
+        total         += planeWidth[c] * planeHeight[c];
+    }
+    image.resize(total);
+
+    // libjpeg writes an iMCU row at a time, in whole blocks, so decode into a strip of padded
+    // rows and copy out the part of each which is in the image
+    unsigned int rows = cinfo.max_v_samp_factor * cinfo.min_DCT_scaled_size;
+    unsigned int stripRows[3];
+    size_t       stripWidth[3];
+    size_t       stripOffset[3];
+    size_t       stripSize = 0;
+    for(int c = 0; c < 3; c++)
+    {
+        stripRows[c]   = components[c].v_samp_factor * components[c].DCT_scaled_size;
+        stripWidth[c]  = components[c].width_in_blocks * components[c].DCT_scaled_size;
+        stripOffset[c] = stripSize;
+        stripSize     += stripWidth[c] * stripRows[c];
+    }
+    m_strip.resize(stripSize);
+
+    JSAMPROW   rowPointers[3][4 * DCTSIZE];
+    JSAMPARRAY planes[3];
+    for(int c = 0; c < 3; c++)
+    {
+        for(unsigned int r = 0; r < stripRows[c]; r++)
+            rowPointers[c][r] = &m_strip[stripOffset[c] + r * stripWidth[c]];
+        planes[c] = rowPointers[c];
+    }
+
+    while(cinfo.output_scanline < height)
+    {
+        // Decode the next iMCU row
+        unsigned int first = cinfo.output_scanline / rows;
+        if(jpeg_read_raw_data(&cinfo, planes, rows) == 0)
+        {
+            jpeg_destroy_decompress(&cinfo);
+            return 1;
+        }
+
+        // Copy out each component's rows of it
+        for(int c = 0; c < 3; c++)
+        {
+            for(unsigned int r = 0; r < stripRows[c]; r += step[c])
+            {
+                size_t y = (first * stripRows[c] + r) / step[c];
+                if(y >= planeHeight[c])
+                    break;
+                unsigned char *destination = &image[planeOffset[c] + y * planeWidth[c]];
+                if(step[c] == 1)
+                    memcpy(destination, rowPointers[c][r], planeWidth[c]);
+                else for(size_t x = 0; x < planeWidth[c]; x++)
+                    destination[x] = rowPointers[c][r][x * step[c]];
+            }
+        }
+    }
+
+    // Done with the image (the rest of the data isn't needed)
+    m_width  = width;
+    m_height = height;
+    m_format = (components[0].v_samp_factor == 2) ? V4L2_PIX_FMT_YUV420 : V4L2_PIX_FMT_YUV422P;
+    jpeg_abort_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return 0;
+}
+
+// Capture and decode the next frame
+int MJPEGDecoder::capture(Frame& frame)
+{
+    while(1)
+    {
+        // Get the compressed frame
+        Frame compressed;
+        if(m_source.capture(compressed))
+            return 1;
+
+        // Decode it into a buffer from the pool
+        boost::shared_ptr<MJPEGDecoder::lease> l(new MJPEGDecoder::lease);
+        l->images = m_pool;
+        l->index  = m_pool->take();
+        std::vector<unsigned char>& image = m_pool->buffers[l->index];
+        if(decode(compressed, image))
+        {
+            // Skip frames which don't decode
+            m_failed++;
+            continue;
+        }
+        l->data      = &image[0];
+        l->size      = image.size();
+        l->timestamp = compressed.timestamp();
+        l->sequence  = compressed.sequence();
+
+        // Replacing the frame drops its hold on the last buffer
+        frame = Frame(l);
+        return 0;
+    }
+}
+
+unsigned int MJPEGDecoder::imageWidth() const
+{
+    return m_width;
+}
+
+unsigned int MJPEGDecoder::imageHeight() const
+{
+    return m_height;
+}
+
+unsigned int MJPEGDecoder::imageFormat() const
+{
+    return m_format;
+}
+
+unsigned long MJPEGDecoder::dropped() const
+{
+    return m_source.dropped() + m_failed;
+}
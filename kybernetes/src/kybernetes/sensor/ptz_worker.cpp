@@ -0,0 +1,192 @@
+/*
+ *  ptz_worker.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/sensor/ptz_worker.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+// Language deps
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace kybernetes::sensor;
+using kybernetes::utility::monotonicTime;
+
+// Default tuning for the truck's camera
+PTZWorker::parameters PTZWorker::defaultParameters()
+{
+    PTZWorker::parameters p;
+    p.interval  = 0.05;
+    p.slewRate  = 120.0;
+    p.resetTime = 2.0;
+    return p;
+}
+
+// Constructor for the object
+PTZWorker::PTZWorker(UVCCamera& camera, const parameters& p)
+    : m_camera(camera), m_parameters(p), m_reset(false), m_ready(0.0), m_transfers(0), m_coalesced(0), m_errors(0)
+{
+    // Start from wherever the camera thinks it is
+    m_applied.pan       = m_camera.pan();
+    m_applied.tilt      = m_camera.tilt();
+    m_applied.timestamp = monotonicTime();
+    m_commanded         = m_applied;
+
+    // Start the worker thread
+    m_thread = boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&PTZWorker::do_moving, this)));
+}
+
+PTZWorker::~PTZWorker()
+{
+    // Stop the worker thread, a move being sent finishes first
+    m_thread->interrupt();
+    m_thread->join();
+}
+
+// Keep a target within the turret's travel (m_mutex is held)
+void PTZWorker::post(int pan, int tilt)
+{
+    // A target not yet sent is replaced
+    if(m_reset || m_commanded.pan != m_applied.pan || m_commanded.tilt != m_applied.tilt)
+        m_coalesced++;
+    m_commanded.pan       = std::max(PTZ_PAN_MIN, std::min(PTZ_PAN_MAX, pan));
+    m_commanded.tilt      = std::max(PTZ_TILT_MIN, std::min(PTZ_TILT_MAX, tilt));
+    m_commanded.timestamp = monotonicTime();
+    m_changed.notify_one();
+}
+
+// Post a target
+void PTZWorker::move(int pan, int tilt)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    post(pan, tilt);
+}
+
+// Post a move from the applied pose
+void PTZWorker::moveRelative(int pan, int tilt)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    post(m_applied.pan + pan, m_applied.tilt + tilt);
+}
+
+// Post a reset, it replaces any target waiting
+void PTZWorker::reset()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if(m_reset || m_commanded.pan != m_applied.pan || m_commanded.tilt != m_applied.tilt)
+        m_coalesced++;
+    m_reset               = true;
+    m_commanded.pan       = 0;
+    m_commanded.tilt      = 0;
+    m_commanded.timestamp = monotonicTime();
+    m_changed.notify_one();
+}
+
+// The poses
+PTZWorker::pose PTZWorker::commanded()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_commanded;
+}
+
+PTZWorker::pose PTZWorker::applied()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_applied;
+}
+
+// Whether the turret should be at the commanded pose
+bool PTZWorker::settled()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return !m_reset && m_commanded.pan == m_applied.pan && m_commanded.tilt == m_applied.tilt && monotonicTime() >= m_applied.timestamp;
+}
+
+// Statistics
+unsigned long PTZWorker::transfers()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_transfers;
+}
+
+unsigned long PTZWorker::coalesced()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_coalesced;
+}
+
+unsigned long PTZWorker::errors()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_errors;
+}
+
+// The thread function
+void PTZWorker::do_moving()
+{
+    try
+    {
+        while(1)
+        {
+            // Wait for a target to send
+            boost::mutex::scoped_lock lock(m_mutex);
+            while(!m_reset && m_commanded.pan == m_applied.pan && m_commanded.tilt == m_applied.tilt)
+                m_changed.wait(lock);
+
+            // Wait until the camera can take it (a newer target may be posted meanwhile)
+            double now = monotonicTime();
+            if(now < m_ready)
+            {
+                m_changed.timed_wait(lock, boost::posix_time::microseconds((long) ((m_ready - now) * 1e6) + 1));
+                continue;
+            }
+
+            // Send the latest target without holding the lock
+            bool resetting = m_reset;
+            int  pan       = m_commanded.pan;
+            int  tilt      = m_commanded.tilt;
+            int  step      = std::max(std::abs(pan - m_applied.pan), std::abs(tilt - m_applied.tilt));
+            m_reset = false;
+            lock.unlock();
+            int failed = resetting ? m_camera.ptz_reset() : m_camera.ptz_move_relative(pan - m_camera.pan(), tilt - m_camera.tilt(), 0);
+
+            // Record where the turret will be, and when the next move may be sent
+            lock.lock();
+            now = monotonicTime();
+            double travel = resetting ? m_parameters.resetTime : step / m_parameters.slewRate;
+            m_ready = now + std::max(m_parameters.interval, travel);
+            if(failed)
+            {
+                // Give up on the target rather than retry a camera which can't move
+                m_errors++;
+                if(m_commanded.pan == pan && m_commanded.tilt == tilt)
+                    m_commanded = m_applied;
+                continue;
+            }
+            m_applied.pan       = pan;
+            m_applied.tilt      = tilt;
+            m_applied.timestamp = now + travel;
+            m_transfers++;
+        }
+    } catch (boost::thread_interrupted)
+    {
+
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ *  synthetic_camera.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kybernetes/sensor/synthetic_camera.hpp>
+
+// System dependencies
+#include <linux/videodev2.h>
+
+// Language deps
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+using namespace kybernetes::sensor;
+
+// A drawn image, owned by the frames holding it
+struct synthetic_lease : public Frame::lease
+{
+    std::vector<unsigned char> image;
+};
+
+// Position bouncing between two walls
+static double bounce(double position, double low, double high)
+{
+    double span = high - low;
+    if(span <= 0.0)
+        return low;
+    double p = std::fmod(position - low, 2.0 * span);
+    if(p < 0.0)
+        p += 2.0 * span;
+    return low + ((p > span) ? 2.0 * span - p : p);
+}
+
+// Constructor for the object
+SyntheticCamera::SyntheticCamera(unsigned int width, unsigned int height, double rate, unsigned int blobs, unsigned int seed)
+    : m_width(width & ~1u), m_height(height), m_pacer(rate), m_rate(rate), m_background(m_width * m_height * 2)
+{
+    // Shade the background top to bottom, neutral color
+    for(unsigned int y = 0; y < m_height; y++)
+    {
+        unsigned char luma = (unsigned char) (64 + (96 * y) / std::max(m_height, 1u));
+        unsigned char *row = &m_background[y * m_width * 2];
+        for(unsigned int x = 0; x < m_width; x += 2)
+        {
+            row[x*2 + 0] = luma;
+            row[x*2 + 1] = 128;
+            row[x*2 + 2] = luma;
+            row[x*2 + 3] = 128;
+        }
+    }
+
+    // Scatter the blobs, bright and saturated so they threshold cleanly
+    srand(seed);
+    std::vector<blob> b;
+    for(unsigned int i = 0; i < blobs; i++)
+    {
+        blob k;
+        k.radius   = 8 + rand() % std::max(m_height / 8, 1u);
+        k.x        = k.radius + rand() % std::max((int) (m_width - 2 * k.radius), 1);
+        k.y        = k.radius + rand() % std::max((int) (m_height - 2 * k.radius), 1);
+        k.dx       = (rand() % 200) - 100;
+        k.dy       = (rand() % 200) - 100;
+        k.color[0] = 100 + rand() % 100;
+        k.color[1] = (rand() % 2) ? 40 + rand() % 40 : 176 + rand() % 40;
+        k.color[2] = (rand() % 2) ? 40 + rand() % 40 : 176 + rand() % 40;
+        b.push_back(k);
+    }
+    setBlobs(b);
+}
+
+// Replace the blobs
+void SyntheticCamera::setBlobs(const std::vector<blob>& blobs)
+{
+    m_blobs = blobs;
+}
+
+// The blobs as drawn in a frame
+std::vector<SyntheticCamera::blob> SyntheticCamera::blobsAt(unsigned int sequence) const
+{
+    double t = sequence / ((m_rate > 0.0) ? m_rate : 30.0);
+    std::vector<blob> result(m_blobs);
+    for(std::vector<blob>::iterator it = result.begin(); it != result.end(); ++it)
+    {
+        it->x = bounce(it->x + it->dx * t, it->radius, m_width - it->radius);
+        it->y = bounce(it->y + it->dy * t, it->radius, m_height - it->radius);
+    }
+    return result;
+}
+
+// Draw the next frame
+int SyntheticCamera::capture(Frame& frame)
+{
+    double        timestamp;
+    unsigned long index = m_pacer.next(timestamp);
+
+    // Start from the background
+    boost::shared_ptr<synthetic_lease> l(new synthetic_lease);
+    l->image = m_background;
+    unsigned char *image = &l->image[0];
+
+    // Draw each blob in whole pixel pairs (its edges are a pixel rough)
+    std::vector<blob> blobs = blobsAt(index);
+    for(std::vector<blob>::iterator it = blobs.begin(); it != blobs.end(); ++it)
+    {
+        int top    = std::max((int) (it->y - it->radius), 0);
+        int bottom = std::min((int) (it->y + it->radius), (int) m_height - 1);
+        for(int y = top; y <= bottom; y++)
+        {
+            double half  = std::sqrt(std::max(it->radius * it->radius - (y - it->y) * (y - it->y), 0.0));
+            int    left  = std::max((int) (it->x - half), 0) & ~1;
+            int    right = std::min((int) (it->x + half), (int) m_width - 1);
+            unsigned char *row = image + y * m_width * 2;
+            for(int x = left; x <= right; x += 2)
+            {
+                row[x*2 + 0] = it->color[0];
+                row[x*2 + 1] = it->color[1];
+                row[x*2 + 2] = it->color[0];
+                row[x*2 + 3] = it->color[2];
+            }
+        }
+    }
+
+    // Hand it out
+    l->data      = image;
+    l->size      = l->image.size();
+    l->timestamp = timestamp;
+    l->sequence  = index;
+    frame = Frame(l);
+    return 0;
+}
+
+unsigned int SyntheticCamera::imageWidth() const
+{
+    return m_width;
+}
+
+unsigned int SyntheticCamera::imageHeight() const
+{
+    return m_height;
+}
+
+unsigned int SyntheticCamera::imageFormat() const
+{
+    return V4L2_PIX_FMT_YUYV;
+}
+
+unsigned long SyntheticCamera::dropped() const
+{
+    return m_pacer.dropped();
+}
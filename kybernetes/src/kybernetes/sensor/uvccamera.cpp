@@ -18,11 +18,13 @@
  */
 
 #include <kybernetes/sensor/uvccamera.hpp>
+#include <kybernetes/utility/clock.hpp>
 
 // System dependencies
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
 
@@ -30,15 +32,52 @@
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
-
-// External libraries
-//#include <jpeglib.h>
+#include <algorithm>
 
 using namespace kybernetes::sensor;
 
+// The descriptor and the mapped buffers.  The camera and every frame from it share this, so a
+// frame that outlives the camera still points at mapped memory and requeues to the right file.
+// Which buffers frames hold is kept so the stream can be restarted under them.
+struct UVCCamera::mapping
+{
+    int                 descriptor;
+    std::vector<void *> mem;
+    std::vector<size_t> lengths;
+    std::vector<bool>   held;
+    boost::mutex        lock;
+
+    mapping(int _descriptor) : descriptor(_descriptor) {}
+    ~mapping()
+    {
+        // Unmap the buffers and close the camera
+        for (unsigned int i = 0; i < mem.size(); i++) munmap (mem[i], lengths[i]);
+        close(descriptor);
+    }
+};
+
+// A dequeued buffer, requeued when the last frame holding it is dropped
+struct UVCCamera::lease : public Frame::lease
+{
+    boost::shared_ptr<UVCCamera::mapping> device;
+    struct v4l2_buffer                    buffer;
+
+    ~lease()
+    {
+        // Give the buffer back to the camera
+        if( !device )
+            return;
+        boost::mutex::scoped_lock lock(device->lock);
+        device->held[buffer.index] = false;
+        if( ioctl (device->descriptor, VIDIOC_QBUF, &buffer) < 0 )
+            std::cerr << "Error: UVCCamera - Unable to requeue a frame's buffer" << std::endl;
+    }
+};
+
 // Supports V4L2_PIX_FMT_YUYV and V4L2_PIX_FMT_MJPEG
-UVCCamera::UVCCamera( std::string device, int _width, int _height, int format )
-    : videodevice(device), width(_width), height(_height), formatIn(format), isstreaming(false), m_pan(0), m_tilt(0)
+UVCCamera::UVCCamera( std::string device, int _width, int _height, int format, unsigned int buffers )
+    : videodevice(device), buffercount(buffers), width(_width), height(_height), formatIn(format), isstreaming(false), m_frameRate(0.0), m_pan(0), m_tilt(0),
+      m_latestOnly(false), m_dropped(0), m_sequence(0), m_haveSequence(false)
 {
     // Check that we have correct parameters
     if( (device.length() == 0) || (width == 0) || (height == 0) ) 
@@ -51,36 +90,31 @@ UVCCamera::UVCCamera( std::string device, int _width, int _height, int format )
     if(initV4L2()) 
     {
         std::cerr << "Error: UVCCamera - device init failed" << std::endl;
-        close(cam);
+        m_mapping.reset();
         return;
     }
 
     // Try to start the video feed
     if(setStreaming(true)) {
         std::cerr << "Error: UVCCamera - could not start video stream" << std::endl;
-        close(cam);
+        m_mapping.reset();
         return;
     }
 }
 
 UVCCamera::~UVCCamera() {
-    // Stop streaming
+    // Stop streaming, the buffers are unmapped and the camera closed once no frame holds them
     setStreaming(false);
-    
-    // Unmap the buffers
-    for (int i = 0; i < NB_BUFFER; i++) munmap (mem[i], buf.length);
-    
-    // Close the camera
-    close(cam);
 }
 
 int UVCCamera::initV4L2() {
-    // Open the camera device file
-    if( (cam = open(videodevice.c_str(), O_RDWR)) < 0 ) 
+    // Open the camera device file (dequeues don't block, captures wait on poll instead)
+    if( (cam = open(videodevice.c_str(), O_RDWR | O_NONBLOCK)) < 0 ) 
     {
         std::cerr << "Error: UVCCamera::initV4L2() - failed to open device" << std::endl;
         return 1;
     }
+    m_mapping.reset(new mapping(cam));
 
     // Query the device capabilities
     memset (&cap, 0, sizeof (struct v4l2_capability));
@@ -133,7 +167,7 @@ int UVCCamera::initV4L2() {
 
     // Request the buffers in which image data is stored
     memset (&this->rb, 0, sizeof (struct v4l2_requestbuffers));
-    rb.count = NB_BUFFER;
+    rb.count = buffercount;
     rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     rb.memory = V4L2_MEMORY_MMAP;
     if( ioctl (cam, VIDIOC_REQBUFS, &rb) < 0 ) {
@@ -141,8 +175,18 @@ int UVCCamera::initV4L2() {
         return 1;
     }
 
+    // The driver may have given us a different number of buffers
+    if (rb.count != buffercount) {
+        std::cerr << "Warning: UVCCamera::initV4L2() - " << buffercount << " buffers unavailable, using " << rb.count << " instead" << std::endl;
+        buffercount = rb.count;
+    }
+    if (buffercount == 0) {
+        std::cerr << "Error: UVCCamera::initV4L2() - No buffers allocated" << std::endl;
+        return 1;
+    }
+
     // Query and map buffers
-    for (int i = 0; i < NB_BUFFER; i++) {
+    for (unsigned int i = 0; i < buffercount; i++) {
         // Create the buffer 
         memset (&buf, 0, sizeof (struct v4l2_buffer));
         buf.index = i;
@@ -154,15 +198,18 @@ int UVCCamera::initV4L2() {
         }
 
         // Memory map the buffer
-        mem[i] = mmap (0, buf.length, PROT_READ, MAP_SHARED, cam, buf.m.offset);
-        if (this->mem[i] == MAP_FAILED) {
+        void *m = mmap (0, buf.length, PROT_READ, MAP_SHARED, cam, buf.m.offset);
+        if (m == MAP_FAILED) {
             std::cerr << "Error: UVCCamera::initV4L2() - Unable to map buffer [" << i << "]" << std::endl;
             return 1;
         }
+        m_mapping->mem.push_back(m);
+        m_mapping->lengths.push_back(buf.length);
+        m_mapping->held.push_back(false);
     }
 
     // Queue the buffers for usage
-    for (int i = 0; i < NB_BUFFER; ++i) {
+    for (unsigned int i = 0; i < buffercount; ++i) {
         // Select the buffer
         memset (&buf, 0, sizeof (struct v4l2_buffer));
         buf.index = i;
@@ -175,9 +222,73 @@ int UVCCamera::initV4L2() {
             return 1;
         }
     }
+    
+    // Learn the controls once, so using them costs no queries
+    loadControls();
+    
+    // And the frame rate, if the camera has one to set
+    struct v4l2_streamparm parm;
+    memset (&parm, 0, sizeof (struct v4l2_streamparm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if( ioctl (cam, VIDIOC_G_PARM, &parm) == 0 && (parm.parm.capture.capability & V4L2_CAP_TIMEPERFRAME) &&
+        parm.parm.capture.timeperframe.numerator )
+        m_frameRate = (double) parm.parm.capture.timeperframe.denominator / parm.parm.capture.timeperframe.numerator;
     return 0;
 }
 
+// Change the frame rate, restarting the stream under the frames held
+int UVCCamera::set_frame_rate(unsigned int fps)
+{
+    // Nothing to do if the camera can't or is already there
+    if( !m_mapping || fps == 0 || m_frameRate == 0.0 ) 
+        return 1;
+    if( m_frameRate == (double) fps )
+        return 0;
+    
+    // The interval can only be changed while the camera is stopped, which takes back every
+    // buffer.  Frames give theirs back under the lock, so it is known which to requeue.
+    boost::mutex::scoped_lock lock(m_mapping->lock);
+    bool streaming = isstreaming;
+    if( setStreaming(false) )
+        return 1;
+    
+    // Set the interval, the camera picks the nearest it has
+    struct v4l2_streamparm parm;
+    memset (&parm, 0, sizeof (struct v4l2_streamparm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    parm.parm.capture.timeperframe.numerator   = 1;
+    parm.parm.capture.timeperframe.denominator = fps;
+    int result = 0;
+    if( ioctl (cam, VIDIOC_S_PARM, &parm) < 0 || parm.parm.capture.timeperframe.numerator == 0 ) {
+        std::cerr << "Error: UVCCamera::set_frame_rate() - Unable to set " << fps << " fps" << std::endl;
+        result = 1;
+    } else
+        m_frameRate = (double) parm.parm.capture.timeperframe.denominator / parm.parm.capture.timeperframe.numerator;
+    
+    // Give the camera back the buffers no frame holds and restart, the sequence starts over
+    for (unsigned int i = 0; i < buffercount; i++) {
+        if( m_mapping->held[i] )
+            continue;
+        memset (&buf, 0, sizeof (struct v4l2_buffer));
+        buf.index = i;
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        if( ioctl (cam, VIDIOC_QBUF, &buf) < 0 ) {
+            std::cerr << "Error: UVCCamera::set_frame_rate() - Unable to queue buffer [" << i << "]" << std::endl;
+            result = 1;
+        }
+    }
+    m_haveSequence = false;
+    if( streaming && setStreaming(true) )
+        return 1;
+    return result;
+}
+
+double UVCCamera::frame_rate() const
+{
+    return m_frameRate;
+}
+
 // Set if streaming is enabled or not
 int UVCCamera::setStreaming(bool streaming)
 {
@@ -206,13 +317,8 @@ int UVCCamera::grab(std::vector<unsigned char>& data)
         return 1;
     }
 
-    // Set the buffer type
-    memset( &buf, 0, sizeof (struct v4l2_buffer) );
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
-
     // Dequeue a buffer frame
-    if( ioctl (cam, VIDIOC_DQBUF, &buf) < 0 ) {
+    if( dequeue(&buf, true) ) {
         std::cerr << "Error: UVCCamera::grab() - Unable to dequeue buffer" << std::endl;
         return 1;
     }
@@ -224,14 +330,14 @@ int UVCCamera::grab(std::vector<unsigned char>& data)
         data.resize(framesize); 
 
         // Copy our data into the buffer
-        memcpy(data.data(), mem[buf.index], buf.bytesused);
+        memcpy(data.data(), m_mapping->mem[buf.index], buf.bytesused);
         //std::cout << "Framesize = " << framesize << ", used = " << buf.bytesused << std::endl;
     } else if(this->formatIn == V4L2_PIX_FMT_MJPEG) {        
         // Resize the image buffer to hold the frame
         data.resize(buf.bytesused);
 
         // Copy in the image body
-        memcpy (data.data(), mem[buf.index], buf.bytesused);
+        memcpy (data.data(), m_mapping->mem[buf.index], buf.bytesused);
     } else {
         std::cerr << "Error: UVCCamera::uvcGrab() - camera using unsupported format" << std::endl;
         return 1;
@@ -246,7 +352,37 @@ int UVCCamera::grab(std::vector<unsigned char>& data)
     return 0;
 }
 
+// Dequeue a frame
+int UVCCamera::dequeue(struct v4l2_buffer* buffer, bool wait)
+{
+    while(1) {
+        // Set the buffer type
+        memset( buffer, 0, sizeof (struct v4l2_buffer) );
+        buffer->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buffer->memory = V4L2_MEMORY_MMAP;
+
+        // Try to dequeue a buffer frame
+        if( ioctl (cam, VIDIOC_DQBUF, buffer) == 0 )
+            return 0;
+        if( errno != EAGAIN )
+            return 1;
+        if( !wait )
+            return 2;
+
+        // Wait for the driver to fill one (a signal interrupts the wait, like a blocking dequeue)
+        struct pollfd p = { cam, POLLIN, 0 };
+        if( poll(&p, 1, -1) < 0 )
+            return 1;
+    }
+}
+
 int UVCCamera::capture_buffer(struct v4l2_buffer* buffer, void** data, size_t* len)
+{
+    return capture_buffer(buffer, data, len, NULL);
+}
+
+// Take the next frame (or the newest in latest only mode)
+int UVCCamera::take(struct v4l2_buffer* buffer, bool wait)
 {
     // Ensure the video is indeed streaming
     if(setStreaming(true)) {
@@ -254,28 +390,146 @@ int UVCCamera::capture_buffer(struct v4l2_buffer* buffer, void** data, size_t* l
         return 1;
     }
 
-    // Set the buffer type
-    memset( buffer, 0, sizeof (struct v4l2_buffer) );
-    buffer->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buffer->memory = V4L2_MEMORY_MMAP;
-
     // Dequeue a buffer frame
-    if( ioctl (cam, VIDIOC_DQBUF, buffer) < 0 ) {
+    int result = dequeue(buffer, wait);
+    if( result == 1 ) {
         std::cerr << "Error: UVCCamera::capture_buffer() - Unable to dequeue buffer" << std::endl;
         return 1;
+    } else if( result == 2 )
+        return 2;
+    tap(buffer);
+    
+    // In latest only mode, trade up to the newest frame ready and give the older back
+    if(m_latestOnly) {
+        struct v4l2_buffer newer;
+        while( dequeue(&newer, false) == 0 ) {
+            tap(&newer);
+            if( ioctl (this->cam, VIDIOC_QBUF, buffer) < 0 ) {
+                std::cerr << "Error: UVCCamera::capture_buffer() - Unable to requeue buffer" << std::endl;
+                ioctl (this->cam, VIDIOC_QBUF, &newer);
+                return 1;
+            }
+            *buffer = newer;
+        }
     }
     
-    // Assign the provided pointer to a pointer to the video buffer
-    *data = mem[buffer->index];
+    // Count the frames that never made it here since the last one that did
+    if(m_haveSequence && buffer->sequence > m_sequence)
+        m_dropped += buffer->sequence - m_sequence - 1;
+    m_sequence = buffer->sequence;
+    m_haveSequence = true;
+    return 0;
+}
+
+// Show a dequeued frame to the callbacks
+void UVCCamera::tap(const struct v4l2_buffer* buffer)
+{
+    boost::mutex::scoped_lock lock(m_callbackMutex);
+    if(m_callbacks.empty())
+        return;
+    
+    // The frame doesn't hold the buffer, it is only valid until the callbacks return
+    boost::shared_ptr<Frame::lease> l(new Frame::lease);
+    l->data      = m_mapping->mem[buffer->index];
+    l->size      = buffer->bytesused;
+    l->timestamp = kybernetes::utility::toSeconds(buffer->timestamp);
+    l->sequence  = buffer->sequence;
+    Frame frame(l);
+    for(std::list<UVCCamera::callback *>::iterator it = m_callbacks.begin(); it != m_callbacks.end(); ++it)
+        (*it)->camera_event_frame(frame);
+}
+
+// Store a callback object in our callbacks list
+void UVCCamera::register_callback(UVCCamera::callback *c)
+{
+    boost::mutex::scoped_lock lock(m_callbackMutex);
+    m_callbacks.push_back(c);
+}
+
+// Remove a callback object from our callbacks list
+void UVCCamera::unregister_callback(UVCCamera::callback *c)
+{
+    boost::mutex::scoped_lock lock(m_callbackMutex);
+    m_callbacks.remove(c);
+}
+
+int UVCCamera::capture_buffer(struct v4l2_buffer* buffer, void** data, size_t* len, double* timestamp)
+{
+    // Wait for a frame
+    if( take(buffer, true) )
+        return 1;
     
-    // Return how many bytes were used
+    // Assign the provided pointer to a pointer to the video buffer, held until it is released
+    *data = m_mapping->mem[buffer->index];
+    {
+        boost::mutex::scoped_lock lock(m_mapping->lock);
+        m_mapping->held[buffer->index] = true;
+    }
+    
+    // Return how many bytes were used and when the frame was captured
     *len    = buffer->bytesused;
+    if(timestamp)
+        *timestamp = kybernetes::utility::toSeconds(buffer->timestamp);
     return 0;
 }
 
+int UVCCamera::capture(Frame& frame)
+{
+    return capture(frame, true);
+}
+
+int UVCCamera::capture(Frame& frame, bool wait)
+{
+    // Capture into a new lease, it only requeues once it holds a buffer
+    boost::shared_ptr<UVCCamera::lease> l(new UVCCamera::lease);
+    int result = take(&l->buffer, wait);
+    if( result )
+        return result;
+    l->device    = m_mapping;
+    l->data      = m_mapping->mem[l->buffer.index];
+    {
+        boost::mutex::scoped_lock lock(m_mapping->lock);
+        m_mapping->held[l->buffer.index] = true;
+    }
+    l->size      = l->buffer.bytesused;
+    l->timestamp = kybernetes::utility::toSeconds(l->buffer.timestamp);
+    l->sequence  = l->buffer.sequence;
+    
+    // Replacing the frame drops its hold on the last buffer
+    frame = Frame(l);
+    return 0;
+}
+
+int UVCCamera::descriptor() const
+{
+    return cam;
+}
+
+bool UVCCamera::isOpen() const
+{
+    return m_mapping.get() != NULL;
+}
+
+unsigned int UVCCamera::imageWidth() const
+{
+    return width;
+}
+
+unsigned int UVCCamera::imageHeight() const
+{
+    return height;
+}
+
+unsigned int UVCCamera::imageFormat() const
+{
+    return formatIn;
+}
+
 int UVCCamera::release_buffer(struct v4l2_buffer* buffer)
 {
     // Requeue the buffer
+    boost::mutex::scoped_lock lock(m_mapping->lock);
+    m_mapping->held[buffer->index] = false;
     if( ioctl (this->cam, VIDIOC_QBUF, buffer) < 0 ) {
         std::cerr << "Error: UVCCamera::release_buffer() - Unable to requeue buffer" << std::endl;
         return 1;
@@ -283,63 +537,148 @@ int UVCCamera::release_buffer(struct v4l2_buffer* buffer)
     return 0;
 }
 
-int UVCCamera::isControl(int control, struct v4l2_queryctrl *queryctrl) {
-    queryctrl->id = control;
-    if ( ioctl (this->cam, VIDIOC_QUERYCTRL, queryctrl) < 0)
-    {
-        std::cerr << "Error: UVCCamera::isControl() - ioctl querycontrol error" << std::endl;
-    } else if (queryctrl->flags & V4L2_CTRL_FLAG_DISABLED)
-    {
-        //ROS_ERROR( "UVCCamera::isControl() - control %s disabled\n", (char *) queryctrl->name);
-    } else if (queryctrl->flags & V4L2_CTRL_TYPE_BOOLEAN)
-    {
-        return 0;
-    } else if (queryctrl->type & V4L2_CTRL_TYPE_INTEGER)
-    {
-        return 0;
-    } else
-    {
-        //ROS_ERROR( "UVCCamera::isControl() - control %s unsupported\n", (char *) queryctrl->name);
+// Read the description and value of every control the camera has
+void UVCCamera::loadControls()
+{
+    m_controls.clear();
+    
+    // Walk the controls the driver lists, or try the standard and camera class ids on drivers
+    // too old to list them
+    struct v4l2_queryctrl queryctrl;
+    std::vector<struct v4l2_queryctrl> found;
+    memset (&queryctrl, 0, sizeof (struct v4l2_queryctrl));
+    queryctrl.id = V4L2_CTRL_FLAG_NEXT_CTRL;
+    if( ioctl (cam, VIDIOC_QUERYCTRL, &queryctrl) == 0 ) {
+        do {
+            found.push_back(queryctrl);
+            queryctrl.id |= V4L2_CTRL_FLAG_NEXT_CTRL;
+        } while( ioctl (cam, VIDIOC_QUERYCTRL, &queryctrl) == 0 );
+    } else {
+        for (unsigned int id = V4L2_CID_BASE; id < V4L2_CID_LASTP1; id++) {
+            queryctrl.id = id;
+            if( ioctl (cam, VIDIOC_QUERYCTRL, &queryctrl) == 0 )
+                found.push_back(queryctrl);
+        }
+        for (unsigned int id = V4L2_CID_CAMERA_CLASS_BASE; id < V4L2_CID_CAMERA_CLASS_BASE + 32; id++) {
+            queryctrl.id = id;
+            if( ioctl (cam, VIDIOC_QUERYCTRL, &queryctrl) == 0 )
+                found.push_back(queryctrl);
+        }
     }
-    return 1;
+    
+    // Keep the integer, boolean and menu controls which are enabled, with their values
+    for (size_t i = 0; i < found.size(); i++) {
+        UVCCamera::control c;
+        c.query = found[i];
+        if( (c.query.flags & V4L2_CTRL_FLAG_DISABLED) || (c.query.type != V4L2_CTRL_TYPE_INTEGER &&
+             c.query.type != V4L2_CTRL_TYPE_BOOLEAN && c.query.type != V4L2_CTRL_TYPE_MENU) )
+            continue;
+        struct v4l2_control control_s;
+        control_s.id = c.query.id;
+        c.value = ( ioctl (cam, VIDIOC_G_CTRL, &control_s) == 0 ) ? control_s.value : c.query.default_value;
+        m_controls[c.query.id] = c;
+    }
+}
+
+int UVCCamera::isControl(int control, struct v4l2_queryctrl *queryctrl) {
+    // Look the control up in the cache
+    std::map<int, UVCCamera::control>::const_iterator it = m_controls.find(control);
+    if( it == m_controls.end() )
+        return 1;
+    if( queryctrl )
+        *queryctrl = it->second.query;
+    return 0;
 }
 
 int UVCCamera::getControl(int control) {
-    // Query controls structures
-    struct v4l2_queryctrl queryctrl;
-    struct v4l2_control   control_s;
-    
     // Test if the the requested control is an actual control
-    if (this->isControl (control, &queryctrl))
+    std::map<int, UVCCamera::control>::iterator it = m_controls.find(control);
+    if( it == m_controls.end() )
         return 1;
     
-    // Otherwise read the control value
-    control_s.id = control;
-    if ( ioctl (this->cam, VIDIOC_G_CTRL, &control_s) < 0) {
-        std::cerr << "Error: UVCCamera::getControl() - ioctl get control error" << std::endl;
-        return 1;
+    // Controls the camera changes itself (like gain under auto gain) are read, the rest are
+    // as they were last set
+    if( it->second.query.flags & V4L2_CTRL_FLAG_VOLATILE ) {
+        struct v4l2_control control_s;
+        control_s.id = control;
+        if ( ioctl (this->cam, VIDIOC_G_CTRL, &control_s) < 0) {
+            std::cerr << "Error: UVCCamera::getControl() - ioctl get control error" << std::endl;
+            return 1;
+        }
+        it->second.value = control_s.value;
     }
-    return control_s.value;
+    return it->second.value;
 }
 
 int UVCCamera::setControl(int control, int value) {
-    // Query controls structures
-    struct v4l2_queryctrl queryctrl;
-    struct v4l2_control   control_s;
+    std::map<int, int> values;
+    values[control] = value;
+    return setControls(values);
+}
+
+int UVCCamera::setControls(const std::map<int, int>& values)
+{
+    // Drop the controls the camera doesn't have and the values it already has, and keep the
+    // rest within their bounds
+    std::vector<struct v4l2_ext_control> xctrls;
+    int result = 0;
+    for (std::map<int, int>::const_iterator it = values.begin(); it != values.end(); ++it) {
+        std::map<int, UVCCamera::control>::iterator c = m_controls.find(it->first);
+        if( c == m_controls.end() ) {
+            result = 1;
+            continue;
+        }
+        int value = std::max(c->second.query.minimum, std::min(c->second.query.maximum, it->second));
+        if( value == c->second.value && !(c->second.query.flags & V4L2_CTRL_FLAG_VOLATILE) )
+            continue;
+        struct v4l2_ext_control xctrl;
+        memset (&xctrl, 0, sizeof (struct v4l2_ext_control));
+        xctrl.id = it->first;
+        xctrl.value = value;
+        xctrls.push_back(xctrl);
+    }
+    if( xctrls.empty() )
+        return result;
     
-    // Test if the the requested control is an actual control
-    if (this->isControl (control, &queryctrl) < 0) return -1;
+    // Set them all in one transfer
+    struct v4l2_ext_controls ctrls;
+    memset (&ctrls, 0, sizeof (struct v4l2_ext_controls));
+    ctrls.count = xctrls.size();
+    ctrls.controls = &xctrls[0];
+    if( ioctl (this->cam, VIDIOC_S_EXT_CTRLS, &ctrls) == 0 ) {
+        for (size_t i = 0; i < xctrls.size(); i++)
+            m_controls[xctrls[i].id].value = xctrls[i].value;
+        return result;
+    }
     
-    // If the requested value is within the bounds of the control, attempt to set the control
-    if ((value >= queryctrl.minimum) && (value <= queryctrl.maximum)) {
-        control_s.id = control;
-        control_s.value = value;
+    // Drivers without extended controls (or which won't mix classes) take them one at a time
+    for (size_t i = 0; i < xctrls.size(); i++) {
+        struct v4l2_control control_s;
+        control_s.id = xctrls[i].id;
+        control_s.value = xctrls[i].value;
         if (ioctl (this->cam, VIDIOC_S_CTRL, &control_s) < 0) {
-            std::cerr << "Error: UVCCamera::setControl() - ioctl set control error" << std::endl;
-            return 1;
+            std::cerr << "Error: UVCCamera::setControls() - ioctl set control error" << std::endl;
+            result = 1;
+            continue;
         }
+        m_controls[xctrls[i].id].value = xctrls[i].value;
     }
-    return 0;
+    return result;
+}
+
+bool UVCCamera::controlRange(int control, int& minimum, int& maximum) const
+{
+    std::map<int, UVCCamera::control>::const_iterator it = m_controls.find(control);
+    if( it == m_controls.end() )
+        return false;
+    minimum = it->second.query.minimum;
+    maximum = it->second.query.maximum;
+    return true;
+}
+
+int UVCCamera::controlValue(int control)
+{
+    return getControl(control);
 }
 
 int UVCCamera::saturation( int nsaturation ) {
@@ -468,3 +807,23 @@ int UVCCamera::ptz_move_absolute(int pan, int tilt, int zoom)
     // return success   
     return 0;
 }
+
+int UVCCamera::pan() const
+{
+    return m_pan;
+}
+
+int UVCCamera::tilt() const
+{
+    return m_tilt;
+}
+
+void UVCCamera::set_latest_only(bool latest)
+{
+    m_latestOnly = latest;
+}
+
+unsigned long UVCCamera::dropped() const
+{
+    return m_dropped;
+}
@@ -0,0 +1,44 @@
+/*
+ *  clock.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kybernetes/utility/clock.hpp>
+
+#include <time.h>
+
+// Seconds on the monotonic clock
+double kybernetes::utility::monotonicTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1000000000.0;
+}
+
+// Seconds of processor time used by the process
+double kybernetes::utility::processorTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1000000000.0;
+}
+
+// Convert a timeval to seconds
+double kybernetes::utility::toSeconds(const struct timeval& tv)
+{
+    return (double) tv.tv_sec + (double) tv.tv_usec / 1000000.0;
+}
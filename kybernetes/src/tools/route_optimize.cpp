@@ -0,0 +1,87 @@
+/*
+ *  route_optimize.cpp
+ *
+ *  Copyright (c) 2013 Nathaniel Lewis, Robotics Society at UC Merced
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Language deps
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Kybernetes deps
+#include <kybernetes/math/gps_common.hpp>
+#include <kybernetes/math/local_frame.hpp>
+#include <kybernetes/navigation/route_optimizer.hpp>
+#include <kybernetes/utility/clock.hpp>
+
+int main (int argc, char** argv)
+{
+    // Check the arguments
+    if(argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <coordinate list> <output coordinate list> [open]" << std::endl;
+        std::cerr << "   The route starts at the first waypoint and finishes at the last, unless \"open\"" << std::endl;
+        std::cerr << "   (e.g. " << argv[0] << " doc/robomagellan2.list robomagellan2_ordered.list)" << std::endl;
+        return 1;
+    }
+    bool fixedEnd = !(argc > 3 && std::string(argv[3]) == "open");
+    
+    // Load the waypoints
+    std::vector<kybernetes::math::GeoCoordinate> waypoints;
+    if(!kybernetes::math::loadCoordinateList(argv[1], waypoints) || waypoints.empty())
+    {
+        std::cerr << "Fatal: Could not load coordinate list \"" << argv[1] << "\"" << std::endl;
+        return 1;
+    }
+    
+    // Lay them out about the start, the same frame gps_navigate_demo uses
+    kybernetes::math::LocalFrame frame(waypoints.front());
+    std::vector<kybernetes::math::LocalCoordinate> points;
+    for(std::vector<kybernetes::math::GeoCoordinate>::iterator it = waypoints.begin(); it != waypoints.end(); ++it)
+        points.push_back(frame.toLocal(*it));
+    
+    // Order them
+    double start = kybernetes::utility::monotonicTime();
+    kybernetes::navigation::RouteOptimizer optimizer(points);
+    std::vector<size_t> order = optimizer.solve(fixedEnd);
+    double elapsed = kybernetes::utility::monotonicTime() - start;
+    
+    // Report the improvement
+    std::vector<size_t> given(waypoints.size());
+    for(size_t i = 0; i < given.size(); i++)
+        given[i] = i;
+    std::cout << "Ordered " << waypoints.size() << " waypoints " << (optimizer.isExact() ? "exactly" : "heuristically") << " in " << elapsed * 1000.0 << " ms" << std::endl;
+    std::cout << "Length " << optimizer.length(given) << " m as given, " << optimizer.length(order) << " m ordered" << std::endl;
+    std::cout << "Order =";
+    for(std::vector<size_t>::iterator it = order.begin(); it != order.end(); ++it)
+        std::cout << " " << *it;
+    std::cout << std::endl;
+    
+    // Write the route out
+    std::vector<kybernetes::math::GeoCoordinate> ordered;
+    for(std::vector<size_t>::iterator it = order.begin(); it != order.end(); ++it)
+        ordered.push_back(waypoints[*it]);
+    if(!kybernetes::math::saveCoordinateList(argv[2], ordered))
+    {
+        std::cerr << "Fatal: Could not write coordinate list \"" << argv[2] << "\"" << std::endl;
+        return 1;
+    }
+    
+    // Return success
+    return 0;
+}